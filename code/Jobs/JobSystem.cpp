@@ -0,0 +1,186 @@
+//
+//	JobSystem.cpp
+//
+#include "JobSystem.h"
+#include "../Profiler/Profiler.h"
+#include <stdio.h>
+
+// Which system and deque the current thread belongs to.  Threads the system didn't spawn use deque 0.
+static thread_local const JobSystem * t_jobSystem = NULL;
+static thread_local int t_workerIdx = 0;
+
+/*
+====================================================
+JobSystem::JobSystem
+====================================================
+*/
+JobSystem::JobSystem( const int numThreads ) :
+m_numThreads( ( numThreads > 1 ) ? numThreads : 1 ),
+m_numQueued( 0 ),
+m_isShuttingDown( false ) {
+	m_workers = new worker_t[ m_numThreads ];
+
+	// Deque 0 belongs to whoever calls ParallelFor, the rest get a thread each
+	for ( int i = 1; i < m_numThreads; i++ ) {
+		m_workers[ i ].thread = std::thread( &JobSystem::WorkerMain, this, i );
+	}
+}
+
+/*
+====================================================
+JobSystem::~JobSystem
+====================================================
+*/
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard< std::mutex > guard( m_sleepLock );
+		m_isShuttingDown = true;
+	}
+	m_wake.notify_all();
+
+	for ( int i = 1; i < m_numThreads; i++ ) {
+		m_workers[ i ].thread.join();
+	}
+	delete[] m_workers;
+}
+
+/*
+====================================================
+JobSystem::ParallelFor
+====================================================
+*/
+void JobSystem::ParallelFor( const int count, const int grainSize, const jobFunc_t & func ) {
+	if ( count <= 0 ) {
+		return;
+	}
+
+	const int grain = ( grainSize > 1 ) ? grainSize : 1;
+	if ( 1 == m_numThreads || count <= grain ) {
+		func( 0, count );
+		return;
+	}
+
+	const int numJobs = ( count + grain - 1 ) / grain;
+	std::atomic< int > numPending( numJobs );
+
+	// Queue the ranges back to front, so the owner pops them in order and thieves take the far end
+	const int workerIdx = GetWorkerIndex();
+	worker_t & worker = m_workers[ workerIdx ];
+	{
+		std::lock_guard< std::mutex > guard( worker.lock );
+		for ( int i = numJobs - 1; i >= 0; i-- ) {
+			job_t job;
+			job.func = &func;
+			job.begin = i * grain;
+			job.end = ( job.begin + grain < count ) ? job.begin + grain : count;
+			job.numPending = &numPending;
+			worker.jobs.push_back( job );
+		}
+	}
+	m_numQueued += numJobs;
+	{
+		// Taking the lock means a worker can't miss the wake up between checking the queue and sleeping
+		std::lock_guard< std::mutex > guard( m_sleepLock );
+	}
+	m_wake.notify_all();
+
+	// Help out until every range has run, this thread's jobs first
+	while ( numPending.load( std::memory_order_acquire ) > 0 ) {
+		job_t job;
+		if ( PopJob( workerIdx, job ) || StealJob( workerIdx, job ) ) {
+			RunJob( job );
+		} else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+/*
+====================================================
+JobSystem::WorkerMain
+====================================================
+*/
+void JobSystem::WorkerMain( const int workerIdx ) {
+	t_jobSystem = this;
+	t_workerIdx = workerIdx;
+
+	char threadName[ 32 ];
+	snprintf( threadName, sizeof( threadName ), "worker %i", workerIdx );
+	Profiler_SetThreadName( threadName );
+
+	while ( true ) {
+		job_t job;
+		if ( PopJob( workerIdx, job ) || StealJob( workerIdx, job ) ) {
+			RunJob( job );
+			continue;
+		}
+
+		std::unique_lock< std::mutex > lock( m_sleepLock );
+		m_wake.wait( lock, [ this ]() { return m_isShuttingDown || m_numQueued > 0; } );
+		if ( m_isShuttingDown ) {
+			return;
+		}
+	}
+}
+
+/*
+====================================================
+JobSystem::GetWorkerIndex
+====================================================
+*/
+int JobSystem::GetWorkerIndex() const {
+	return ( this == t_jobSystem ) ? t_workerIdx : 0;
+}
+
+/*
+====================================================
+JobSystem::PopJob
+====================================================
+*/
+bool JobSystem::PopJob( const int workerIdx, job_t & job ) {
+	worker_t & worker = m_workers[ workerIdx ];
+	std::lock_guard< std::mutex > guard( worker.lock );
+	if ( worker.jobs.empty() ) {
+		return false;
+	}
+
+	job = worker.jobs.back();
+	worker.jobs.pop_back();
+	m_numQueued--;
+	return true;
+}
+
+/*
+====================================================
+JobSystem::StealJob
+====================================================
+*/
+bool JobSystem::StealJob( const int workerIdx, job_t & job ) {
+	if ( 0 == m_numQueued ) {
+		return false;
+	}
+
+	for ( int i = 1; i < m_numThreads; i++ ) {
+		worker_t & victim = m_workers[ ( workerIdx + i ) % m_numThreads ];
+		std::lock_guard< std::mutex > guard( victim.lock );
+		if ( victim.jobs.empty() ) {
+			continue;
+		}
+
+		job = victim.jobs.front();
+		victim.jobs.pop_front();
+		m_numQueued--;
+		return true;
+	}
+	return false;
+}
+
+/*
+====================================================
+JobSystem::RunJob
+====================================================
+*/
+void JobSystem::RunJob( const job_t & job ) {
+	( *job.func )( job.begin, job.end );
+	job.numPending->fetch_sub( 1, std::memory_order_release );
+}
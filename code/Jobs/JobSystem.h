@@ -0,0 +1,77 @@
+//
+//	JobSystem.h
+//
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+====================================================
+jobFunc_t
+
+Runs the items [begin, end) of a parallel for
+====================================================
+*/
+typedef std::function< void( const int begin, const int end ) > jobFunc_t;
+
+/*
+====================================================
+JobSystem
+
+Work stealing scheduler.  Every thread, including the one that created the
+system, owns a deque of jobs.  A thread pushes and pops its own jobs at the
+back and steals from the front of the others' when it runs dry, so each deque
+has its own lock and there's no lock shared by all of the queues.  Idle workers
+sleep until new jobs are queued.
+
+The thread that calls ParallelFor helps run the jobs and only returns once all
+of them are done, so a parallel for is a join point.  Jobs may start their own
+parallel fors.
+
+With a single thread nothing is spawned and ParallelFor calls the function
+inline over the whole range.
+====================================================
+*/
+class JobSystem {
+public:
+	JobSystem( const int numThreads );
+	~JobSystem();
+
+	int GetNumThreads() const { return m_numThreads; }
+
+	// Splits [0, count) into ranges of at most grainSize items and runs them across the threads
+	void ParallelFor( const int count, const int grainSize, const jobFunc_t & func );
+
+private:
+	struct job_t {
+		const jobFunc_t * func;
+		int begin;
+		int end;
+		std::atomic< int > * numPending;
+	};
+
+	struct worker_t {
+		std::mutex lock;
+		std::deque< job_t > jobs;
+		std::thread thread;
+	};
+
+	void WorkerMain( const int workerIdx );
+	int GetWorkerIndex() const;
+	bool PopJob( const int workerIdx, job_t & job );
+	bool StealJob( const int workerIdx, job_t & job );
+	void RunJob( const job_t & job );
+
+	int m_numThreads;
+	worker_t * m_workers;
+
+	std::atomic< int > m_numQueued;	// jobs sitting in any of the deques
+	std::atomic< bool > m_isShuttingDown;
+	std::mutex m_sleepLock;			// only taken to put idle workers to sleep and wake them
+	std::condition_variable m_wake;
+};
@@ -0,0 +1,52 @@
+//
+//	TripleBuffer.h
+//
+#pragma once
+#include <atomic>
+
+/*
+====================================================
+TripleBuffer
+
+Hands the latest copy of some data from one writer thread to one reader
+thread without either of them ever waiting.  The writer fills the back slot
+and publishes it, the reader swaps in whatever was published most recently.
+The third slot sits in the middle, so the writer always has a slot the
+reader isn't looking at.
+
+Publishing again before the reader has looked just replaces the previous
+copy, the reader only ever sees the newest one.
+====================================================
+*/
+template< typename T >
+class TripleBuffer {
+public:
+	TripleBuffer() : m_back( 0 ), m_middle( 1 ), m_front( 2 ) {}
+
+	// Writer side
+	T & GetBack() { return m_slots[ m_back ]; }
+	void Publish() {
+		const int previous = m_middle.exchange( m_back | NEW_DATA_BIT, std::memory_order_acq_rel );
+		m_back = previous & SLOT_MASK;
+	}
+
+	// Reader side.  Returns true if there was a newer copy to swap in.
+	bool Consume() {
+		if ( 0 == ( m_middle.load( std::memory_order_relaxed ) & NEW_DATA_BIT ) ) {
+			return false;
+		}
+		const int previous = m_middle.exchange( m_front, std::memory_order_acq_rel );
+		m_front = previous & SLOT_MASK;
+		return true;
+	}
+	const T & GetFront() const { return m_slots[ m_front ]; }
+
+private:
+	static const int SLOT_MASK = 3;
+	static const int NEW_DATA_BIT = 4;	// set in m_middle when the writer has published since the last Consume
+
+	T m_slots[ 3 ];
+	int m_back;					// only touched by the writer
+	std::atomic< int > m_middle;
+	int m_front;				// only touched by the reader
+};
@@ -2,6 +2,40 @@
 //	LCP.cpp
 //
 #include "LCP.h"
+#include <float.h>
+#include <math.h>
+
+static const float LCP_PIVOT_EPSILON = 1e-9f;
+static const float LCP_TOLERANCE = 1e-5f;
+
+/*
+====================================================
+LCP_ResetStats
+====================================================
+*/
+void LCP_ResetStats( lcpStats_t & stats ) {
+	stats.numSolves = 0;
+	stats.iterations = 0;
+	stats.totalIterations = 0;
+	stats.droppedPivots = 0;
+	stats.residual = 0.0f;
+}
+
+/*
+====================================================
+LCP_RecordStats
+====================================================
+*/
+static void LCP_RecordStats( lcpStats_t * stats, const int iterations, const int droppedPivots, const float residual ) {
+	if ( NULL == stats ) {
+		return;
+	}
+	stats->numSolves++;
+	stats->iterations = iterations;
+	stats->totalIterations += iterations;
+	stats->droppedPivots += droppedPivots;
+	stats->residual = residual;
+}
 
 /*
 ====================================================
@@ -15,11 +49,253 @@ VecN LCP_GaussSeidel( const MatN & A, const VecN & b ) {
 
 	for ( int iter = 0; iter < N; iter++ ) {
 		for ( int i = 0; i < N; i++ ) {
-			float dx = ( b[ i ] - A.rows[ i ].Dot( x ) ) / A.rows[ i ][ i ];
+			// Skip rows without a usable pivot rather than dividing by ~zero
+			const float pivot = A.rows[ i ][ i ];
+			if ( fabsf( pivot ) < LCP_PIVOT_EPSILON ) {
+				continue;
+			}
+
+			float dx = ( b[ i ] - A.rows[ i ].Dot( x ) ) / pivot;
 			if ( dx * 0.0f == dx * 0.0f ) {
 				x[ i ] = x[ i ] + dx;
 			}
 		}
 	}
 	return x;
-}
\ No newline at end of file
+}
+
+/*
+====================================================
+LCP_LDLT
+====================================================
+*/
+VecN LCP_LDLT( const MatN & A, const VecN & b, lcpStats_t * stats ) {
+	const int N = b.N;
+	VecN x( N );
+	x.Zero();
+
+	// Constraint systems are tiny, so keep the factorization on the stack
+	const int MAX_N = 16;
+	if ( N > MAX_N ) {
+		x = LCP_GaussSeidel( A, b );
+		LCP_RecordStats( stats, N, 0, 0.0f );
+		return x;
+	}
+
+	float L[ MAX_N ][ MAX_N ];
+	float D[ MAX_N ];
+	bool isActive[ MAX_N ];
+	int droppedPivots = 0;
+
+	// Scale the pivot tolerance to the size of the diagonal so heavy and light bodies are treated alike
+	float maxDiagonal = 0.0f;
+	for ( int i = 0; i < N; i++ ) {
+		maxDiagonal = fmaxf( maxDiagonal, fabsf( A.rows[ i ][ i ] ) );
+	}
+	const float pivotEpsilon = LCP_PIVOT_EPSILON + maxDiagonal * 1e-6f;
+
+	// Factor A = L * D * L^T
+	for ( int j = 0; j < N; j++ ) {
+		float d = A.rows[ j ][ j ];
+		for ( int k = 0; k < j; k++ ) {
+			d -= L[ j ][ k ] * L[ j ][ k ] * D[ k ];
+		}
+
+		// A collapsed pivot means this row is redundant ( or empty ), drop it from the system
+		isActive[ j ] = ( d > pivotEpsilon ) && ( d * 0.0f == d * 0.0f );
+		if ( !isActive[ j ] ) {
+			droppedPivots++;
+			D[ j ] = 0.0f;
+			L[ j ][ j ] = 1.0f;
+			for ( int i = j + 1; i < N; i++ ) {
+				L[ i ][ j ] = 0.0f;
+			}
+			continue;
+		}
+
+		D[ j ] = d;
+		L[ j ][ j ] = 1.0f;
+		for ( int i = j + 1; i < N; i++ ) {
+			float sum = A.rows[ i ][ j ];
+			for ( int k = 0; k < j; k++ ) {
+				sum -= L[ i ][ k ] * L[ j ][ k ] * D[ k ];
+			}
+			L[ i ][ j ] = sum / d;
+		}
+	}
+
+	// Forward substitution L * y = b
+	float y[ MAX_N ];
+	for ( int i = 0; i < N; i++ ) {
+		float sum = isActive[ i ] ? b[ i ] : 0.0f;
+		for ( int k = 0; k < i; k++ ) {
+			sum -= L[ i ][ k ] * y[ k ];
+		}
+		y[ i ] = sum;
+	}
+
+	// Diagonal D * z = y
+	for ( int i = 0; i < N; i++ ) {
+		y[ i ] = isActive[ i ] ? ( y[ i ] / D[ i ] ) : 0.0f;
+	}
+
+	// Back substitution L^T * x = z
+	for ( int i = N - 1; i >= 0; i-- ) {
+		float sum = y[ i ];
+		for ( int k = i + 1; k < N; k++ ) {
+			sum -= L[ k ][ i ] * x[ k ];
+		}
+		x[ i ] = isActive[ i ] ? sum : 0.0f;
+	}
+
+	// Measure how well the active rows were satisfied
+	float residual = 0.0f;
+	for ( int i = 0; i < N; i++ ) {
+		if ( !isActive[ i ] ) {
+			continue;
+		}
+		residual = fmaxf( residual, fabsf( b[ i ] - A.rows[ i ].Dot( x ) ) );
+	}
+
+	// Never hand a bad solution back to the constraints
+	if ( residual * 0.0f != residual * 0.0f ) {
+		x.Zero();
+	}
+
+	LCP_RecordStats( stats, 1, droppedPivots, residual );
+	return x;
+}
+
+/*
+====================================================
+LCP_ProjectedGaussSeidelInternal
+====================================================
+*/
+static void LCP_ProjectedGaussSeidelInternal( const MatN & A, const VecN & b, const VecN & lo, const VecN & hi, const int maxIterations, const float tolerance, VecN & x, lcpStats_t * stats ) {
+	const int N = b.N;
+
+	int droppedPivots = 0;
+	int iter = 0;
+	float residual = 0.0f;
+	while ( iter < maxIterations ) {
+		iter++;
+
+		residual = 0.0f;
+		droppedPivots = 0;
+		for ( int i = 0; i < N; i++ ) {
+			const float pivot = A.rows[ i ][ i ];
+			if ( fabsf( pivot ) < LCP_PIVOT_EPSILON ) {
+				droppedPivots++;
+				continue;
+			}
+
+			const float xOld = x[ i ];
+			float xNew = xOld + ( b[ i ] - A.rows[ i ].Dot( x ) ) / pivot;
+			if ( xNew * 0.0f != xNew * 0.0f ) {
+				continue;
+			}
+			xNew = fmaxf( lo[ i ], fminf( hi[ i ], xNew ) );
+			x[ i ] = xNew;
+
+			// The projected residual, rows sitting on a bound only count for the part they can still move
+			residual = fmaxf( residual, fabsf( ( xNew - xOld ) * pivot ) );
+		}
+
+		if ( residual < tolerance ) {
+			break;
+		}
+	}
+
+	LCP_RecordStats( stats, iter, droppedPivots, residual );
+}
+
+/*
+====================================================
+LCP_ProjectedGaussSeidel
+====================================================
+*/
+VecN LCP_ProjectedGaussSeidel( const MatN & A, const VecN & b, const VecN & lo, const VecN & hi, const int maxIterations, const float tolerance, lcpStats_t * stats ) {
+	const int N = b.N;
+	VecN x( N );
+	for ( int i = 0; i < N; i++ ) {
+		x[ i ] = fmaxf( lo[ i ], fminf( hi[ i ], 0.0f ) );
+	}
+
+	LCP_ProjectedGaussSeidelInternal( A, b, lo, hi, maxIterations, tolerance, x, stats );
+	return x;
+}
+
+/*
+====================================================
+LCP_Solve
+====================================================
+*/
+VecN LCP_Solve( const lcpSolver_t solver, const MatN & A, const VecN & b, lcpStats_t * stats ) {
+	switch ( solver ) {
+		case LCP_SOLVER_LDLT: {
+			return LCP_LDLT( A, b, stats );
+		}
+		case LCP_SOLVER_PGS: {
+			VecN lo( b.N );
+			VecN hi( b.N );
+			for ( int i = 0; i < b.N; i++ ) {
+				lo[ i ] = -FLT_MAX;
+				hi[ i ] = FLT_MAX;
+			}
+			return LCP_ProjectedGaussSeidel( A, b, lo, hi, 4 * b.N, LCP_TOLERANCE, stats );
+		}
+		default:
+		case LCP_SOLVER_GAUSS_SEIDEL: {
+			LCP_RecordStats( stats, b.N, 0, 0.0f );
+			return LCP_GaussSeidel( A, b );
+		}
+	}
+}
+
+/*
+====================================================
+LCP_Solve
+====================================================
+*/
+VecN LCP_Solve( const lcpSolver_t solver, const MatN & A, const VecN & b, const VecN & lo, const VecN & hi, lcpStats_t * stats ) {
+	const int maxIterations = 4 * b.N;
+
+	switch ( solver ) {
+		case LCP_SOLVER_LDLT: {
+			// The direct solve and any fallback go down as a single solve, recorded once the final answer is in
+			lcpStats_t directStats;
+			LCP_ResetStats( directStats );
+			VecN x = LCP_LDLT( A, b, &directStats );
+
+			bool isWithinBounds = true;
+			for ( int i = 0; i < b.N; i++ ) {
+				if ( x[ i ] < lo[ i ] || x[ i ] > hi[ i ] ) {
+					x[ i ] = fmaxf( lo[ i ], fminf( hi[ i ], x[ i ] ) );
+					isWithinBounds = false;
+				}
+			}
+			if ( isWithinBounds ) {
+				LCP_RecordStats( stats, directStats.iterations, directStats.droppedPivots, directStats.residual );
+				return x;
+			}
+
+			lcpStats_t fallbackStats;
+			LCP_ResetStats( fallbackStats );
+			LCP_ProjectedGaussSeidelInternal( A, b, lo, hi, maxIterations, LCP_TOLERANCE, x, &fallbackStats );
+			LCP_RecordStats( stats, directStats.iterations + fallbackStats.iterations, fallbackStats.droppedPivots, fallbackStats.residual );
+			return x;
+		}
+		case LCP_SOLVER_PGS: {
+			return LCP_ProjectedGaussSeidel( A, b, lo, hi, maxIterations, LCP_TOLERANCE, stats );
+		}
+		default:
+		case LCP_SOLVER_GAUSS_SEIDEL: {
+			VecN x = LCP_GaussSeidel( A, b );
+			for ( int i = 0; i < b.N; i++ ) {
+				x[ i ] = fmaxf( lo[ i ], fminf( hi[ i ], x[ i ] ) );
+			}
+			LCP_RecordStats( stats, b.N, 0, 0.0f );
+			return x;
+		}
+	}
+}
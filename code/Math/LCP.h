@@ -5,10 +5,66 @@
 #include "Vector.h"
 #include "Matrix.h"
 
+/*
+====================================================
+lcpSolver_t
+====================================================
+*/
+enum lcpSolver_t {
+	LCP_SOLVER_GAUSS_SEIDEL,	// fixed N sweeps of plain Gauss-Seidel
+	LCP_SOLVER_LDLT,			// direct LDL^T factorization, for bilateral (unbounded) rows
+	LCP_SOLVER_PGS,				// projected Gauss-Seidel with residual based early exit, for bounded rows
+};
+
+/*
+====================================================
+lcpStats_t
+====================================================
+*/
+struct lcpStats_t {
+	int numSolves;		// number of systems solved
+	int iterations;		// sweeps used by the most recent solve (1 for a direct solve)
+	int totalIterations;
+	int droppedPivots;	// rows skipped because their pivot was degenerate
+	float residual;		// max row residual left after the most recent solve
+};
+
+void LCP_ResetStats( lcpStats_t & stats );
 
 /*
 ====================================================
 LCP_GaussSeidel
 ====================================================
 */
-VecN LCP_GaussSeidel( const MatN & A, const VecN & b );
\ No newline at end of file
+VecN LCP_GaussSeidel( const MatN & A, const VecN & b );
+
+/*
+====================================================
+LCP_LDLT
+
+Solves A * x = b for a symmetric positive semi-definite A.
+Rows whose pivot collapses are treated as inactive and receive a zero solution.
+====================================================
+*/
+VecN LCP_LDLT( const MatN & A, const VecN & b, lcpStats_t * stats = NULL );
+
+/*
+====================================================
+LCP_ProjectedGaussSeidel
+
+Solves A * x = b subject to lo <= x <= hi.
+Stops early once the largest row residual drops below the tolerance.
+====================================================
+*/
+VecN LCP_ProjectedGaussSeidel( const MatN & A, const VecN & b, const VecN & lo, const VecN & hi, const int maxIterations, const float tolerance, lcpStats_t * stats = NULL );
+
+/*
+====================================================
+LCP_Solve
+
+Dispatches to the requested solver.  Bounded solves with the direct solver fall back
+to projected Gauss-Seidel, seeded with the clamped direct solution, when a bound is hit.
+====================================================
+*/
+VecN LCP_Solve( const lcpSolver_t solver, const MatN & A, const VecN & b, lcpStats_t * stats = NULL );
+VecN LCP_Solve( const lcpSolver_t solver, const MatN & A, const VecN & b, const VecN & lo, const VecN & hi, lcpStats_t * stats = NULL );
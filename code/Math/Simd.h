@@ -0,0 +1,74 @@
+//
+//	Simd.h
+//
+#pragma once
+
+/*
+====================================================
+simdFloat_t
+
+A thin wrapper over the widest float vector the target supports.
+AVX2 builds get 8 lanes, everything else that has SSE gets 4 lanes,
+and anything else falls back to plain floats so the code still builds.
+All loads and stores are unaligned.
+====================================================
+*/
+#if defined( __AVX2__ )
+
+#include <immintrin.h>
+#define SIMD_WIDTH 8
+typedef __m256 simdFloat_t;
+
+inline simdFloat_t SimdSet( const float f ) { return _mm256_set1_ps( f ); }
+inline simdFloat_t SimdLoad( const float * src ) { return _mm256_loadu_ps( src ); }
+inline void SimdStore( float * dst, const simdFloat_t a ) { _mm256_storeu_ps( dst, a ); }
+inline simdFloat_t SimdAdd( const simdFloat_t a, const simdFloat_t b ) { return _mm256_add_ps( a, b ); }
+inline simdFloat_t SimdSub( const simdFloat_t a, const simdFloat_t b ) { return _mm256_sub_ps( a, b ); }
+inline simdFloat_t SimdMul( const simdFloat_t a, const simdFloat_t b ) { return _mm256_mul_ps( a, b ); }
+inline simdFloat_t SimdMin( const simdFloat_t a, const simdFloat_t b ) { return _mm256_min_ps( a, b ); }
+inline simdFloat_t SimdMax( const simdFloat_t a, const simdFloat_t b ) { return _mm256_max_ps( a, b ); }
+inline simdFloat_t SimdAbs( const simdFloat_t a ) { return _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), a ); }
+// AVX2 doesn't imply FMA on gcc and clang, -mavx2 alone only gets the separate multiply and add.  MSVC's /arch:AVX2 covers both.
+#if defined( __FMA__ ) || defined( _MSC_VER )
+inline simdFloat_t SimdMadd( const simdFloat_t a, const simdFloat_t b, const simdFloat_t c ) { return _mm256_fmadd_ps( a, b, c ); }
+#else
+inline simdFloat_t SimdMadd( const simdFloat_t a, const simdFloat_t b, const simdFloat_t c ) { return _mm256_add_ps( _mm256_mul_ps( a, b ), c ); }
+#endif
+
+#elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+
+#include <emmintrin.h>
+#define SIMD_WIDTH 4
+typedef __m128 simdFloat_t;
+
+inline simdFloat_t SimdSet( const float f ) { return _mm_set1_ps( f ); }
+inline simdFloat_t SimdLoad( const float * src ) { return _mm_loadu_ps( src ); }
+inline void SimdStore( float * dst, const simdFloat_t a ) { _mm_storeu_ps( dst, a ); }
+inline simdFloat_t SimdAdd( const simdFloat_t a, const simdFloat_t b ) { return _mm_add_ps( a, b ); }
+inline simdFloat_t SimdSub( const simdFloat_t a, const simdFloat_t b ) { return _mm_sub_ps( a, b ); }
+inline simdFloat_t SimdMul( const simdFloat_t a, const simdFloat_t b ) { return _mm_mul_ps( a, b ); }
+inline simdFloat_t SimdMin( const simdFloat_t a, const simdFloat_t b ) { return _mm_min_ps( a, b ); }
+inline simdFloat_t SimdMax( const simdFloat_t a, const simdFloat_t b ) { return _mm_max_ps( a, b ); }
+inline simdFloat_t SimdAbs( const simdFloat_t a ) { return _mm_andnot_ps( _mm_set1_ps( -0.0f ), a ); }
+inline simdFloat_t SimdMadd( const simdFloat_t a, const simdFloat_t b, const simdFloat_t c ) { return _mm_add_ps( _mm_mul_ps( a, b ), c ); }
+
+#else
+
+#include <math.h>
+#define SIMD_WIDTH 4
+struct simdFloat_t {
+	float f[ SIMD_WIDTH ];
+};
+
+inline simdFloat_t SimdSet( const float f ) { simdFloat_t r; for ( int i = 0; i < SIMD_WIDTH; i++ ) { r.f[ i ] = f; } return r; }
+inline simdFloat_t SimdLoad( const float * src ) { simdFloat_t r; for ( int i = 0; i < SIMD_WIDTH; i++ ) { r.f[ i ] = src[ i ]; } return r; }
+inline void SimdStore( float * dst, const simdFloat_t a ) { for ( int i = 0; i < SIMD_WIDTH; i++ ) { dst[ i ] = a.f[ i ]; } }
+inline simdFloat_t SimdAdd( const simdFloat_t a, const simdFloat_t b ) { simdFloat_t r; for ( int i = 0; i < SIMD_WIDTH; i++ ) { r.f[ i ] = a.f[ i ] + b.f[ i ]; } return r; }
+inline simdFloat_t SimdSub( const simdFloat_t a, const simdFloat_t b ) { simdFloat_t r; for ( int i = 0; i < SIMD_WIDTH; i++ ) { r.f[ i ] = a.f[ i ] - b.f[ i ]; } return r; }
+inline simdFloat_t SimdMul( const simdFloat_t a, const simdFloat_t b ) { simdFloat_t r; for ( int i = 0; i < SIMD_WIDTH; i++ ) { r.f[ i ] = a.f[ i ] * b.f[ i ]; } return r; }
+inline simdFloat_t SimdMin( const simdFloat_t a, const simdFloat_t b ) { simdFloat_t r; for ( int i = 0; i < SIMD_WIDTH; i++ ) { r.f[ i ] = ( a.f[ i ] < b.f[ i ] ) ? a.f[ i ] : b.f[ i ]; } return r; }
+inline simdFloat_t SimdMax( const simdFloat_t a, const simdFloat_t b ) { simdFloat_t r; for ( int i = 0; i < SIMD_WIDTH; i++ ) { r.f[ i ] = ( a.f[ i ] > b.f[ i ] ) ? a.f[ i ] : b.f[ i ]; } return r; }
+inline simdFloat_t SimdAbs( const simdFloat_t a ) { simdFloat_t r; for ( int i = 0; i < SIMD_WIDTH; i++ ) { r.f[ i ] = fabsf( a.f[ i ] ); } return r; }
+inline simdFloat_t SimdMadd( const simdFloat_t a, const simdFloat_t b, const simdFloat_t c ) { return SimdAdd( SimdMul( a, b ), c ); }
+
+#endif
@@ -0,0 +1,4 @@
+//
+//  Articulation.cpp
+//
+#include "Articulation.h"
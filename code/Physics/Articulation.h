@@ -0,0 +1,6 @@
+//
+//	Articulation.h
+//
+#pragma once
+#include "Body.h"
+#include "Constraints.h"
@@ -0,0 +1,4 @@
+//
+//  PhysicsStats.cpp
+//
+#include "PhysicsStats.h"
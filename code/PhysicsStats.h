@@ -0,0 +1,5 @@
+//
+//  PhysicsStats.h
+//
+#pragma once
+#include "Scene.h"
@@ -0,0 +1,308 @@
+//
+//	Profiler.cpp
+//
+#include "Profiler.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+static const int PROFILE_BUFFER_SIZE = 1 << 17;	// events per thread, a power of two
+static const int PROFILE_BUFFER_MASK = PROFILE_BUFFER_SIZE - 1;
+static const int PROFILE_MAX_FRAMES = 1024;
+static const int PROFILE_MAX_THREAD_NAME = 32;
+
+struct profileEvent_t {
+	const char * name;
+	long long start;
+	long long end;
+};
+
+// An event in the ring.  A dump may read a slot while its thread is writing it, so the fields are atomics.
+struct profileSlot_t {
+	std::atomic< const char * > name;
+	std::atomic< long long > start;
+	std::atomic< long long > end;
+};
+
+struct profileThread_t {
+	int id;
+	bool isRetired;							// its thread has exited, the next new thread takes it over
+	char name[ PROFILE_MAX_THREAD_NAME ];
+	std::atomic< unsigned long long > numWritten;	// only the owning thread writes it
+	profileSlot_t * events;
+};
+
+/*
+====================================================
+profileThreadSlot_t
+
+The calling thread's buffer.  It's registered on the thread's first event and
+retired when the thread exits.
+====================================================
+*/
+struct profileThreadSlot_t {
+	profileThreadSlot_t() : thread( NULL ) { name[ 0 ] = '\0'; }
+	~profileThreadSlot_t();
+
+	profileThread_t * thread;
+	char name[ PROFILE_MAX_THREAD_NAME ];
+};
+
+std::atomic< bool > g_profilerEnabled( false );
+
+static const std::chrono::steady_clock::time_point g_profilerEpoch = std::chrono::steady_clock::now();
+
+// Taken to register or retire a thread and for dumps, never while recording
+static std::mutex g_profilerLock;
+static std::vector< profileThread_t * > g_profileThreads;
+
+// Only the thread that runs the frames writes these
+static std::atomic< unsigned long long > g_numFrames( 0 );
+static std::atomic< long long > g_frameStarts[ PROFILE_MAX_FRAMES ];
+
+static thread_local profileThreadSlot_t t_profileThread;
+
+/*
+====================================================
+profileThreadSlot_t::~profileThreadSlot_t
+====================================================
+*/
+profileThreadSlot_t::~profileThreadSlot_t() {
+	if ( NULL == thread ) {
+		return;
+	}
+	std::lock_guard< std::mutex > guard( g_profilerLock );
+	thread->isRetired = true;
+}
+
+/*
+====================================================
+RegisterThread
+
+Buffers of threads that have exited are handed to new threads, so a job system
+that's recreated doesn't keep adding buffers.  The old thread's events go with it.
+====================================================
+*/
+static profileThread_t * RegisterThread() {
+	std::lock_guard< std::mutex > guard( g_profilerLock );
+
+	profileThread_t * thread = NULL;
+	for ( int i = 0; i < g_profileThreads.size(); i++ ) {
+		if ( g_profileThreads[ i ]->isRetired ) {
+			thread = g_profileThreads[ i ];
+			break;
+		}
+	}
+
+	if ( NULL == thread ) {
+		thread = new profileThread_t;
+		thread->id = (int)g_profileThreads.size();
+		thread->events = new profileSlot_t[ PROFILE_BUFFER_SIZE ];
+		g_profileThreads.push_back( thread );
+	}
+	thread->isRetired = false;
+	thread->numWritten.store( 0, std::memory_order_relaxed );
+
+	if ( '\0' != t_profileThread.name[ 0 ] ) {
+		strcpy( thread->name, t_profileThread.name );
+	} else {
+		snprintf( thread->name, sizeof( thread->name ), "thread %i", thread->id );
+	}
+
+	t_profileThread.thread = thread;
+	return thread;
+}
+
+/*
+====================================================
+Profiler_SetEnabled
+====================================================
+*/
+void Profiler_SetEnabled( const bool enabled ) {
+	g_profilerEnabled.store( enabled, std::memory_order_relaxed );
+}
+
+/*
+====================================================
+Profiler_IsEnabled
+====================================================
+*/
+bool Profiler_IsEnabled() {
+	return g_profilerEnabled.load( std::memory_order_relaxed );
+}
+
+/*
+====================================================
+Profiler_SetThreadName
+====================================================
+*/
+void Profiler_SetThreadName( const char * name ) {
+	snprintf( t_profileThread.name, sizeof( t_profileThread.name ), "%s", name );
+
+	if ( NULL != t_profileThread.thread ) {
+		std::lock_guard< std::mutex > guard( g_profilerLock );
+		strcpy( t_profileThread.thread->name, t_profileThread.name );
+	}
+}
+
+/*
+====================================================
+Profiler_BeginFrame
+====================================================
+*/
+void Profiler_BeginFrame() {
+	if ( !Profiler_IsEnabled() ) {
+		return;
+	}
+	const unsigned long long frame = g_numFrames.load( std::memory_order_relaxed );
+	g_frameStarts[ frame % PROFILE_MAX_FRAMES ].store( Profiler_Now(), std::memory_order_relaxed );
+	g_numFrames.store( frame + 1, std::memory_order_release );
+}
+
+/*
+====================================================
+Profiler_Now
+====================================================
+*/
+long long Profiler_Now() {
+	return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - g_profilerEpoch ).count();
+}
+
+/*
+====================================================
+Profiler_Record
+====================================================
+*/
+void Profiler_Record( const char * name, const long long start, const long long end ) {
+	profileThread_t * thread = t_profileThread.thread;
+	if ( NULL == thread ) {
+		thread = RegisterThread();
+	}
+
+	const unsigned long long idx = thread->numWritten.load( std::memory_order_relaxed );
+
+	// A dump that sees any of the stores below also sees the count up to idx, see CopyEvents
+	std::atomic_thread_fence( std::memory_order_release );
+
+	profileSlot_t & slot = thread->events[ idx & PROFILE_BUFFER_MASK ];
+	slot.name.store( name, std::memory_order_relaxed );
+	slot.start.store( start, std::memory_order_relaxed );
+	slot.end.store( end, std::memory_order_relaxed );
+	thread->numWritten.store( idx + 1, std::memory_order_release );
+}
+
+/*
+====================================================
+WriteJsonString
+====================================================
+*/
+static void WriteJsonString( FILE * file, const char * str ) {
+	fputc( '"', file );
+	for ( const char * c = str; '\0' != *c; c++ ) {
+		if ( '"' == *c || '\\' == *c ) {
+			fputc( '\\', file );
+		}
+		fputc( *c, file );
+	}
+	fputc( '"', file );
+}
+
+/*
+====================================================
+CopyEvents
+
+Copies out what's in the thread's ring.  The writer keeps going while this
+copies, so anything it may have lapped in the meantime is dropped.
+
+This is a seqlock with the write count as the sequence.  The writer fences
+before filling a slot, so if any field copied here came from a newer lap the
+count read after the acquire fence already covers that lap, and the slot is
+thrown away.  Slots that survive the check hold the event they were copied as.
+====================================================
+*/
+static void CopyEvents( const profileThread_t * thread, std::vector< profileEvent_t > & events ) {
+	events.clear();
+
+	const unsigned long long numWritten = thread->numWritten.load( std::memory_order_acquire );
+	const unsigned long long first = ( numWritten > PROFILE_BUFFER_SIZE ) ? numWritten - PROFILE_BUFFER_SIZE : 0;
+	events.reserve( numWritten - first );
+	for ( unsigned long long i = first; i < numWritten; i++ ) {
+		const profileSlot_t & slot = thread->events[ i & PROFILE_BUFFER_MASK ];
+		profileEvent_t event;
+		event.name = slot.name.load( std::memory_order_relaxed );
+		event.start = slot.start.load( std::memory_order_relaxed );
+		event.end = slot.end.load( std::memory_order_relaxed );
+		events.push_back( event );
+	}
+
+	// The slot being written next belongs to the event PROFILE_BUFFER_SIZE before it
+	std::atomic_thread_fence( std::memory_order_acquire );
+	const unsigned long long numWrittenAfter = thread->numWritten.load( std::memory_order_relaxed );
+	const unsigned long long firstIntact = ( numWrittenAfter >= PROFILE_BUFFER_SIZE ) ? numWrittenAfter - PROFILE_BUFFER_SIZE + 1 : 0;
+	if ( firstIntact > first ) {
+		const unsigned long long numLapped = std::min( firstIntact - first, (unsigned long long)events.size() );
+		events.erase( events.begin(), events.begin() + numLapped );
+	}
+}
+
+/*
+====================================================
+Profiler_WriteChromeTrace
+====================================================
+*/
+bool Profiler_WriteChromeTrace( const char * fileName, const int numFrames ) {
+	FILE * file = fopen( fileName, "w" );
+	if ( NULL == file ) {
+		printf( "ERROR: Unable to open %s for the trace\n", fileName );
+		return false;
+	}
+
+	// Frames older than the frame ring can't be told apart, they're all included
+	const unsigned long long frameCount = g_numFrames.load( std::memory_order_acquire );
+	const unsigned long long oldestFrame = ( frameCount > PROFILE_MAX_FRAMES ) ? frameCount - PROFILE_MAX_FRAMES : 0;
+	unsigned long long firstFrame = oldestFrame;
+	long long startTime = 0;
+	if ( numFrames > 0 && frameCount > (unsigned long long)numFrames ) {
+		firstFrame = std::max( oldestFrame, frameCount - numFrames );
+		startTime = g_frameStarts[ firstFrame % PROFILE_MAX_FRAMES ].load( std::memory_order_relaxed );
+	}
+
+	fprintf( file, "{\"traceEvents\":[\n" );
+	bool isFirst = true;
+
+	std::lock_guard< std::mutex > guard( g_profilerLock );
+	std::vector< profileEvent_t > events;
+	for ( int t = 0; t < g_profileThreads.size(); t++ ) {
+		const profileThread_t * thread = g_profileThreads[ t ];
+
+		fprintf( file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":", isFirst ? "" : ",\n", thread->id );
+		WriteJsonString( file, thread->name );
+		fprintf( file, "}}" );
+		isFirst = false;
+
+		CopyEvents( thread, events );
+		for ( int i = 0; i < events.size(); i++ ) {
+			const profileEvent_t & event = events[ i ];
+			if ( event.start < startTime ) {
+				continue;
+			}
+			fprintf( file, ",\n{\"name\":" );
+			WriteJsonString( file, event.name );
+			fprintf( file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%i}", (double)event.start * 0.001, (double)( event.end - event.start ) * 0.001, thread->id );
+		}
+	}
+
+	// Frame starts go in as global instant events, drawn as lines across every thread
+	for ( unsigned long long frame = firstFrame; frame < frameCount; frame++ ) {
+		const long long frameStart = g_frameStarts[ frame % PROFILE_MAX_FRAMES ].load( std::memory_order_relaxed );
+		fprintf( file, "%s{\"name\":\"frame %llu\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":1,\"tid\":0}", isFirst ? "" : ",\n", frame, (double)frameStart * 0.001 );
+		isFirst = false;
+	}
+
+	fprintf( file, "\n],\"displayTimeUnit\":\"ms\"}\n" );
+	fclose( file );
+	return true;
+}
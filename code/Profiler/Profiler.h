@@ -0,0 +1,78 @@
+//
+//	Profiler.h
+//
+#pragma once
+#include <atomic>
+
+/*
+====================================================
+Profiler
+
+Scoped timing zones for the hot paths.  PROFILE_SCOPE( "name" ) times the rest
+of the enclosing block.  The name must be a string literal, only the pointer
+is kept.
+
+Every thread records into its own ring buffer, which only that thread writes.
+Dumps read behind the writer and drop anything it may have overwritten while
+they were copying, so recording never takes a lock.  A full buffer overwrites
+its oldest events, a dump always holds the most recent ones.
+
+Profiling starts off.  While it's off a zone costs a relaxed load and a branch,
+building with GPW_PROFILER defined to 0 compiles the zones out altogether.
+
+Profiler_WriteChromeTrace writes the buffered events in Chrome's trace_event
+json format, which chrome://tracing and ui.perfetto.dev open.  Nothing here
+depends on the renderer, so it works the same headless.
+====================================================
+*/
+
+#ifndef GPW_PROFILER
+#define GPW_PROFILER 1
+#endif
+
+extern std::atomic< bool > g_profilerEnabled;
+
+void Profiler_SetEnabled( const bool enabled );
+bool Profiler_IsEnabled();
+
+// Names the calling thread in the trace, the name is copied
+void Profiler_SetThreadName( const char * name );
+
+// Marks the start of a frame, so a dump can be limited to the last few
+void Profiler_BeginFrame();
+
+// Nanoseconds since the profiler started
+long long Profiler_Now();
+
+void Profiler_Record( const char * name, const long long start, const long long end );
+
+// Writes the events of the last numFrames frames, or everything buffered if numFrames is zero
+bool Profiler_WriteChromeTrace( const char * fileName, const int numFrames );
+
+/*
+====================================================
+ProfileScope
+====================================================
+*/
+class ProfileScope {
+public:
+	ProfileScope( const char * name ) : m_name( name ), m_start( g_profilerEnabled.load( std::memory_order_relaxed ) ? Profiler_Now() : -1 ) {}
+	~ProfileScope() {
+		if ( m_start >= 0 ) {
+			Profiler_Record( m_name, m_start, Profiler_Now() );
+		}
+	}
+
+private:
+	const char * m_name;
+	long long m_start;	// -1 when profiling was off as the scope started
+};
+
+#define PROFILE_CONCAT_INNER( a, b ) a##b
+#define PROFILE_CONCAT( a, b ) PROFILE_CONCAT_INNER( a, b )
+
+#if GPW_PROFILER
+#define PROFILE_SCOPE( name ) ProfileScope PROFILE_CONCAT( profileScope, __LINE__ )( name )
+#else
+#define PROFILE_SCOPE( name )
+#endif
@@ -0,0 +1,4 @@
+//
+//  Replay.cpp
+//
+#include "Replay.h"
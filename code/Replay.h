@@ -0,0 +1,5 @@
+//
+//  Replay.h
+//
+#pragma once
+#include "Scene.h"
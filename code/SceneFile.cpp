@@ -0,0 +1,4 @@
+//
+//  SceneFile.cpp
+//
+#include "SceneFile.h"
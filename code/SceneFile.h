@@ -0,0 +1,5 @@
+//
+//  SceneFile.h
+//
+#pragma once
+#include "Scene.h"
@@ -16,6 +16,7 @@
 #include "Renderer/OffscreenRenderer.h"
 
 #include "Scene.h"
+#include "Profiler/Profiler.h"
 
 Application * g_application = NULL;
 
@@ -93,6 +94,15 @@ void Application::Initialize() {
 
 	m_isPaused = true;
 	m_stepFrame = false;
+
+	// Start the clock here, the physics thread reads it too
+	GetTimeMicroseconds();
+
+	// Give the renderer the starting transforms, then hand the scene over to the physics thread
+	CaptureTransforms( m_previousBodies );
+	PublishSnapshot( 0, 0, 0.0f, 0.0f, 0.0f );
+	m_isPhysicsRunning = true;
+	m_physicsThread = std::thread( &Application::PhysicsMain, this );
 }
 
 /*
@@ -285,6 +295,12 @@ void Application::Cleanup() {
 	m_copyPipeline.Cleanup( &m_deviceContext );
 	m_modelFullScreen.Cleanup( m_deviceContext );
 
+	// Stop the physics thread before the scene goes away
+	if ( m_physicsThread.joinable() ) {
+		m_isPhysicsRunning = false;
+		m_physicsThread.join();
+	}
+
 	// Delete the screen so that it can clean itself up
 	delete m_scene;
 	m_scene = NULL;
@@ -429,7 +445,7 @@ Application::Keyboard
 */
 void Application::Keyboard( int key, int scancode, int action, int modifiers ) {
 	if ( GLFW_KEY_R == key && GLFW_RELEASE == action ) {
-		m_scene->Reset();
+		m_resetScene = true;
 	}
 	if ( GLFW_KEY_T == key && GLFW_RELEASE == action ) {
 		m_isPaused = !m_isPaused;
@@ -437,6 +453,18 @@ void Application::Keyboard( int key, int scancode, int action, int modifiers ) {
 	if ( GLFW_KEY_Y == key && ( GLFW_PRESS == action || GLFW_REPEAT == action ) ) {
 		m_stepFrame = m_isPaused && !m_stepFrame;
 	}
+	if ( GLFW_KEY_O == key && GLFW_RELEASE == action ) {
+		m_showStats = !m_showStats;
+	}
+	if ( GLFW_KEY_P == key && GLFW_RELEASE == action ) {
+		// The first press starts a capture, the second writes it out
+		if ( !Profiler_IsEnabled() ) {
+			Profiler_SetEnabled( true );
+		} else {
+			Profiler_SetEnabled( false );
+			Profiler_WriteChromeTrace( "profile.json", 0 );
+		}
+	}
 }
 
 /*
@@ -445,49 +473,79 @@ Application::MainLoop
 ====================================================
 */
 void Application::MainLoop() {
-	static int timeLastFrame = 0;
-	static int numSamples = 0;
-	static float avgTime = 0.0f;
-	static float maxTime = 0.0f;
-
+	Profiler_SetThreadName( "main" );
 	while ( !glfwWindowShouldClose( m_glfwWindow ) ) {
-		int time					= GetTimeMicroseconds();
-		float dt_us					= (float)time - (float)timeLastFrame;
-		if ( dt_us < 16000.0f ) {
-			int x = 16000 - (int)dt_us;
-			std::this_thread::sleep_for( std::chrono::microseconds( x ) );
-			dt_us = 16000;
-			time = GetTimeMicroseconds();
-		}
-		timeLastFrame = time;
-		printf( "\ndt_ms: %.1f    ", dt_us * 0.001f );
+		Profiler_BeginFrame();
 
 		// Get User Input
 		glfwPollEvents();
 
-		// If the time is greater than 33ms (30fps)
-		// then force the time difference to smaller
-		// to prevent super large simulation steps.
-		if ( dt_us > 33000.0f ) {
-			dt_us = 33000.0f;
+		// Pick up the newest transforms, if the physics thread has published any since the last frame
+		if ( m_snapshots.Consume() ) {
+			const physicsSnapshot_t & snapshot = m_snapshots.GetFront();
+			if ( snapshot.numSteps > 0 ) {
+				printf( "\nframe dt_ms: %.2f %.2f %.2f", snapshot.avgStepTimeMs, snapshot.maxStepTimeMs, snapshot.stepTimeMs );
+			}
+			if ( snapshot.numSteps > 0 && '\0' != snapshot.stats[ 0 ] ) {
+				printf( "\n%s", snapshot.stats );
+			}
+		}
+
+		// Draw the Scene
+		DrawFrame();
+	}
+}
+
+/*
+====================================================
+Application::PhysicsMain
+
+Banks the elapsed time and runs as many fixed steps as it covers, so the
+scene always sees the same dt no matter how unevenly the thread gets
+scheduled.  A tick runs at most MAX_PHYSICS_STEPS_PER_TICK steps.  Any
+backlog past that is dropped, because catching up would make the next
+tick even later.
+====================================================
+*/
+void Application::PhysicsMain() {
+	int numSamples = 0;
+	float avgTime = 0.0f;
+	float maxTime = 0.0f;
+
+	Profiler_SetThreadName( "physics" );
+
+	int timeLastTick = GetTimeMicroseconds();
+	int accumulatorUs = 0;
+	while ( m_isPhysicsRunning ) {
+		const int time = GetTimeMicroseconds();
+		accumulatorUs += time - timeLastTick;
+		timeLastTick = time;
+
+		if ( m_resetScene.exchange( false ) ) {
+			m_scene->Reset();
+
+			// Nothing to blend from after a reset
+			CaptureTransforms( m_previousBodies );
 		}
 
-		bool runPhysics = true;
 		if ( m_isPaused ) {
-			dt_us = 0.0f;
-			runPhysics = false;
-			if ( m_stepFrame ) {
-				dt_us = 16667.0f;
-				m_stepFrame = false;
-				runPhysics = true;
+			// Time stands still while paused, stepping a frame runs exactly one fixed step
+			const bool stepFrame = m_stepFrame.exchange( false );
+			accumulatorUs = stepFrame ? PHYSICS_STEP_US : 0;
+			if ( !stepFrame ) {
+				CaptureTransforms( m_previousBodies );
 			}
 			numSamples = 0;
 			maxTime = 0.0f;
 		}
-		float dt_sec = dt_us * 0.001f * 0.001f;
 
 		// Run Update
-		if ( runPhysics ) {
+		const float dt_sec = (float)PHYSICS_STEP_US * 0.001f * 0.001f;
+		float dt_us = 0.0f;
+		int numSteps = 0;
+		while ( accumulatorUs >= PHYSICS_STEP_US && numSteps < MAX_PHYSICS_STEPS_PER_TICK ) {
+			CaptureTransforms( m_previousBodies );
+
 			int startTime = GetTimeMicroseconds();
 			for ( int i = 0; i < 2; i++ ) {
 				m_scene->Update( dt_sec * 0.5f );
@@ -502,14 +560,90 @@ void Application::MainLoop() {
 			avgTime = ( avgTime * float( numSamples ) + dt_us ) / float( numSamples + 1 );
 			numSamples++;
 
-			printf( "frame dt_ms: %.2f %.2f %.2f", avgTime * 0.001f, maxTime * 0.001f, dt_us * 0.001f );
+			accumulatorUs -= PHYSICS_STEP_US;
+			numSteps++;
 		}
 
-		// Draw the Scene
-		DrawFrame();
+		// Over budget, keep only the partial step
+		if ( accumulatorUs >= PHYSICS_STEP_US ) {
+			accumulatorUs %= PHYSICS_STEP_US;
+		}
+
+		PublishSnapshot( numSteps, accumulatorUs, dt_us * 0.001f, avgTime * 0.001f, maxTime * 0.001f );
+
+		// Sleep until there's another whole step banked
+		std::this_thread::sleep_for( std::chrono::microseconds( PHYSICS_STEP_US - accumulatorUs ) );
 	}
 }
 
+/*
+====================================================
+Application::CaptureTransforms
+====================================================
+*/
+void Application::CaptureTransforms( std::vector< bodyTransform_t > & transforms ) const {
+	transforms.resize( m_scene->m_bodies.size() );
+	for ( int i = 0; i < m_scene->m_bodies.size(); i++ ) {
+		const Body & body = m_scene->m_bodies[ i ];
+		transforms[ i ].position = body.m_position;
+		transforms[ i ].orientation = body.m_orientation;
+	}
+}
+
+/*
+====================================================
+Application::PublishSnapshot
+====================================================
+*/
+void Application::PublishSnapshot( const int numSteps, const int accumulatorUs, const float stepTimeMs, const float avgStepTimeMs, const float maxStepTimeMs ) {
+	physicsSnapshot_t & snapshot = m_snapshots.GetBack();
+
+	CaptureTransforms( snapshot.bodies );
+	snapshot.previousBodies = m_previousBodies;
+
+	snapshot.publishTime = GetTimeMicroseconds();
+	snapshot.accumulatorUs = accumulatorUs;
+	snapshot.numSteps = numSteps;
+	snapshot.stepTimeMs = stepTimeMs;
+	snapshot.avgStepTimeMs = avgStepTimeMs;
+	snapshot.maxStepTimeMs = maxStepTimeMs;
+
+	// Only the completed scene keeps stats
+	snapshot.stats[ 0 ] = '\0';
+#if defined( PHYSICS_STATS_AVAILABLE )
+	if ( m_showStats ) {
+		m_scene->m_stats.Print( snapshot.stats, sizeof( snapshot.stats ) );
+	}
+#endif
+
+	m_snapshots.Publish();
+}
+
+/*
+====================================================
+InterpolateTransform
+
+Blends two transforms, normalized lerp for the orientation
+====================================================
+*/
+static bodyTransform_t InterpolateTransform( const bodyTransform_t & from, const bodyTransform_t & to, const float t ) {
+	// q and -q are the same rotation, blend towards whichever is closer
+	Quat orientTo = to.orientation;
+	const float dot = from.orientation.x * orientTo.x + from.orientation.y * orientTo.y + from.orientation.z * orientTo.z + from.orientation.w * orientTo.w;
+	if ( dot < 0.0f ) {
+		orientTo *= -1.0f;
+	}
+
+	bodyTransform_t transform;
+	transform.position = from.position + ( to.position - from.position ) * t;
+	transform.orientation.x = from.orientation.x + ( orientTo.x - from.orientation.x ) * t;
+	transform.orientation.y = from.orientation.y + ( orientTo.y - from.orientation.y ) * t;
+	transform.orientation.z = from.orientation.z + ( orientTo.z - from.orientation.z ) * t;
+	transform.orientation.w = from.orientation.w + ( orientTo.w - from.orientation.w ) * t;
+	transform.orientation.Normalize();
+	return transform;
+}
+
 /*
 ====================================================
 Application::UpdateUniforms
@@ -614,16 +748,20 @@ void Application::UpdateUniforms() {
 		}
 
 		//
-		//	Update the uniform buffer with the body positions/orientations
+		//	Update the uniform buffer with the body positions/orientations, blended between the
+		//	newest snapshot's last two fixed steps by how much time has passed since
 		//
-		for ( int i = 0; i < m_scene->m_bodies.size(); i++ ) {
-			Body & body = m_scene->m_bodies[ i ];
+		const physicsSnapshot_t & snapshot = m_snapshots.GetFront();
+		float alpha = (float)( snapshot.accumulatorUs + GetTimeMicroseconds() - snapshot.publishTime ) / (float)PHYSICS_STEP_US;
+		alpha = ( alpha < 0.0f ) ? 0.0f : ( ( alpha > 1.0f ) ? 1.0f : alpha );
+		for ( int i = 0; i < snapshot.bodies.size() && i < m_models.size(); i++ ) {
+			const bodyTransform_t body = InterpolateTransform( snapshot.previousBodies[ i ], snapshot.bodies[ i ], alpha );
 
-			Vec3 fwd = body.m_orientation.RotatePoint( Vec3( 1, 0, 0 ) );
-			Vec3 up = body.m_orientation.RotatePoint( Vec3( 0, 0, 1 ) );
+			Vec3 fwd = body.orientation.RotatePoint( Vec3( 1, 0, 0 ) );
+			Vec3 up = body.orientation.RotatePoint( Vec3( 0, 0, 1 ) );
 
 			Mat4 matOrient;
-			matOrient.Orient( body.m_position, fwd, up );
+			matOrient.Orient( body.position, fwd, up );
 			matOrient = matOrient.Transpose();
 
 			// Update the uniform buffer with the orientation of this body
@@ -633,8 +771,8 @@ void Application::UpdateUniforms() {
 			renderModel.model = m_models[ i ];
 			renderModel.uboByteOffset = uboByteOffset;
 			renderModel.uboByteSize = sizeof( matOrient );
-			renderModel.pos = body.m_position;
-			renderModel.orient = body.m_orientation;
+			renderModel.pos = body.position;
+			renderModel.orient = body.orientation;
 			m_renderModels.push_back( renderModel );
 
 			uboByteOffset += m_deviceContext.GetAligendUniformByteOffset( sizeof( matOrient ) );
@@ -650,6 +788,8 @@ Application::DrawFrame
 ====================================================
 */
 void Application::DrawFrame() {
+	PROFILE_SCOPE( "Application::DrawFrame" );
+
 	UpdateUniforms();
 
 	//
@@ -8,25 +8,58 @@
 #include <stdlib.h>
 #include <string>
 #include <vector>
+#include <atomic>
+#include <thread>
 
 #include "Math/Vector.h"
 #include "Math/Quat.h"
 #include "Physics/Shapes.h"
 #include "Physics/Body.h"
+#include "Jobs/TripleBuffer.h"
 
 #include "Renderer/DeviceContext.h"
 #include "Renderer/model.h"
 #include "Renderer/shader.h"
 #include "Renderer/FrameBuffer.h"
 
+/*
+====================================================
+physicsSnapshot_t
+
+What the physics thread publishes for the renderer after each tick.  The
+renderer blends from previousBodies to bodies by how far the wall clock has
+got into the next fixed step.
+====================================================
+*/
+struct bodyTransform_t {
+	Vec3 position;
+	Quat orientation;
+};
+
+struct physicsSnapshot_t {
+	std::vector< bodyTransform_t > bodies;
+	std::vector< bodyTransform_t > previousBodies;	// one fixed step before bodies
+	int publishTime;		// GetTimeMicroseconds when this was published
+	int accumulatorUs;		// time already banked towards the next step when this was published
+	int numSteps;			// fixed steps run this tick
+	float stepTimeMs;		// time the last Scene::Update took
+	float avgStepTimeMs;
+	float maxStepTimeMs;
+	char stats[ 2048 ];		// the scene's engine counters when they're shown, otherwise empty
+};
+
 /*
 ====================================================
 Application
+
+The scene runs on its own thread with a fixed timestep and publishes the
+body transforms through a triple buffer.  The main thread handles input and
+draws whatever snapshot is newest, so neither side waits on the other.
 ====================================================
 */
 class Application {
 public:
-	Application() : m_isPaused( true ), m_stepFrame( false ) {}
+	Application() : m_isPhysicsRunning( false ), m_resetScene( false ), m_isPaused( true ), m_stepFrame( false ), m_showStats( false ) {}
 	~Application();
 
 	void Initialize();
@@ -38,6 +71,9 @@ private:
 	void InitializeGLFW();
 	bool InitializeVulkan();
 	void Cleanup();
+	void PhysicsMain();
+	void CaptureTransforms( std::vector< bodyTransform_t > & transforms ) const;
+	void PublishSnapshot( const int numSteps, const int accumulatorUs, const float stepTimeMs, const float avgStepTimeMs, const float maxStepTimeMs );
 	void UpdateUniforms();
 	void DrawFrame();
 	void ResizeWindow( int windowWidth, int windowHeight );
@@ -51,7 +87,13 @@ private:
 	static void OnKeyboard( GLFWwindow * window, int key, int scancode, int action, int modifiers );
 
 private:
-	class Scene * m_scene;
+	class Scene * m_scene;	// owned by the physics thread once it has started
+
+	std::thread m_physicsThread;
+	std::atomic< bool > m_isPhysicsRunning;
+	std::atomic< bool > m_resetScene;	// set by the main thread, the physics thread resets the scene
+	TripleBuffer< physicsSnapshot_t > m_snapshots;
+	std::vector< bodyTransform_t > m_previousBodies;	// physics thread only, the transforms before the last step
 
 	GLFWwindow * m_glfwWindow;
 
@@ -81,14 +123,18 @@ private:
 	float m_cameraPositionTheta;
 	float m_cameraPositionPhi;
 	float m_cameraRadius;
-	bool m_isPaused;
-	bool m_stepFrame;
+	std::atomic< bool > m_isPaused;
+	std::atomic< bool > m_stepFrame;
+	std::atomic< bool > m_showStats;
 
 	std::vector< RenderModel > m_renderModels;
 
 	static const int WINDOW_WIDTH = 1200;
 	static const int WINDOW_HEIGHT = 720;
 
+	static const int PHYSICS_STEP_US = 16667;	// the physics thread runs at 60hz
+	static const int MAX_PHYSICS_STEPS_PER_TICK = 4;	// past this the physics thread drops time instead of falling further behind
+
 	static const bool m_enableLayers = true;
 };
 
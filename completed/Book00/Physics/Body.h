@@ -8,9 +8,6 @@
 #include "../Math/Bounds.h"
 #include "Shapes.h"
 
-#include "../Renderer/model.h"
-#include "../Renderer/shader.h"
-
 /*
 ====================================================
 Body
@@ -2,6 +2,7 @@
 //  GJK.cpp
 //
 #include "GJK.h"
+#include <string.h>
 
 struct point_t;
 float EPA_Expand( const Body * bodyA, const Body * bodyB, const float bias, const point_t simplexPoints[ 4 ], Vec3 & ptOnA, Vec3 & ptOnB );
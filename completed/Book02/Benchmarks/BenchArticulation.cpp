@@ -0,0 +1,134 @@
+//
+//  BenchArticulation.cpp
+//
+//	Compares a long hinge chain solved with the iterative joint constraints
+//	against the same chain stepped as a reduced coordinate articulation.
+//	The chain starts horizontal and swings down under gravity, the report
+//	gives the time per step and how far the joints pulled apart.
+//
+#include "../Scene.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+/*
+====================================================
+BuildChain
+====================================================
+*/
+static void BuildChain( Scene & scene, const int numLinks, std::vector< ConstraintHingeQuat > & joints ) {
+	scene.m_bodies.reserve( numLinks + 1 );
+
+	// Fixed anchor the first link hangs from
+	Body body;
+	body.m_position = Vec3( 0, 0, 60 );
+	body.m_orientation = Quat( 0, 0, 0, 1 );
+	body.m_linearVelocity.Zero();
+	body.m_angularVelocity.Zero();
+	body.m_invMass = 0.0f;
+	body.m_elasticity = 0.5f;
+	body.m_friction = 0.5f;
+	body.m_shape = new ShapeSphere( 0.3f );
+	scene.m_bodies.push_back( body );
+
+	const float spacing = 1.0f;
+	for ( int i = 0; i < numLinks; i++ ) {
+		body.m_position = Vec3( (float)( i + 1 ) * spacing, 0, 60 );
+		body.m_invMass = 1.0f;
+		body.m_shape = new ShapeSphere( 0.3f );
+		scene.m_bodies.push_back( body );
+	}
+
+	for ( int i = 0; i < numLinks; i++ ) {
+		ConstraintHingeQuat joint;
+		joint.m_bodyA = &scene.m_bodies[ i ];
+		joint.m_bodyB = &scene.m_bodies[ i + 1 ];
+
+		const Vec3 jointWorldSpaceAnchor = ( joint.m_bodyA->m_position + joint.m_bodyB->m_position ) * 0.5f;
+		joint.m_anchorA = joint.m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+		joint.m_anchorB = joint.m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+
+		const Vec3 jointWorldSpaceAxis = Vec3( 0, 1, 0 );
+		joint.m_axisA = joint.m_bodyA->m_orientation.Inverse().RotatePoint( jointWorldSpaceAxis );
+		joint.m_axisB = joint.m_bodyB->m_orientation.Inverse().RotatePoint( jointWorldSpaceAxis );
+
+		joint.q0 = joint.m_bodyA->m_orientation.Inverse() * joint.m_bodyB->m_orientation;
+		joints.push_back( joint );
+	}
+}
+
+/*
+====================================================
+GetMaxJointError
+====================================================
+*/
+static float GetMaxJointError( const std::vector< ConstraintHingeQuat > & joints ) {
+	float maxError = 0.0f;
+	for ( int i = 0; i < joints.size(); i++ ) {
+		const Vec3 anchorA = joints[ i ].m_bodyA->BodySpaceToWorldSpace( joints[ i ].m_anchorA );
+		const Vec3 anchorB = joints[ i ].m_bodyB->BodySpaceToWorldSpace( joints[ i ].m_anchorB );
+		const float error = ( anchorB - anchorA ).GetMagnitude();
+		maxError = ( error > maxError ) ? error : maxError;
+	}
+	return maxError;
+}
+
+/*
+====================================================
+RunChain
+====================================================
+*/
+static void RunChain( const int numLinks, const int numSteps, const bool useArticulation ) {
+	Scene scene;
+	std::vector< ConstraintHingeQuat > joints;
+	BuildChain( scene, numLinks, joints );
+
+	if ( useArticulation ) {
+		Articulation * articulation = new Articulation();
+		for ( int i = 0; i < joints.size(); i++ ) {
+			articulation->AddJoint( joints[ i ] );
+		}
+		if ( !articulation->Finalize() ) {
+			printf( "articulation: failed to build the tree\n" );
+			delete articulation;
+			return;
+		}
+		scene.m_articulations.push_back( articulation );
+	} else {
+		for ( int i = 0; i < joints.size(); i++ ) {
+			scene.m_constraints.push_back( new ConstraintHingeQuat( joints[ i ] ) );
+		}
+	}
+
+	float maxError = 0.0f;
+	double elapsed = 0.0;
+	for ( int i = 0; i < numSteps; i++ ) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		scene.Update( 1.0f / 60.0f );
+		const auto end = std::chrono::high_resolution_clock::now();
+		elapsed += std::chrono::duration< double, std::milli >( end - start ).count();
+
+		const float error = GetMaxJointError( joints );
+		maxError = ( error > maxError ) ? error : maxError;
+	}
+
+	const Vec3 tip = scene.m_bodies.back().m_position;
+	printf( "%-12s %8.3f ms per step   max joint error %8.4f   final error %8.4f   tip ( %.2f %.2f %.2f )\n",
+		useArticulation ? "articulation" : "iterative",
+		elapsed / (double)numSteps, maxError, GetMaxJointError( joints ), tip.x, tip.y, tip.z );
+}
+
+/*
+====================================================
+main
+====================================================
+*/
+int main( int argc, char * argv[] ) {
+	const int numLinks = ( argc > 1 ) ? atoi( argv[ 1 ] ) : 50;
+	const int numSteps = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 300;
+
+	printf( "links: %i  steps: %i\n", numLinks, numSteps );
+	RunChain( numLinks, numSteps, false );
+	RunChain( numLinks, numSteps, true );
+	return 0;
+}
@@ -0,0 +1,235 @@
+//
+//  BenchContactSolver.cpp
+//
+//	Micro benchmark for the contact solver modes.  Builds a 1000 box stack,
+//	lets it settle, then times the solver iterations alone on the same
+//	contact set with the scalar, SIMD batched and block contact solvers.
+//
+//	Then runs single columns of boxes for 15 seconds with each solver and a
+//	few iteration counts, to show how many iterations each needs to keep
+//	a tall stack standing.
+//
+#include "../Scene.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+/*
+====================================================
+BuildBoxStack
+====================================================
+*/
+static void BuildBoxStack( Scene & scene, const int numBoxes ) {
+	scene.m_bodies.reserve( numBoxes + 1 );
+
+	Body body;
+	body.m_position = Vec3( 0, 0, 0 );
+	body.m_orientation = Quat( 0, 0, 0, 1 );
+	body.m_linearVelocity.Zero();
+	body.m_angularVelocity.Zero();
+	body.m_invMass = 0.0f;
+	body.m_elasticity = 0.5f;
+	body.m_friction = 0.5f;
+	body.m_shape = new ShapeBox( g_boxGround, sizeof( g_boxGround ) / sizeof( Vec3 ) );
+	scene.m_bodies.push_back( body );
+
+	// 10 x 10 columns, as tall as they need to be
+	const int numColumns = 10;
+	const float delta = 0.04f;
+	const float scaleHeight = 2.0f + delta;
+	const float deltaHeight = 1.0f + delta;
+	for ( int i = 0; i < numBoxes; i++ ) {
+		const int x = i % numColumns;
+		const int y = ( i / numColumns ) % numColumns;
+		const int z = i / ( numColumns * numColumns );
+
+		body.m_position = Vec3( ( (float)x - 4.5f ) * scaleHeight * 1.1f, ( (float)y - 4.5f ) * scaleHeight * 1.1f, deltaHeight + (float)z * scaleHeight );
+		body.m_orientation = Quat( 0, 0, 0, 1 );
+		body.m_linearVelocity.Zero();
+		body.m_angularVelocity.Zero();
+		body.m_shape = new ShapeBox( g_boxUnit, sizeof( g_boxUnit ) / sizeof( Vec3 ) );
+		body.m_invMass = 1.0f;
+		body.m_elasticity = 0.5f;
+		body.m_friction = 0.5f;
+		scene.m_bodies.push_back( body );
+	}
+}
+
+/*
+====================================================
+TimeContactSolver
+====================================================
+*/
+static double TimeContactSolver( Scene & scene, const contactSolverMode_t mode, const int numRepeats, double & velocitySum ) {
+	// Every repeat starts from the same velocities
+	std::vector< Vec3 > linearVelocities( scene.m_bodies.size() );
+	std::vector< Vec3 > angularVelocities( scene.m_bodies.size() );
+	for ( int i = 0; i < scene.m_bodies.size(); i++ ) {
+		linearVelocities[ i ] = scene.m_bodies[ i ].m_linearVelocity;
+		angularVelocities[ i ] = scene.m_bodies[ i ].m_angularVelocity;
+	}
+
+	ManifoldCollector collector = scene.m_manifolds;
+	collector.m_solverMode = mode;
+
+	SolverBodies solverBodies;
+	double elapsed = 0.0;
+	for ( int repeat = 0; repeat < numRepeats; repeat++ ) {
+		for ( int i = 0; i < scene.m_bodies.size(); i++ ) {
+			scene.m_bodies[ i ].m_linearVelocity = linearVelocities[ i ];
+			scene.m_bodies[ i ].m_angularVelocity = angularVelocities[ i ];
+		}
+
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		solverBodies.Gather( scene.m_bodies.data(), (int)scene.m_bodies.size() );
+		collector.SetSolverBodies( &solverBodies );
+		const int maxIters = 5;
+		for ( int iters = 0; iters < maxIters; iters++ ) {
+			collector.Solve();
+		}
+		collector.SetSolverBodies( NULL );
+		solverBodies.Scatter( scene.m_bodies.data(), (int)scene.m_bodies.size() );
+
+		const auto end = std::chrono::high_resolution_clock::now();
+		elapsed += std::chrono::duration< double, std::milli >( end - start ).count();
+	}
+
+	velocitySum = 0.0;
+	for ( int i = 0; i < scene.m_bodies.size(); i++ ) {
+		velocitySum += scene.m_bodies[ i ].m_linearVelocity.GetMagnitude();
+		scene.m_bodies[ i ].m_linearVelocity = linearVelocities[ i ];
+		scene.m_bodies[ i ].m_angularVelocity = angularVelocities[ i ];
+	}
+
+	return elapsed / (double)numRepeats;
+}
+
+/*
+====================================================
+stackResult_t
+====================================================
+*/
+struct stackResult_t {
+	float maxSink;		// furthest any box got below its resting height
+	float topHeight;	// where the top box ended up, it rests at twice the number of boxes less one
+	int droppedPivots;	// by the block solver
+};
+
+/*
+====================================================
+RunStack
+
+A single column of unit boxes resting on the ground
+====================================================
+*/
+static void RunStack( const contactSolverMode_t mode, const int numBoxes, const int numIterations, const int numFrames, stackResult_t & result ) {
+	Scene scene;
+	scene.m_numSolverIterations = numIterations;
+	scene.m_manifolds.m_solverMode = mode;
+
+	Body body;
+	body.m_position = Vec3( 0, 0, 0 );
+	body.m_orientation = Quat( 0, 0, 0, 1 );
+	body.m_linearVelocity.Zero();
+	body.m_angularVelocity.Zero();
+	body.m_invMass = 0.0f;
+	body.m_elasticity = 0.5f;
+	body.m_friction = 0.5f;
+	body.m_shape = new ShapeBox( g_boxGround, sizeof( g_boxGround ) / sizeof( Vec3 ) );
+	scene.m_bodies.push_back( body );
+
+	for ( int i = 0; i < numBoxes; i++ ) {
+		body.m_position = Vec3( 0, 0, 1.0f + 2.0f * (float)i );
+		body.m_invMass = 1.0f;
+		body.m_shape = new ShapeBox( g_boxUnit, sizeof( g_boxUnit ) / sizeof( Vec3 ) );
+		scene.m_bodies.push_back( body );
+	}
+
+	result.maxSink = 0.0f;
+	for ( int frame = 0; frame < numFrames; frame++ ) {
+		scene.Update( 1.0f / 60.0f );
+
+		for ( int i = 0; i < numBoxes; i++ ) {
+			const float sink = 1.0f + 2.0f * (float)i - scene.m_bodies[ i + 1 ].m_position.z;
+			result.maxSink = ( sink > result.maxSink ) ? sink : result.maxSink;
+		}
+	}
+	result.topHeight = scene.m_bodies.back().m_position.z;
+	result.droppedPivots = scene.m_manifolds.m_blockStats.droppedPivots;
+}
+
+/*
+====================================================
+RunStacks
+====================================================
+*/
+static void RunStacks() {
+	const contactSolverMode_t modes[ 3 ] = { CONTACT_SOLVER_SCALAR, CONTACT_SOLVER_SIMD, CONTACT_SOLVER_BLOCK };
+	const char * modeNames[ 3 ] = { "scalar", "simd", "block" };
+	const int stackSizes[] = { 8, 12, 16 };
+	const int iterationCounts[] = { 2, 4, 6, 8 };
+	const int numStackSizes = (int)( sizeof( stackSizes ) / sizeof( int ) );
+	const int numIterationCounts = (int)( sizeof( iterationCounts ) / sizeof( int ) );
+	const int numFrames = 900;
+
+	printf( "\nstacks, %i frames at 60hz\n", numFrames );
+	printf( "%6s %6s %-8s %10s %10s %8s\n", "boxes", "iters", "solver", "max sink", "top z", "dropped" );
+	for ( int s = 0; s < numStackSizes; s++ ) {
+		for ( int i = 0; i < numIterationCounts; i++ ) {
+			for ( int m = 0; m < 3; m++ ) {
+				stackResult_t result;
+				RunStack( modes[ m ], stackSizes[ s ], iterationCounts[ i ], numFrames, result );
+
+				// A box that's sunk by half its height has been pushed through or the stack toppled
+				const float restHeight = 2.0f * (float)stackSizes[ s ] - 1.0f;
+				const bool isStanding = ( restHeight - result.topHeight ) < 1.0f;
+				printf( "%6i %6i %-8s %10.3f %10.3f %8i  %s\n", stackSizes[ s ], iterationCounts[ i ], modeNames[ m ],
+					result.maxSink, result.topHeight, result.droppedPivots, isStanding ? "" : "fell" );
+			}
+		}
+	}
+}
+
+/*
+====================================================
+main
+====================================================
+*/
+int main( int argc, char * argv[] ) {
+	const int numBoxes = ( argc > 1 ) ? atoi( argv[ 1 ] ) : 1000;
+	const int numSettleSteps = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 60;
+	const int numRepeats = ( argc > 3 ) ? atoi( argv[ 3 ] ) : 50;
+
+	Scene scene;
+	BuildBoxStack( scene, numBoxes );
+
+	// Let the stack come to rest so there's a full set of contacts to solve
+	for ( int i = 0; i < numSettleSteps; i++ ) {
+		scene.Update( 1.0f / 60.0f );
+	}
+
+	int numContacts = 0;
+	for ( int i = 0; i < scene.m_manifolds.GetNumManifolds(); i++ ) {
+		numContacts += scene.m_manifolds.GetManifold( i ).GetNumContacts();
+	}
+	printf( "boxes: %i  manifolds: %i  contacts: %i  simd width: %i\n", numBoxes, scene.m_manifolds.GetNumManifolds(), numContacts, SIMD_WIDTH );
+
+	// Prepare the constraints once, both modes then solve the same system
+	scene.m_manifolds.PreSolve( 1.0f / 60.0f );
+
+	double sumScalar = 0.0;
+	double sumSimd = 0.0;
+	double sumBlock = 0.0;
+	const double msScalar = TimeContactSolver( scene, CONTACT_SOLVER_SCALAR, numRepeats, sumScalar );
+	const double msSimd = TimeContactSolver( scene, CONTACT_SOLVER_SIMD, numRepeats, sumSimd );
+	const double msBlock = TimeContactSolver( scene, CONTACT_SOLVER_BLOCK, numRepeats, sumBlock );
+
+	printf( "scalar: %8.3f ms per solve  ( |v| sum %.4f )\n", msScalar, sumScalar );
+	printf( "simd:   %8.3f ms per solve  ( |v| sum %.4f )\n", msSimd, sumSimd );
+	printf( "block:  %8.3f ms per solve  ( |v| sum %.4f )\n", msBlock, sumBlock );
+	printf( "simd speedup: %.2fx\n", msScalar / msSimd );
+
+	RunStacks();
+	return 0;
+}
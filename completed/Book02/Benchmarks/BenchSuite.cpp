@@ -0,0 +1,400 @@
+//
+//  BenchSuite.cpp
+//
+//	Standard benchmark scenes for regression tracking.  Runs each scene for a
+//	fixed number of steps and reports the time spent in each phase of the
+//	update along with the pair and contact counts, as a table, CSV or JSON.
+//
+//	bench_suite [table | csv | json] [steps] [scene[:size] ...]
+//
+//	The scenes are the ones the books build ( spheres, diamonds, demo ) and
+//	the stress variants ( pyramid, ragdolls, hullrain ), whose size sets how
+//	many boxes, ragdolls or hulls they hold.
+//
+#include "../Scene.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+typedef void ( *buildScene_t )( Scene & scene, const int size );
+
+struct benchScene_t {
+	const char * name;
+	buildScene_t build;
+	int defaultSize;	// zero for the scenes that don't scale
+};
+
+struct benchResult_t {
+	std::string name;
+	int size;
+	int numBodies;
+	int numJoints;
+	int numSteps;
+	double phaseMs[ NUM_SCENE_PHASES ];	// average per step
+	double updateMs;					// average per step
+	double worstUpdateMs;
+	double avgPairs;
+	double avgContacts;
+	int maxContacts;
+	unsigned long long stateHash;
+};
+
+/*
+====================================================
+AddBody
+====================================================
+*/
+static void AddBody( Scene & scene, Shape * shape, const Vec3 & pos, const float invMass, const float elasticity, const float friction ) {
+	Body body;
+	body.m_position = pos;
+	body.m_orientation = Quat( 0, 0, 0, 1 );
+	body.m_linearVelocity.Zero();
+	body.m_angularVelocity.Zero();
+	body.m_invMass = invMass;
+	body.m_elasticity = elasticity;
+	body.m_friction = friction;
+	body.m_shape = shape;
+	scene.m_bodies.push_back( body );
+}
+
+/*
+====================================================
+BuildSpheres
+
+The first book's scene, a grid of spheres dropped onto a floor of huge spheres
+====================================================
+*/
+static void BuildSpheres( Scene & scene, const int size ) {
+	const float radius = 0.5f;
+	for ( int x = 0; x < 6; x++ ) {
+		for ( int y = 0; y < 6; y++ ) {
+			const Vec3 pos( float( x - 1 ) * radius * 1.5f, float( y - 1 ) * radius * 1.5f, 10.0f );
+			AddBody( scene, new ShapeSphere( radius ), pos, 1.0f, 0.5f, 0.5f );
+		}
+	}
+
+	const float floorRadius = 80.0f;
+	for ( int x = 0; x < 3; x++ ) {
+		for ( int y = 0; y < 3; y++ ) {
+			const Vec3 pos( float( x - 1 ) * floorRadius * 0.25f, float( y - 1 ) * floorRadius * 0.25f, -floorRadius );
+			AddBody( scene, new ShapeSphere( floorRadius ), pos, 0.0f, 0.99f, 0.5f );
+		}
+	}
+}
+
+/*
+====================================================
+BuildDiamonds
+
+The second book's diamond, piled up in the sand box.  The hull is built once and shared.
+====================================================
+*/
+static void BuildDiamonds( Scene & scene, const int size ) {
+	ShapeConvex * diamond = new ShapeConvex( g_diamond, sizeof( g_diamond ) / sizeof( Vec3 ) );
+
+	const int numColumns = 6;
+	for ( int i = 0; i < size; i++ ) {
+		const int x = i % numColumns;
+		const int y = ( i / numColumns ) % numColumns;
+		const int z = i / ( numColumns * numColumns );
+		const Vec3 pos( ( (float)x - 2.5f ) * 2.5f, ( (float)y - 2.5f ) * 2.5f, 3.0f + (float)z * 2.5f );
+		AddBody( scene, diamond, pos, 1.0f, 0.5f, 0.5f );
+	}
+	AddStandardSandBox( scene.m_bodies );
+}
+
+/*
+====================================================
+BuildDemo
+
+The third book's scene: ragdoll, chain, motor, mover and the joint samples
+====================================================
+*/
+static void BuildDemo( Scene & scene, const int size ) {
+	scene.Initialize();
+}
+
+/*
+====================================================
+BuildPyramid
+
+A 2D pyramid of unit boxes, size boxes along the bottom row
+====================================================
+*/
+static void BuildPyramid( Scene & scene, const int size ) {
+	ShapeBox * box = new ShapeBox( g_boxUnit, sizeof( g_boxUnit ) / sizeof( Vec3 ) );
+
+	const float spacing = 2.04f;
+	for ( int row = 0; row < size; row++ ) {
+		const int numInRow = size - row;
+		for ( int i = 0; i < numInRow; i++ ) {
+			const Vec3 pos( ( (float)i - 0.5f * (float)( numInRow - 1 ) ) * spacing, 0.0f, 1.02f + (float)row * spacing );
+			AddBody( scene, box, pos, 1.0f, 0.0f, 0.5f );
+		}
+	}
+	AddStandardSandBox( scene.m_bodies );
+}
+
+/*
+====================================================
+BuildRagdolls
+
+A grid of ragdolls dropped in a heap
+====================================================
+*/
+static void BuildRagdolls( Scene & scene, const int size ) {
+	// The joints point into the body array, it mustn't move while they're added
+	scene.m_bodies.reserve( size * 6 + 5 );
+
+	int numColumns = 1;
+	while ( numColumns * numColumns < size ) {
+		numColumns++;
+	}
+	for ( int i = 0; i < size; i++ ) {
+		const int x = i % numColumns;
+		const int y = i / numColumns;
+		const Vec3 offset( ( (float)x - 0.5f * (float)( numColumns - 1 ) ) * 5.0f, ( (float)y - 0.5f * (float)( numColumns - 1 ) ) * 5.0f, (float)( i % 3 ) * 2.0f );
+		AddRagdoll( scene.m_bodies, scene.m_constraints, offset );
+	}
+	AddStandardSandBox( scene.m_bodies );
+}
+
+/*
+====================================================
+BuildHullRain
+
+Convex hulls dropped in a tall column over the sand box.  A handful of hulls
+from random points are built once and shared, building a hull is far slower
+than anything the step does.
+====================================================
+*/
+static void BuildHullRain( Scene & scene, const int size ) {
+	const int numShapes = 4;
+	Shape * shapes[ numShapes ];
+	shapes[ 0 ] = new ShapeConvex( g_diamond, sizeof( g_diamond ) / sizeof( Vec3 ) );
+
+	// Fixed seed, so every run builds the same hulls
+	unsigned int seed = 12345;
+	for ( int i = 1; i < numShapes; i++ ) {
+		Vec3 pts[ 12 ];
+		for ( int j = 0; j < 12; j++ ) {
+			for ( int k = 0; k < 3; k++ ) {
+				seed = seed * 1664525u + 1013904223u;
+				pts[ j ][ k ] = (float)( seed >> 8 ) / (float)( 1 << 24 ) * 2.0f - 1.0f;
+			}
+		}
+		shapes[ i ] = new ShapeConvex( pts, 12 );
+	}
+
+	const int numColumns = 10;
+	for ( int i = 0; i < size; i++ ) {
+		const int x = i % numColumns;
+		const int y = ( i / numColumns ) % numColumns;
+		const int z = i / ( numColumns * numColumns );
+		const Vec3 pos( ( (float)x - 4.5f ) * 3.0f, ( (float)y - 4.5f ) * 3.0f, 5.0f + (float)z * 3.0f );
+		AddBody( scene, shapes[ i % numShapes ], pos, 1.0f, 0.2f, 0.5f );
+	}
+	AddStandardSandBox( scene.m_bodies );
+}
+
+static const benchScene_t g_benchScenes[] = {
+	{ "spheres",	BuildSpheres,	0 },
+	{ "diamonds",	BuildDiamonds,	64 },
+	{ "demo",		BuildDemo,		0 },
+	{ "pyramid",	BuildPyramid,	20 },
+	{ "ragdolls",	BuildRagdolls,	16 },
+	{ "hullrain",	BuildHullRain,	400 },
+};
+static const int g_numBenchScenes = sizeof( g_benchScenes ) / sizeof( benchScene_t );
+
+/*
+====================================================
+RunScene
+====================================================
+*/
+static void RunScene( const benchScene_t & benchScene, const int size, const int numSteps, benchResult_t & result ) {
+	Scene scene;
+	benchScene.build( scene, size );
+
+	memset( result.phaseMs, 0, sizeof( result.phaseMs ) );
+	result.name = benchScene.name;
+	result.size = size;
+	result.numBodies = (int)scene.m_bodies.size();
+	result.numJoints = (int)scene.m_constraints.size();
+	result.numSteps = numSteps;
+	result.updateMs = 0.0;
+	result.worstUpdateMs = 0.0;
+	result.avgPairs = 0.0;
+	result.avgContacts = 0.0;
+	result.maxContacts = 0;
+
+	const float dt_sec = 1.0f / 60.0f;
+	for ( int step = 0; step < numSteps; step++ ) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		scene.Update( dt_sec );
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		const double ms = std::chrono::duration< double, std::milli >( end - start ).count();
+		result.updateMs += ms;
+		result.worstUpdateMs = ( ms > result.worstUpdateMs ) ? ms : result.worstUpdateMs;
+		for ( int i = 0; i < NUM_SCENE_PHASES; i++ ) {
+			result.phaseMs[ i ] += scene.m_phaseTimes[ i ];
+		}
+		result.avgPairs += scene.m_numPairs;
+		result.avgContacts += scene.m_numContacts;
+		result.maxContacts = ( scene.m_numContacts > result.maxContacts ) ? scene.m_numContacts : result.maxContacts;
+	}
+
+	const double invSteps = ( numSteps > 0 ) ? 1.0 / (double)numSteps : 0.0;
+	for ( int i = 0; i < NUM_SCENE_PHASES; i++ ) {
+		result.phaseMs[ i ] *= invSteps;
+	}
+	result.updateMs *= invSteps;
+	result.avgPairs *= invSteps;
+	result.avgContacts *= invSteps;
+	result.stateHash = scene.m_stateHash;
+}
+
+/*
+====================================================
+PrintTable
+====================================================
+*/
+static void PrintTable( const std::vector< benchResult_t > & results ) {
+	printf( "%-14s %7s", "scene", "bodies" );
+	for ( int i = 0; i < NUM_SCENE_PHASES; i++ ) {
+		printf( " %11s", Scene::GetPhaseName( (scenePhase_t)i ) );
+	}
+	printf( " %9s %9s %9s %9s\n", "update", "worst", "pairs", "contacts" );
+
+	for ( int r = 0; r < results.size(); r++ ) {
+		const benchResult_t & result = results[ r ];
+		char name[ 64 ];
+		snprintf( name, sizeof( name ), ( result.size > 0 ) ? "%s:%i" : "%s", result.name.c_str(), result.size );
+		printf( "%-14s %7i", name, result.numBodies );
+		for ( int i = 0; i < NUM_SCENE_PHASES; i++ ) {
+			printf( " %11.4f", result.phaseMs[ i ] );
+		}
+		printf( " %9.4f %9.4f %9.1f %9.1f\n", result.updateMs, result.worstUpdateMs, result.avgPairs, result.avgContacts );
+	}
+	printf( "times are average ms per step\n" );
+}
+
+/*
+====================================================
+PrintCSV
+====================================================
+*/
+static void PrintCSV( const std::vector< benchResult_t > & results ) {
+	printf( "scene,size,bodies,joints,steps" );
+	for ( int i = 0; i < NUM_SCENE_PHASES; i++ ) {
+		printf( ",%s_ms", Scene::GetPhaseName( (scenePhase_t)i ) );
+	}
+	printf( ",update_ms,worst_update_ms,avg_pairs,avg_contacts,max_contacts,state_hash\n" );
+
+	for ( int r = 0; r < results.size(); r++ ) {
+		const benchResult_t & result = results[ r ];
+		printf( "%s,%i,%i,%i,%i", result.name.c_str(), result.size, result.numBodies, result.numJoints, result.numSteps );
+		for ( int i = 0; i < NUM_SCENE_PHASES; i++ ) {
+			printf( ",%.6f", result.phaseMs[ i ] );
+		}
+		printf( ",%.6f,%.6f,%.2f,%.2f,%i,%016llx\n", result.updateMs, result.worstUpdateMs, result.avgPairs, result.avgContacts, result.maxContacts, result.stateHash );
+	}
+}
+
+/*
+====================================================
+PrintJSON
+====================================================
+*/
+static void PrintJSON( const std::vector< benchResult_t > & results ) {
+	printf( "[\n" );
+	for ( int r = 0; r < results.size(); r++ ) {
+		const benchResult_t & result = results[ r ];
+		printf( "  {\n" );
+		printf( "    \"scene\": \"%s\",\n", result.name.c_str() );
+		printf( "    \"size\": %i,\n", result.size );
+		printf( "    \"bodies\": %i,\n", result.numBodies );
+		printf( "    \"joints\": %i,\n", result.numJoints );
+		printf( "    \"steps\": %i,\n", result.numSteps );
+		printf( "    \"phases_ms\": {" );
+		for ( int i = 0; i < NUM_SCENE_PHASES; i++ ) {
+			printf( "%s \"%s\": %.6f", ( i > 0 ) ? "," : "", Scene::GetPhaseName( (scenePhase_t)i ), result.phaseMs[ i ] );
+		}
+		printf( " },\n" );
+		printf( "    \"update_ms\": %.6f,\n", result.updateMs );
+		printf( "    \"worst_update_ms\": %.6f,\n", result.worstUpdateMs );
+		printf( "    \"avg_pairs\": %.2f,\n", result.avgPairs );
+		printf( "    \"avg_contacts\": %.2f,\n", result.avgContacts );
+		printf( "    \"max_contacts\": %i,\n", result.maxContacts );
+		printf( "    \"state_hash\": \"%016llx\"\n", result.stateHash );
+		printf( "  }%s\n", ( r + 1 < results.size() ) ? "," : "" );
+	}
+	printf( "]\n" );
+}
+
+/*
+====================================================
+main
+====================================================
+*/
+int main( int argc, char * argv[] ) {
+	const char * format = ( argc > 1 ) ? argv[ 1 ] : "table";
+	const int numSteps = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 300;
+	if ( 0 != strcmp( format, "table" ) && 0 != strcmp( format, "csv" ) && 0 != strcmp( format, "json" ) ) {
+		printf( "usage: bench_suite [table | csv | json] [steps] [scene[:size] ...]\n" );
+		return 1;
+	}
+
+	FillDiamond();
+
+	// Every scene at its default size, unless some were asked for
+	std::vector< int > sceneIndices;
+	std::vector< int > sceneSizes;
+	for ( int arg = 3; arg < argc; arg++ ) {
+		std::string name = argv[ arg ];
+		int size = -1;
+		const size_t colon = name.find( ':' );
+		if ( std::string::npos != colon ) {
+			size = atoi( name.c_str() + colon + 1 );
+			name = name.substr( 0, colon );
+		}
+
+		int idx = -1;
+		for ( int i = 0; i < g_numBenchScenes; i++ ) {
+			if ( name == g_benchScenes[ i ].name ) {
+				idx = i;
+				break;
+			}
+		}
+		if ( idx < 0 ) {
+			printf( "unknown scene: %s\n", name.c_str() );
+			return 1;
+		}
+		sceneIndices.push_back( idx );
+		sceneSizes.push_back( ( size > 0 && g_benchScenes[ idx ].defaultSize > 0 ) ? size : g_benchScenes[ idx ].defaultSize );
+	}
+	if ( sceneIndices.empty() ) {
+		for ( int i = 0; i < g_numBenchScenes; i++ ) {
+			sceneIndices.push_back( i );
+			sceneSizes.push_back( g_benchScenes[ i ].defaultSize );
+		}
+	}
+
+	std::vector< benchResult_t > results( sceneIndices.size() );
+	for ( int i = 0; i < sceneIndices.size(); i++ ) {
+		RunScene( g_benchScenes[ sceneIndices[ i ] ], sceneSizes[ i ], numSteps, results[ i ] );
+	}
+
+	if ( 0 == strcmp( format, "csv" ) ) {
+		PrintCSV( results );
+	} else if ( 0 == strcmp( format, "json" ) ) {
+		PrintJSON( results );
+	} else {
+		PrintTable( results );
+	}
+	return 0;
+}
@@ -0,0 +1,94 @@
+//
+//  PhysicsBench.cpp
+//
+//	Headless benchmark runner.  Loads a scene file ( or builds the demo scene
+//	from Scene::Initialize ), runs a number of fixed steps through
+//	Scene::Update and reports how long each phase of the step took.  Given a
+//	trace file it also profiles the run and writes a Chrome trace.
+//
+//	physics_bench [scene file | demo] [steps] [threads] [substeps] [trace file]
+//
+#include "../Scene.h"
+#include "../SceneFile.h"
+#include "../Profiler/Profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+/*
+====================================================
+main
+====================================================
+*/
+int main( int argc, char * argv[] ) {
+	const char * sceneName = ( argc > 1 ) ? argv[ 1 ] : "demo";
+	const int numSteps = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 600;
+	const int numThreads = ( argc > 3 ) ? atoi( argv[ 3 ] ) : 1;
+	const int numSubsteps = ( argc > 4 ) ? atoi( argv[ 4 ] ) : 1;
+	const char * traceName = ( argc > 5 ) ? argv[ 5 ] : NULL;
+	const float dt_sec = 1.0f / 60.0f;
+
+	Scene scene;
+	const auto loadStart = std::chrono::high_resolution_clock::now();
+	if ( 0 == strcmp( sceneName, "demo" ) ) {
+		FillDiamond();
+		scene.Initialize();
+	} else if ( !SceneFile_LoadMapped( scene, sceneName ) ) {
+		return 1;
+	}
+	const auto loadEnd = std::chrono::high_resolution_clock::now();
+
+	scene.m_numThreads = numThreads;
+	scene.m_numSubsteps = numSubsteps;
+
+	printf( "scene: %s  bodies: %i  joints: %i  load: %.3f ms\n", sceneName, (int)scene.m_bodies.size(), (int)scene.m_constraints.size(), std::chrono::duration< double, std::milli >( loadEnd - loadStart ).count() );
+	printf( "steps: %i  threads: %i  substeps: %i\n", numSteps, numThreads, numSubsteps );
+
+	if ( NULL != traceName ) {
+		Profiler_SetThreadName( "main" );
+		Profiler_SetEnabled( true );
+	}
+
+	double phaseTotals[ NUM_SCENE_PHASES ] = { 0.0 };
+	double totalMs = 0.0;
+	double worstMs = 0.0;
+	for ( int step = 0; step < numSteps; step++ ) {
+		Profiler_BeginFrame();
+		const auto start = std::chrono::high_resolution_clock::now();
+		scene.Update( dt_sec );
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		const double ms = std::chrono::duration< double, std::milli >( end - start ).count();
+		totalMs += ms;
+		worstMs = ( ms > worstMs ) ? ms : worstMs;
+		for ( int i = 0; i < NUM_SCENE_PHASES; i++ ) {
+			phaseTotals[ i ] += scene.m_phaseTimes[ i ];
+		}
+	}
+
+	const double stepCount = ( numSteps > 0 ) ? (double)numSteps : 1.0;
+	const double percentScale = ( totalMs > 0.0 ) ? 100.0 / totalMs : 0.0;
+	printf( "%-12s %10s %10s %7s\n", "phase", "total ms", "ms/step", "share" );
+	for ( int i = 0; i < NUM_SCENE_PHASES; i++ ) {
+		printf( "%-12s %10.3f %10.4f %6.1f%%\n", Scene::GetPhaseName( (scenePhase_t)i ), phaseTotals[ i ], phaseTotals[ i ] / stepCount, phaseTotals[ i ] * percentScale );
+	}
+	printf( "%-12s %10.3f %10.4f %6.1f%%\n", "update", totalMs, totalMs / stepCount, 100.0 );
+	printf( "worst step: %.4f ms\n", worstMs );
+	printf( "state hash: %016llx\n", scene.m_stateHash );
+
+	char stats[ 2048 ];
+	scene.m_stats.Print( stats, sizeof( stats ) );
+	printf( "engine counters over the last %i steps:\n%s", scene.m_stats.GetNumSteps(), stats );
+
+	if ( NULL != traceName ) {
+		Profiler_SetEnabled( false );
+		if ( !GPW_PROFILER ) {
+			printf( "the profiler was compiled out, the trace only holds the frames\n" );
+		}
+		if ( Profiler_WriteChromeTrace( traceName, 0 ) ) {
+			printf( "trace: %s\n", traceName );
+		}
+	}
+	return 0;
+}
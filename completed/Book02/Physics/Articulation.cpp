@@ -0,0 +1,864 @@
+//
+//  Articulation.cpp
+//
+#include "Articulation.h"
+#include <math.h>
+#include <string.h>
+
+/*
+================================================================================================
+
+Spatial helpers
+
+Spatial vectors are stored angular first, then linear, about each link's center of mass
+with world space orientation.
+
+================================================================================================
+*/
+
+/*
+================================
+InvertMatrix
+
+Gauss-Jordan with partial pivoting on the upper left n x n block
+================================
+*/
+static bool InvertMatrix( const float in[ 6 ][ 6 ], float out[ 6 ][ 6 ], const int n ) {
+	float m[ 6 ][ 6 ];
+	for ( int i = 0; i < n; i++ ) {
+		for ( int j = 0; j < n; j++ ) {
+			m[ i ][ j ] = in[ i ][ j ];
+			out[ i ][ j ] = ( i == j ) ? 1.0f : 0.0f;
+		}
+	}
+
+	for ( int col = 0; col < n; col++ ) {
+		int pivotRow = col;
+		for ( int row = col + 1; row < n; row++ ) {
+			if ( fabsf( m[ row ][ col ] ) > fabsf( m[ pivotRow ][ col ] ) ) {
+				pivotRow = row;
+			}
+		}
+		if ( fabsf( m[ pivotRow ][ col ] ) < 1e-12f ) {
+			return false;
+		}
+
+		if ( pivotRow != col ) {
+			for ( int j = 0; j < n; j++ ) {
+				float tmp = m[ col ][ j ];
+				m[ col ][ j ] = m[ pivotRow ][ j ];
+				m[ pivotRow ][ j ] = tmp;
+
+				tmp = out[ col ][ j ];
+				out[ col ][ j ] = out[ pivotRow ][ j ];
+				out[ pivotRow ][ j ] = tmp;
+			}
+		}
+
+		const float invPivot = 1.0f / m[ col ][ col ];
+		for ( int j = 0; j < n; j++ ) {
+			m[ col ][ j ] *= invPivot;
+			out[ col ][ j ] *= invPivot;
+		}
+
+		for ( int row = 0; row < n; row++ ) {
+			if ( row == col ) {
+				continue;
+			}
+			const float scale = m[ row ][ col ];
+			if ( 0.0f == scale ) {
+				continue;
+			}
+			for ( int j = 0; j < n; j++ ) {
+				m[ row ][ j ] -= m[ col ][ j ] * scale;
+				out[ row ][ j ] -= out[ col ][ j ] * scale;
+			}
+		}
+	}
+	return true;
+}
+
+/*
+================================
+AddInertiaToParent
+
+parent += X^T * child * X, where X = [ I 0; -skew( r ) I ] carries the parent's
+velocity to the child's center of mass and r runs from the parent to the child.
+================================
+*/
+static void AddInertiaToParent( const float child[ 6 ][ 6 ], const Vec3 & r, float parent[ 6 ][ 6 ] ) {
+	float X[ 6 ][ 6 ];
+	for ( int i = 0; i < 6; i++ ) {
+		for ( int j = 0; j < 6; j++ ) {
+			X[ i ][ j ] = ( i == j ) ? 1.0f : 0.0f;
+		}
+	}
+	X[ 3 ][ 1 ] = r.z;
+	X[ 3 ][ 2 ] = -r.y;
+	X[ 4 ][ 0 ] = -r.z;
+	X[ 4 ][ 2 ] = r.x;
+	X[ 5 ][ 0 ] = r.y;
+	X[ 5 ][ 1 ] = -r.x;
+
+	float childX[ 6 ][ 6 ];
+	for ( int i = 0; i < 6; i++ ) {
+		for ( int j = 0; j < 6; j++ ) {
+			float sum = 0.0f;
+			for ( int k = 0; k < 6; k++ ) {
+				sum += child[ i ][ k ] * X[ k ][ j ];
+			}
+			childX[ i ][ j ] = sum;
+		}
+	}
+
+	for ( int i = 0; i < 6; i++ ) {
+		for ( int j = 0; j < 6; j++ ) {
+			float sum = 0.0f;
+			for ( int k = 0; k < 6; k++ ) {
+				sum += X[ k ][ i ] * childX[ k ][ j ];
+			}
+			parent[ i ][ j ] += sum;
+		}
+	}
+}
+
+/*
+================================
+GetInertiaTensorWorldSpace
+================================
+*/
+static Mat3 GetInertiaTensorWorldSpace( const Body * body, const Quat & orientation ) {
+	Mat3 orient = orientation.ToMat3();
+	Mat3 inertiaTensor = orient * body->m_shape->InertiaTensor() * orient.Transpose();
+	return inertiaTensor * ( 1.0f / body->m_invMass );
+}
+
+/*
+================================================================================================
+
+Articulation
+
+================================================================================================
+*/
+
+/*
+================================
+Articulation::AddJoint
+================================
+*/
+bool Articulation::AddJoint( const ConstraintHingeQuat & joint ) {
+	jointDef_t def;
+	def.bodyA = joint.m_bodyA;
+	def.bodyB = joint.m_bodyB;
+	def.anchorA = joint.m_anchorA;
+	def.anchorB = joint.m_anchorB;
+	def.q0 = joint.q0;
+	def.numDofs = 1;
+	def.axes[ 0 ] = joint.m_axisA;
+	def.limit = 0.0f;
+	return AddJointDef( def );
+}
+
+/*
+================================
+Articulation::AddJoint
+================================
+*/
+bool Articulation::AddJoint( const ConstraintHingeQuatLimited & joint ) {
+	const float pi = acosf( -1.0f );
+
+	jointDef_t def;
+	def.bodyA = joint.m_bodyA;
+	def.bodyB = joint.m_bodyB;
+	def.anchorA = joint.m_anchorA;
+	def.anchorB = joint.m_anchorB;
+	def.q0 = joint.m_q0;
+	def.numDofs = 1;
+	def.axes[ 0 ] = joint.m_axisA;
+	def.limit = ConstraintHingeQuatLimited::LIMIT_DEGREES * pi / 180.0f;
+	return AddJointDef( def );
+}
+
+/*
+================================
+Articulation::AddJoint
+================================
+*/
+bool Articulation::AddJoint( const ConstraintConstantVelocity & joint ) {
+	jointDef_t def;
+	def.bodyA = joint.m_bodyA;
+	def.bodyB = joint.m_bodyB;
+	def.anchorA = joint.m_anchorA;
+	def.anchorB = joint.m_anchorB;
+	def.q0 = joint.m_q0;
+	def.numDofs = 2;
+	joint.m_axisA.GetOrtho( def.axes[ 0 ], def.axes[ 1 ] );
+	def.limit = 0.0f;
+	return AddJointDef( def );
+}
+
+/*
+================================
+Articulation::AddJoint
+================================
+*/
+bool Articulation::AddJoint( const ConstraintConstantVelocityLimited & joint ) {
+	const float pi = acosf( -1.0f );
+
+	jointDef_t def;
+	def.bodyA = joint.m_bodyA;
+	def.bodyB = joint.m_bodyB;
+	def.anchorA = joint.m_anchorA;
+	def.anchorB = joint.m_anchorB;
+	def.q0 = joint.m_q0;
+	def.numDofs = 2;
+	joint.m_axisA.GetOrtho( def.axes[ 0 ], def.axes[ 1 ] );
+	def.limit = ConstraintConstantVelocityLimited::LIMIT_DEGREES * pi / 180.0f;
+	return AddJointDef( def );
+}
+
+/*
+================================
+Articulation::AddJoint
+================================
+*/
+bool Articulation::AddJoint( const ConstraintDistance & joint ) {
+	jointDef_t def;
+	def.bodyA = joint.m_bodyA;
+	def.bodyB = joint.m_bodyB;
+	def.anchorA = joint.m_anchorA;
+	def.anchorB = joint.m_anchorB;
+	def.numDofs = 3;
+	def.axes[ 0 ] = Vec3( 1, 0, 0 );
+	def.axes[ 1 ] = Vec3( 0, 1, 0 );
+	def.axes[ 2 ] = Vec3( 0, 0, 1 );
+	def.limit = 0.0f;
+
+	// The distance constraint doesn't keep a rest orientation, use the current one
+	if ( NULL != def.bodyA && NULL != def.bodyB ) {
+		def.q0 = def.bodyA->m_orientation.Inverse() * def.bodyB->m_orientation;
+	}
+	return AddJointDef( def );
+}
+
+/*
+================================
+Articulation::AddJointDef
+================================
+*/
+bool Articulation::AddJointDef( const jointDef_t & def ) {
+	if ( m_isFinalized ) {
+		return false;
+	}
+	if ( NULL == def.bodyA || NULL == def.bodyB || def.bodyA == def.bodyB ) {
+		return false;
+	}
+	if ( 0.0f == def.bodyA->m_invMass && 0.0f == def.bodyB->m_invMass ) {
+		return false;
+	}
+
+	jointDef_t normalized = def;
+	for ( int i = 0; i < def.numDofs; i++ ) {
+		normalized.axes[ i ].Normalize();
+	}
+	m_jointDefs.push_back( normalized );
+	return true;
+}
+
+/*
+================================
+Articulation::Finalize
+================================
+*/
+bool Articulation::Finalize() {
+	if ( m_isFinalized || m_jointDefs.empty() ) {
+		return false;
+	}
+
+	// A body with infinite mass pins the tree, there can only be one
+	Body * root = NULL;
+	for ( int i = 0; i < m_jointDefs.size(); i++ ) {
+		Body * bodies[ 2 ] = { m_jointDefs[ i ].bodyA, m_jointDefs[ i ].bodyB };
+		for ( int j = 0; j < 2; j++ ) {
+			if ( 0.0f != bodies[ j ]->m_invMass ) {
+				continue;
+			}
+			if ( NULL != root && root != bodies[ j ] ) {
+				return false;
+			}
+			root = bodies[ j ];
+		}
+	}
+	m_isFixedBase = ( NULL != root );
+	if ( NULL == root ) {
+		root = m_jointDefs[ 0 ].bodyA;
+	}
+
+	std::vector< link_t > links;
+	links.reserve( m_jointDefs.size() + 1 );
+
+	link_t rootLink = {};
+	rootLink.body = root;
+	rootLink.parent = -1;
+	rootLink.numDofs = 0;
+	rootLink.isBall = false;
+	rootLink.pre = Quat( 0, 0, 0, 1 );
+	rootLink.post = Quat( 0, 0, 0, 1 );
+	rootLink.ballRotation = Quat( 0, 0, 0, 1 );
+	links.push_back( rootLink );
+
+	// Breadth first from the root, so every parent comes before its children
+	std::vector< bool > isJointUsed( m_jointDefs.size(), false );
+	for ( int cur = 0; cur < links.size(); cur++ ) {
+		Body * parentBody = links[ cur ].body;
+
+		for ( int i = 0; i < m_jointDefs.size(); i++ ) {
+			if ( isJointUsed[ i ] ) {
+				continue;
+			}
+			const jointDef_t & def = m_jointDefs[ i ];
+			if ( def.bodyA != parentBody && def.bodyB != parentBody ) {
+				continue;
+			}
+			isJointUsed[ i ] = true;
+
+			const bool isForward = ( def.bodyA == parentBody );
+			Body * childBody = isForward ? def.bodyB : def.bodyA;
+
+			// Reaching a body twice means the joints form a loop
+			for ( int j = 0; j < links.size(); j++ ) {
+				if ( links[ j ].body == childBody ) {
+					return false;
+				}
+			}
+
+			link_t link = rootLink;
+			link.body = childBody;
+			link.parent = cur;
+			link.numDofs = def.numDofs;
+			link.isBall = ( 3 == def.numDofs );
+			link.limit = def.limit;
+
+			// The joint axes live in bodyA's space.  Walking the joint from B to A
+			// runs the relative rotation backwards, so the axes flip.
+			if ( isForward ) {
+				link.pre = Quat( 0, 0, 0, 1 );
+				link.post = def.q0;
+				link.anchorParent = def.anchorA;
+				link.anchorChild = def.anchorB;
+				for ( int k = 0; k < def.numDofs; k++ ) {
+					link.axes[ k ] = def.axes[ k ];
+				}
+			} else {
+				link.pre = def.q0.Inverse();
+				link.post = Quat( 0, 0, 0, 1 );
+				link.anchorParent = def.anchorB;
+				link.anchorChild = def.anchorA;
+				for ( int k = 0; k < def.numDofs; k++ ) {
+					link.axes[ k ] = def.axes[ def.numDofs - 1 - k ] * -1.0f;
+				}
+			}
+			links.push_back( link );
+		}
+	}
+
+	for ( int i = 0; i < isJointUsed.size(); i++ ) {
+		if ( !isJointUsed[ i ] ) {
+			return false;
+		}
+	}
+
+	m_links = links;
+
+	// Pick up the joint angles from where the bodies are now
+	link_t & rootState = m_links[ 0 ];
+	rootState.centerOfMass = root->GetCenterOfMassWorldSpace();
+	rootState.orientation = root->m_orientation;
+	rootState.linearVelocity = root->m_linearVelocity;
+	rootState.angularVelocity = root->m_angularVelocity;
+
+	for ( int i = 1; i < m_links.size(); i++ ) {
+		link_t & link = m_links[ i ];
+		const Body * parentBody = m_links[ link.parent ].body;
+
+		Quat rel = link.pre.Inverse() * parentBody->m_orientation.Inverse() * link.body->m_orientation * link.post.Inverse();
+		if ( rel.w < 0.0f ) {
+			rel *= -1.0f;
+		}
+
+		if ( link.isBall ) {
+			link.ballRotation = rel;
+			continue;
+		}
+
+		for ( int k = 0; k < link.numDofs; k++ ) {
+			const float s = rel.xyz().Dot( link.axes[ k ] );
+			link.q[ k ] = ( 1 == link.numDofs ) ? 2.0f * atan2f( s, rel.w ) : 2.0f * asinf( ( s > 1.0f ) ? 1.0f : ( ( s < -1.0f ) ? -1.0f : s ) );
+		}
+	}
+
+	// Project the bodies' relative angular velocities onto the joint axes, the axes are orthogonal
+	UpdateKinematics();
+	for ( int i = 1; i < m_links.size(); i++ ) {
+		link_t & link = m_links[ i ];
+		const Vec3 relativeVelocity = link.body->m_angularVelocity - m_links[ link.parent ].body->m_angularVelocity;
+		for ( int k = 0; k < link.numDofs; k++ ) {
+			link.qdot[ k ] = link.motionAngular[ k ].Dot( relativeVelocity );
+		}
+	}
+
+	// Snap the bodies onto the joints
+	UpdateKinematics();
+	WriteBodies();
+
+	m_isFinalized = true;
+	return true;
+}
+
+/*
+================================
+Articulation::UpdateKinematics
+
+Forward kinematics, from the root out.  Along with the pose and velocity of every link
+this builds the motion subspace of each joint and the velocity product acceleration, the
+part of a link's acceleration that comes from the tree moving rather than the joints
+accelerating.
+================================
+*/
+void Articulation::UpdateKinematics() {
+	link_t & root = m_links[ 0 ];
+	if ( m_isFixedBase ) {
+		root.centerOfMass = root.body->GetCenterOfMassWorldSpace();
+		root.orientation = root.body->m_orientation;
+		root.linearVelocity = root.body->m_linearVelocity;
+		root.angularVelocity = root.body->m_angularVelocity;
+	}
+	root.biasAngular.Zero();
+	root.biasLinear.Zero();
+
+	for ( int i = 1; i < m_links.size(); i++ ) {
+		link_t & link = m_links[ i ];
+		const link_t & parent = m_links[ link.parent ];
+
+		const Quat frame = parent.orientation * link.pre;
+
+		Quat jointRotation = link.isBall ? link.ballRotation : Quat( 0, 0, 0, 1 );
+		Vec3 relativeVelocity( 0.0f );
+		Vec3 biasAngular( 0.0f );
+		Vec3 frameVelocity = parent.angularVelocity;	// angular velocity of the frame the current axis is fixed in
+		for ( int k = 0; k < link.numDofs; k++ ) {
+			const Vec3 axis = link.isBall ? frame.RotatePoint( link.axes[ k ] ) : ( frame * jointRotation ).RotatePoint( link.axes[ k ] );
+			link.motionAngular[ k ] = axis;
+
+			biasAngular += frameVelocity.Cross( axis ) * link.qdot[ k ];
+			relativeVelocity += axis * link.qdot[ k ];
+			if ( !link.isBall ) {
+				frameVelocity = parent.angularVelocity + relativeVelocity;
+				jointRotation = jointRotation * Quat( link.axes[ k ], link.q[ k ] );
+			}
+		}
+
+		link.orientation = frame * jointRotation * link.post;
+		link.orientation.Normalize();
+
+		const Vec3 anchor = parent.centerOfMass + parent.orientation.RotatePoint( link.anchorParent );
+		link.centerOfMass = anchor - link.orientation.RotatePoint( link.anchorChild );
+
+		const Vec3 d = link.centerOfMass - anchor;
+		const Vec3 r = link.centerOfMass - parent.centerOfMass;
+
+		link.angularVelocity = parent.angularVelocity + relativeVelocity;
+		link.linearVelocity = parent.linearVelocity + parent.angularVelocity.Cross( r ) + relativeVelocity.Cross( d );
+
+		for ( int k = 0; k < link.numDofs; k++ ) {
+			link.motionLinear[ k ] = link.motionAngular[ k ].Cross( d );
+		}
+
+		link.biasAngular = biasAngular;
+		link.biasLinear = parent.angularVelocity.Cross( link.linearVelocity - parent.linearVelocity ) + biasAngular.Cross( d ) + relativeVelocity.Cross( link.angularVelocity.Cross( d ) );
+	}
+}
+
+/*
+================================
+Articulation::IntegrateVelocities
+
+The articulated body algorithm.  The first pass goes from the leaves to the root and
+folds each subtree into the inertia its parent feels through the joint, the second goes
+from the root out and solves each joint's acceleration.
+================================
+*/
+void Articulation::IntegrateVelocities( const float dt_sec ) {
+	// Rigid body inertia, and the external forces gathered at the start of the step
+	for ( int i = 0; i < m_links.size(); i++ ) {
+		link_t & link = m_links[ i ];
+		memset( link.articulatedInertia, 0, sizeof( link.articulatedInertia ) );
+		memset( link.articulatedBias, 0, sizeof( link.articulatedBias ) );
+		if ( 0 == i && m_isFixedBase ) {
+			continue;
+		}
+
+		const float mass = 1.0f / link.body->m_invMass;
+		const Mat3 inertiaTensor = GetInertiaTensorWorldSpace( link.body, link.orientation );
+		for ( int r = 0; r < 3; r++ ) {
+			for ( int c = 0; c < 3; c++ ) {
+				link.articulatedInertia[ r ][ c ] = inertiaTensor.rows[ r ][ c ];
+			}
+			link.articulatedInertia[ 3 + r ][ 3 + r ] = mass;
+			link.articulatedBias[ r ] = -link.externalTorque[ r ];
+			link.articulatedBias[ 3 + r ] = -link.externalForce[ r ];
+		}
+	}
+
+	// Leaves to root
+	for ( int i = (int)m_links.size() - 1; i > 0; i-- ) {
+		link_t & link = m_links[ i ];
+		link_t & parent = m_links[ link.parent ];
+		const int n = link.numDofs;
+
+		float S[ 6 ][ MAX_DOFS ];
+		for ( int k = 0; k < n; k++ ) {
+			for ( int r = 0; r < 3; r++ ) {
+				S[ r ][ k ] = link.motionAngular[ k ][ r ];
+				S[ 3 + r ][ k ] = link.motionLinear[ k ][ r ];
+			}
+		}
+
+		float D[ 6 ][ 6 ];
+		for ( int k = 0; k < n; k++ ) {
+			for ( int r = 0; r < 6; r++ ) {
+				float sum = 0.0f;
+				for ( int c = 0; c < 6; c++ ) {
+					sum += link.articulatedInertia[ r ][ c ] * S[ c ][ k ];
+				}
+				link.U[ r ][ k ] = sum;
+			}
+		}
+		for ( int k = 0; k < n; k++ ) {
+			for ( int l = 0; l < n; l++ ) {
+				float sum = 0.0f;
+				for ( int r = 0; r < 6; r++ ) {
+					sum += S[ r ][ k ] * link.U[ r ][ l ];
+				}
+				D[ k ][ l ] = sum;
+			}
+			float sum = 0.0f;
+			for ( int r = 0; r < 6; r++ ) {
+				sum -= S[ r ][ k ] * link.articulatedBias[ r ];
+			}
+			link.u[ k ] = sum;
+		}
+
+		float invD[ 6 ][ 6 ];
+		if ( !InvertMatrix( D, invD, n ) ) {
+			memset( invD, 0, sizeof( invD ) );
+		}
+		for ( int k = 0; k < n; k++ ) {
+			for ( int l = 0; l < n; l++ ) {
+				link.invD[ k ][ l ] = invD[ k ][ l ];
+			}
+		}
+
+		float UinvD[ 6 ][ MAX_DOFS ];
+		for ( int r = 0; r < 6; r++ ) {
+			for ( int k = 0; k < n; k++ ) {
+				float sum = 0.0f;
+				for ( int l = 0; l < n; l++ ) {
+					sum += link.U[ r ][ l ] * invD[ l ][ k ];
+				}
+				UinvD[ r ][ k ] = sum;
+			}
+		}
+
+		// The inertia and bias the parent sees through this joint
+		float Ia[ 6 ][ 6 ];
+		for ( int r = 0; r < 6; r++ ) {
+			for ( int c = 0; c < 6; c++ ) {
+				float sum = link.articulatedInertia[ r ][ c ];
+				for ( int k = 0; k < n; k++ ) {
+					sum -= UinvD[ r ][ k ] * link.U[ c ][ k ];
+				}
+				Ia[ r ][ c ] = sum;
+			}
+		}
+
+		const float bias[ 6 ] = { link.biasAngular.x, link.biasAngular.y, link.biasAngular.z, link.biasLinear.x, link.biasLinear.y, link.biasLinear.z };
+		float pa[ 6 ];
+		for ( int r = 0; r < 6; r++ ) {
+			float sum = link.articulatedBias[ r ];
+			for ( int c = 0; c < 6; c++ ) {
+				sum += Ia[ r ][ c ] * bias[ c ];
+			}
+			for ( int k = 0; k < n; k++ ) {
+				sum += UinvD[ r ][ k ] * link.u[ k ];
+			}
+			pa[ r ] = sum;
+		}
+
+		const Vec3 r = link.centerOfMass - parent.centerOfMass;
+		AddInertiaToParent( Ia, r, parent.articulatedInertia );
+
+		const Vec3 paAngular( pa[ 0 ], pa[ 1 ], pa[ 2 ] );
+		const Vec3 paLinear( pa[ 3 ], pa[ 4 ], pa[ 5 ] );
+		const Vec3 parentAngular = paAngular + r.Cross( paLinear );
+		for ( int k = 0; k < 3; k++ ) {
+			parent.articulatedBias[ k ] += parentAngular[ k ];
+			parent.articulatedBias[ 3 + k ] += paLinear[ k ];
+		}
+	}
+
+	// The root either doesn't move, or floats under the whole tree's inertia
+	link_t & root = m_links[ 0 ];
+	memset( root.acceleration, 0, sizeof( root.acceleration ) );
+	if ( !m_isFixedBase ) {
+		float invInertia[ 6 ][ 6 ];
+		if ( InvertMatrix( root.articulatedInertia, invInertia, 6 ) ) {
+			for ( int r = 0; r < 6; r++ ) {
+				float sum = 0.0f;
+				for ( int c = 0; c < 6; c++ ) {
+					sum -= invInertia[ r ][ c ] * root.articulatedBias[ c ];
+				}
+				root.acceleration[ r ] = sum;
+			}
+		}
+		root.angularVelocity += Vec3( root.acceleration[ 0 ], root.acceleration[ 1 ], root.acceleration[ 2 ] ) * dt_sec;
+		root.linearVelocity += Vec3( root.acceleration[ 3 ], root.acceleration[ 4 ], root.acceleration[ 5 ] ) * dt_sec;
+	}
+
+	// Root to leaves
+	const float damping = 1.0f / ( 1.0f + m_jointDamping * dt_sec );
+	for ( int i = 1; i < m_links.size(); i++ ) {
+		link_t & link = m_links[ i ];
+		const link_t & parent = m_links[ link.parent ];
+		const int n = link.numDofs;
+
+		const Vec3 r = link.centerOfMass - parent.centerOfMass;
+		const Vec3 parentAngular( parent.acceleration[ 0 ], parent.acceleration[ 1 ], parent.acceleration[ 2 ] );
+		const Vec3 parentLinear( parent.acceleration[ 3 ], parent.acceleration[ 4 ], parent.acceleration[ 5 ] );
+		const Vec3 accelAngular = parentAngular + link.biasAngular;
+		const Vec3 accelLinear = parentLinear + parentAngular.Cross( r ) + link.biasLinear;
+		float accel[ 6 ] = { accelAngular.x, accelAngular.y, accelAngular.z, accelLinear.x, accelLinear.y, accelLinear.z };
+
+		float rhs[ MAX_DOFS ];
+		for ( int k = 0; k < n; k++ ) {
+			float sum = link.u[ k ];
+			for ( int c = 0; c < 6; c++ ) {
+				sum -= link.U[ c ][ k ] * accel[ c ];
+			}
+			rhs[ k ] = sum;
+		}
+
+		for ( int k = 0; k < n; k++ ) {
+			float qddot = 0.0f;
+			for ( int l = 0; l < n; l++ ) {
+				qddot += link.invD[ k ][ l ] * rhs[ l ];
+			}
+			link.qdot[ k ] += qddot * dt_sec;
+			link.qdot[ k ] *= damping;
+
+			// Same limit as Body::ApplyImpulseAngular, a long chain whips its tip far faster otherwise
+			const float maxJointSpeed = 30.0f;
+			link.qdot[ k ] = ( link.qdot[ k ] > maxJointSpeed ) ? maxJointSpeed : ( ( link.qdot[ k ] < -maxJointSpeed ) ? -maxJointSpeed : link.qdot[ k ] );
+
+			for ( int c = 0; c < 3; c++ ) {
+				accel[ c ] += link.motionAngular[ k ][ c ] * qddot;
+				accel[ 3 + c ] += link.motionLinear[ k ][ c ] * qddot;
+			}
+		}
+
+		for ( int c = 0; c < 6; c++ ) {
+			link.acceleration[ c ] = accel[ c ];
+		}
+	}
+}
+
+/*
+================================
+Articulation::IntegratePositions
+================================
+*/
+void Articulation::IntegratePositions( const float dt_sec ) {
+	if ( !m_isFixedBase ) {
+		link_t & root = m_links[ 0 ];
+		root.centerOfMass += root.linearVelocity * dt_sec;
+
+		const Vec3 dAngle = root.angularVelocity * dt_sec;
+		const Quat dq = Quat( dAngle, dAngle.GetMagnitude() );
+		root.orientation = dq * root.orientation;
+		root.orientation.Normalize();
+	}
+
+	for ( int i = 1; i < m_links.size(); i++ ) {
+		link_t & link = m_links[ i ];
+
+		if ( link.isBall ) {
+			Vec3 relativeVelocity( 0.0f );
+			for ( int k = 0; k < link.numDofs; k++ ) {
+				relativeVelocity += link.axes[ k ] * link.qdot[ k ];
+			}
+			const Vec3 dAngle = relativeVelocity * dt_sec;
+			link.ballRotation = Quat( dAngle, dAngle.GetMagnitude() ) * link.ballRotation;
+			link.ballRotation.Normalize();
+			continue;
+		}
+
+		for ( int k = 0; k < link.numDofs; k++ ) {
+			link.q[ k ] += link.qdot[ k ] * dt_sec;
+
+			// Stop at the limit, only letting the joint move back into range
+			if ( link.limit > 0.0f ) {
+				if ( link.q[ k ] > link.limit ) {
+					link.q[ k ] = link.limit;
+					link.qdot[ k ] = ( link.qdot[ k ] > 0.0f ) ? 0.0f : link.qdot[ k ];
+				}
+				if ( link.q[ k ] < -link.limit ) {
+					link.q[ k ] = -link.limit;
+					link.qdot[ k ] = ( link.qdot[ k ] < 0.0f ) ? 0.0f : link.qdot[ k ];
+				}
+			}
+		}
+	}
+}
+
+/*
+================================
+Articulation::WriteBodies
+================================
+*/
+void Articulation::WriteBodies() {
+	for ( int i = 0; i < m_links.size(); i++ ) {
+		link_t & link = m_links[ i ];
+		if ( 0 == i && m_isFixedBase ) {
+			continue;
+		}
+
+		Body * body = link.body;
+		body->m_orientation = link.orientation;
+		body->m_position = link.centerOfMass - link.orientation.RotatePoint( body->m_shape->GetCenterOfMass() );
+		body->m_linearVelocity = link.linearVelocity;
+		body->m_angularVelocity = link.angularVelocity;
+		body->UpdateInertiaTensors();
+
+		link.cachedLinearVelocity = link.linearVelocity;
+		link.cachedAngularVelocity = link.angularVelocity;
+	}
+}
+
+/*
+================================
+Articulation::Step
+================================
+*/
+void Articulation::Step( const float dt_sec ) {
+	if ( !m_isFinalized || dt_sec <= 0.0f ) {
+		return;
+	}
+
+	UpdateKinematics();
+
+	// Whatever the scene did to the bodies since the last step, gravity and contacts
+	// mostly, shows up as a change in velocity.  Spread it over the step as a force.
+	const float invDt = 1.0f / dt_sec;
+	for ( int i = 0; i < m_links.size(); i++ ) {
+		link_t & link = m_links[ i ];
+		link.externalForce.Zero();
+		link.externalTorque.Zero();
+		if ( 0 == i && m_isFixedBase ) {
+			continue;
+		}
+
+		// Body::Update already accounts for the gyroscopic torque, so it's part of the change too
+		const float mass = 1.0f / link.body->m_invMass;
+		const Mat3 inertiaTensor = GetInertiaTensorWorldSpace( link.body, link.orientation );
+		link.externalForce = ( link.body->m_linearVelocity - link.cachedLinearVelocity ) * mass * invDt;
+		link.externalTorque = inertiaTensor * ( link.body->m_angularVelocity - link.cachedAngularVelocity ) * invDt;
+	}
+
+	// The velocity product terms are explicit, long chains need shorter steps than the scene to stay stable
+	const int numSteps = ( m_maxStepSize > 0.0f ) ? (int)ceilf( dt_sec / m_maxStepSize ) : 1;
+	const float dt_step = dt_sec / (float)numSteps;
+	for ( int step = 0; step < numSteps; step++ ) {
+		if ( step > 0 ) {
+			UpdateKinematics();
+		}
+		IntegrateVelocities( dt_step );
+		IntegratePositions( dt_step );
+	}
+
+	UpdateKinematics();
+	WriteBodies();
+}
+
+/*
+================================
+Articulation::GetMaxJointError
+================================
+*/
+float Articulation::GetMaxJointError() const {
+	float maxError = 0.0f;
+	for ( int i = 0; i < m_jointDefs.size(); i++ ) {
+		const jointDef_t & def = m_jointDefs[ i ];
+		const Vec3 anchorA = def.bodyA->BodySpaceToWorldSpace( def.anchorA );
+		const Vec3 anchorB = def.bodyB->BodySpaceToWorldSpace( def.anchorB );
+		const float error = ( anchorB - anchorA ).GetMagnitude();
+		maxError = ( error > maxError ) ? error : maxError;
+	}
+	return maxError;
+}
+
+/*
+================================
+Articulation::GetStateSize
+================================
+*/
+int Articulation::GetStateSize() const {
+	return (int)m_links.size() * sizeof( linkState_t );
+}
+
+/*
+================================
+Articulation::SaveState
+================================
+*/
+void Articulation::SaveState( void * state ) const {
+	linkState_t * linkStates = (linkState_t *)state;
+	for ( int i = 0; i < m_links.size(); i++ ) {
+		const link_t & link = m_links[ i ];
+		linkState_t & linkState = linkStates[ i ];
+		for ( int k = 0; k < MAX_DOFS; k++ ) {
+			linkState.q[ k ] = link.q[ k ];
+			linkState.qdot[ k ] = link.qdot[ k ];
+		}
+		linkState.ballRotation = link.ballRotation;
+		linkState.centerOfMass = link.centerOfMass;
+		linkState.orientation = link.orientation;
+		linkState.linearVelocity = link.linearVelocity;
+		linkState.angularVelocity = link.angularVelocity;
+		linkState.cachedLinearVelocity = link.cachedLinearVelocity;
+		linkState.cachedAngularVelocity = link.cachedAngularVelocity;
+	}
+}
+
+/*
+================================
+Articulation::RestoreState
+================================
+*/
+void Articulation::RestoreState( const void * state ) {
+	const linkState_t * linkStates = (const linkState_t *)state;
+	for ( int i = 0; i < m_links.size(); i++ ) {
+		link_t & link = m_links[ i ];
+		const linkState_t & linkState = linkStates[ i ];
+		for ( int k = 0; k < MAX_DOFS; k++ ) {
+			link.q[ k ] = linkState.q[ k ];
+			link.qdot[ k ] = linkState.qdot[ k ];
+		}
+		link.ballRotation = linkState.ballRotation;
+		link.centerOfMass = linkState.centerOfMass;
+		link.orientation = linkState.orientation;
+		link.linearVelocity = linkState.linearVelocity;
+		link.angularVelocity = linkState.angularVelocity;
+		link.cachedLinearVelocity = linkState.cachedLinearVelocity;
+		link.cachedAngularVelocity = linkState.cachedAngularVelocity;
+	}
+}
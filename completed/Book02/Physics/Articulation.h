@@ -0,0 +1,143 @@
+//
+//	Articulation.h
+//
+#pragma once
+#include "Body.h"
+#include "Constraints.h"
+#include <vector>
+
+/*
+====================================================
+Articulation
+
+A tree of bodies joined in reduced coordinates.  Instead of constraining
+every body's six degrees of freedom back together, each link only stores
+the angles of the joint to its parent, so the joints can't drift apart.
+Stepping uses Featherstone's articulated body algorithm, which is O(n)
+in the number of links.
+
+The tree is built from the existing joint definitions.  A joint handed to
+the articulation is only read once, it shouldn't also be solved by the scene.
+If one of the bodies has infinite mass it becomes a fixed root, otherwise
+the first body added floats freely.
+
+Contacts and gravity are still applied to the bodies by the scene.  Each step
+the change they made to a body's velocity is turned into an external force on
+that link, and the articulated body algorithm distributes it over the tree.
+====================================================
+*/
+class Articulation {
+public:
+	Articulation() : m_maxStepSize( 1.0f / 480.0f ), m_jointDamping( 0.05f ), m_isFinalized( false ), m_isFixedBase( false ) {}
+
+	// Revolute joints
+	bool AddJoint( const ConstraintHingeQuat & joint );
+	bool AddJoint( const ConstraintHingeQuatLimited & joint );
+
+	// Swing joints, two axes with the twist locked
+	bool AddJoint( const ConstraintConstantVelocity & joint );
+	bool AddJoint( const ConstraintConstantVelocityLimited & joint );
+
+	// Ball joint, three axes about the rest orientation
+	bool AddJoint( const ConstraintDistance & joint );
+
+	// Orders the links from the root out.  Returns false if the joints don't form a single tree.
+	bool Finalize();
+
+	void Step( const float dt_sec );
+
+	int GetNumLinks() const { return (int)m_links.size(); }
+	float GetMaxJointError() const;	// largest distance between a joint's two anchors
+
+	// The joint coordinates and the floating root, for scene snapshots.  Restoring doesn't allocate.
+	int GetStateSize() const;
+	void SaveState( void * state ) const;
+	void RestoreState( const void * state );
+
+	float m_maxStepSize;	// Step splits dt into steps no longer than this, zero for a single step
+	float m_jointDamping;	// fraction of the joint rates lost per second
+
+private:
+	static const int MAX_DOFS = 3;
+
+	struct jointDef_t {
+		Body * bodyA;
+		Body * bodyB;
+		Vec3 anchorA;	// in bodyA's space
+		Vec3 anchorB;	// in bodyB's space
+		Quat q0;		// relative orientation qA^-1 * qB at rest
+		int numDofs;
+		Vec3 axes[ MAX_DOFS ];	// in bodyA's space
+		float limit;	// radians either side of rest, zero for no limit
+	};
+	bool AddJointDef( const jointDef_t & def );
+
+	struct link_t {
+		Body * body;
+		int parent;	// index into m_links, -1 for the root
+
+		// The joint to the parent: orientation = parent * pre * R( axes, q ) * post
+		Quat pre;
+		Quat post;
+		Vec3 anchorParent;	// in the parent's body space
+		Vec3 anchorChild;	// in this body's space
+		int numDofs;
+		Vec3 axes[ MAX_DOFS ];	// in the frame after pre
+		float limit;
+
+		// Revolute and swing joints are rotations about their axes in turn.  A ball joint keeps a
+		// quaternion instead, so it can't gimbal lock, and its rates are about the fixed axes.
+		bool isBall;
+		Quat ballRotation;
+
+		float q[ MAX_DOFS ];
+		float qdot[ MAX_DOFS ];
+
+		// Kinematics, world space orientation about the center of mass
+		Vec3 centerOfMass;
+		Quat orientation;
+		Vec3 angularVelocity;
+		Vec3 linearVelocity;
+		Vec3 motionAngular[ MAX_DOFS ];	// columns of the motion subspace
+		Vec3 motionLinear[ MAX_DOFS ];
+		Vec3 biasAngular;	// velocity product acceleration
+		Vec3 biasLinear;
+
+		// The velocities written to the body last step, anything the scene added since is an external force
+		Vec3 cachedLinearVelocity;
+		Vec3 cachedAngularVelocity;
+		Vec3 externalForce;
+		Vec3 externalTorque;
+
+		// Articulated body algorithm scratch
+		float articulatedInertia[ 6 ][ 6 ];
+		float articulatedBias[ 6 ];
+		float U[ 6 ][ MAX_DOFS ];
+		float invD[ MAX_DOFS ][ MAX_DOFS ];
+		float u[ MAX_DOFS ];
+		float acceleration[ 6 ];
+	};
+
+	// Everything a link carries from one step to the next, the rest is rebuilt from it
+	struct linkState_t {
+		float q[ MAX_DOFS ];
+		float qdot[ MAX_DOFS ];
+		Quat ballRotation;
+		Vec3 centerOfMass;	// only the floating root's are integrated, the rest come from the joints
+		Quat orientation;
+		Vec3 linearVelocity;
+		Vec3 angularVelocity;
+		Vec3 cachedLinearVelocity;
+		Vec3 cachedAngularVelocity;
+	};
+
+	void UpdateKinematics();
+	void IntegrateVelocities( const float dt_sec );
+	void IntegratePositions( const float dt_sec );
+	void WriteBodies();
+
+	std::vector< jointDef_t > m_jointDefs;
+	std::vector< link_t > m_links;
+	bool m_isFinalized;
+	bool m_isFixedBase;
+};
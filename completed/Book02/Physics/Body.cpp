@@ -3,6 +3,11 @@
 //
 #include "Body.h"
 
+#if GPW_BODY_STATS
+std::atomic< int > Body::s_numInverseInertiaQueries( 0 );
+std::atomic< int > Body::s_numInverseInertiaUpdates( 0 );
+#endif
+
 /*
 ====================================================
 Body::Body
@@ -11,8 +16,15 @@ Body::Body
 Body::Body() :
 m_position( 0.0f ),
 m_orientation( 0.0f, 0.0f, 0.0f, 1.0f ),
-m_shape( NULL ) {
+m_shape( NULL ),
+m_enableCCD( true ),
+m_solverIndex( -1 ),
+m_invInertiaShape( NULL ),
+m_invInertiaMass( 0.0f ),
+m_invInertiaOrientation( 0.0f, 0.0f, 0.0f, 0.0f ) {
 	m_linearVelocity.Zero();
+	m_invInertiaTensorBodySpace.Zero();
+	m_invInertiaTensorWorldSpace.Zero();
 }
 
 /*
@@ -64,9 +76,7 @@ Body::GetInverseInertiaTensorBodySpace
 ====================================================
 */
 Mat3 Body::GetInverseInertiaTensorBodySpace() const {
-	Mat3 inertiaTensor		= m_shape->InertiaTensor();
-	Mat3 invInertiaTensor	= inertiaTensor.Inverse() * m_invMass;
-	return invInertiaTensor;
+	return m_invInertiaTensorBodySpace;
 }
 
 /*
@@ -75,11 +85,52 @@ Body::GetInverseInertiaTensorWorldSpace
 ====================================================
 */
 Mat3 Body::GetInverseInertiaTensorWorldSpace() const {
-	Mat3 inertiaTensor		= m_shape->InertiaTensor();
-	Mat3 invInertiaTensor	= inertiaTensor.Inverse() * m_invMass;
-	Mat3 orient					= m_orientation.ToMat3();
-	invInertiaTensor		= orient * invInertiaTensor * orient.Transpose();
-	return invInertiaTensor;
+#if GPW_BODY_STATS
+	s_numInverseInertiaQueries.fetch_add( 1, std::memory_order_relaxed );
+#endif
+	return m_invInertiaTensorWorldSpace;
+}
+
+/*
+====================================================
+Body::UpdateInertiaTensors
+
+Rebuilds the cached inverse inertia tensors.  Must be called whenever the
+orientation, shape or mass is changed outside of Body::Update.  Nothing is
+rebuilt if none of them changed since the last call, so calling it again on a
+body that hasn't moved is only a compare.
+====================================================
+*/
+void Body::UpdateInertiaTensors() {
+	if ( NULL == m_shape ) {
+		return;
+	}
+
+	// The body space tensor only needs rebuilding when the shape or mass changes
+	const bool isBodySpaceStale = ( m_shape != m_invInertiaShape || m_invMass != m_invInertiaMass );
+	if ( isBodySpaceStale ) {
+		if ( 0.0f == m_invMass ) {
+			// Infinite mass, there's nothing to invert
+			m_invInertiaTensorBodySpace.Zero();
+		} else {
+			Mat3 inertiaTensor			= m_shape->InertiaTensor();
+			m_invInertiaTensorBodySpace	= inertiaTensor.Inverse() * m_invMass;
+		}
+		m_invInertiaShape			= m_shape;
+		m_invInertiaMass			= m_invMass;
+	}
+
+	const bool isOrientationStale = ( m_orientation.x != m_invInertiaOrientation.x || m_orientation.y != m_invInertiaOrientation.y || m_orientation.z != m_invInertiaOrientation.z || m_orientation.w != m_invInertiaOrientation.w );
+	if ( !isBodySpaceStale && !isOrientationStale ) {
+		return;
+	}
+
+	Mat3 orient						= m_orientation.ToMat3();
+	m_invInertiaTensorWorldSpace	= orient * m_invInertiaTensorBodySpace * orient.Transpose();
+	m_invInertiaOrientation			= m_orientation;
+#if GPW_BODY_STATS
+	s_numInverseInertiaUpdates.fetch_add( 1, std::memory_order_relaxed );
+#endif
 }
 
 /*
@@ -140,6 +191,39 @@ void Body::ApplyImpulseAngular( const Vec3 & impulse ) {
 	}
 }
 
+/*
+====================================================
+Body::ApplyPositionImpulse
+
+Used by the position solver.  The impulse changes the position and orientation
+instead of the velocities, so fixing up penetration doesn't add any energy.
+====================================================
+*/
+void Body::ApplyPositionImpulse( const Vec3 & impulsePoint, const Vec3 & impulse ) {
+	if ( 0.0f == m_invMass ) {
+		return;
+	}
+
+	const Vec3 positionCM = GetCenterOfMassWorldSpace();
+	const Vec3 cmToPos = m_position - positionCM;
+
+	// The cached world space inverse inertia already includes the inverse mass
+	const Vec3 r = impulsePoint - positionCM;
+	const Vec3 dAngle = m_invInertiaTensorWorldSpace * r.Cross( impulse );
+	const float angle = dAngle.GetMagnitude();
+
+	Quat dq = Quat( 0, 0, 0, 1 );
+	if ( angle > 0.0f ) {
+		dq = Quat( dAngle, angle );
+		m_orientation = dq * m_orientation;
+		m_orientation.Normalize();
+	}
+
+	m_position = positionCM + impulse * m_invMass + dq.RotatePoint( cmToPos );
+
+	UpdateInertiaTensors();
+}
+
 /*
 ====================================================
 Body::Update
@@ -161,7 +245,14 @@ void Body::Update( const float dt_sec ) {
 	// a = I^-1 ( w x I * w )
 	Mat3 orientation = m_orientation.ToMat3();
 	Mat3 inertiaTensor = orientation * m_shape->InertiaTensor() * orientation.Transpose();
-	Vec3 alpha = inertiaTensor.Inverse() * ( m_angularVelocity.Cross( inertiaTensor * m_angularVelocity ) );
+	Mat3 invInertiaTensor;
+	if ( 0.0f != m_invMass ) {
+		// The cached tensor is scaled by the inverse mass, undo that rather than invert again
+		invInertiaTensor = m_invInertiaTensorWorldSpace * ( 1.0f / m_invMass );
+	} else {
+		invInertiaTensor = inertiaTensor.Inverse();
+	}
+	Vec3 alpha = invInertiaTensor * ( m_angularVelocity.Cross( inertiaTensor * m_angularVelocity ) );
 	m_angularVelocity += alpha * dt_sec;
 
 	// Update orientation
@@ -172,4 +263,43 @@ void Body::Update( const float dt_sec ) {
 
 	// Now get the new model position
 	m_position = positionCM + dq.RotatePoint( cmToPos );
+
+	// The orientation changed, so the world space inertia has too
+	UpdateInertiaTensors();
+}
+
+/*
+====================================================
+SolverBodies::Gather
+====================================================
+*/
+void SolverBodies::Gather( Body * bodies, const int numBodies ) {
+	m_linearVelocity.resize( numBodies );
+	m_angularVelocity.resize( numBodies );
+	m_invMass.resize( numBodies );
+	m_invInertiaTensorWorldSpace.resize( numBodies );
+
+	for ( int i = 0; i < numBodies; i++ ) {
+		Body & body = bodies[ i ];
+		body.m_solverIndex = i;
+
+		m_linearVelocity[ i ]				= body.m_linearVelocity;
+		m_angularVelocity[ i ]				= body.m_angularVelocity;
+		m_invMass[ i ]						= body.m_invMass;
+		m_invInertiaTensorWorldSpace[ i ]	= body.GetInverseInertiaTensorWorldSpace();
+	}
+}
+
+/*
+====================================================
+SolverBodies::Scatter
+====================================================
+*/
+void SolverBodies::Scatter( Body * bodies, const int numBodies ) const {
+	for ( int i = 0; i < numBodies; i++ ) {
+		Body & body = bodies[ i ];
+		body.m_linearVelocity	= m_linearVelocity[ i ];
+		body.m_angularVelocity	= m_angularVelocity[ i ];
+		body.m_solverIndex = -1;
+	}
 }
\ No newline at end of file
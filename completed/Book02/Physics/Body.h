@@ -7,9 +7,13 @@
 #include "../Math/Matrix.h"
 #include "../Math/Bounds.h"
 #include "Shapes.h"
+#include <vector>
+#include <atomic>
 
-#include "../Renderer/model.h"
-#include "../Renderer/shader.h"
+// Counts the inverse inertia queries and rebuilds, for profiling the cache
+#ifndef GPW_BODY_STATS
+#define GPW_BODY_STATS 0
+#endif
 
 /*
 ====================================================
@@ -30,6 +34,10 @@ public:
 	float		m_friction;
 	Shape *		m_shape;
 
+	bool		m_enableCCD;	// false keeps the body on the discrete test no matter how fast it moves
+
+	int			m_solverIndex;	// Index into the SolverBodies while the constraint solver runs, -1 otherwise
+
 	Vec3 GetCenterOfMassWorldSpace() const;
 	Vec3 GetCenterOfMassModelSpace() const;
 
@@ -38,10 +46,93 @@ public:
 
 	Mat3 GetInverseInertiaTensorBodySpace() const;
 	Mat3 GetInverseInertiaTensorWorldSpace() const;
+	void UpdateInertiaTensors();
 
 	void ApplyImpulse( const Vec3 & impulsePoint, const Vec3 & impulse );
 	void ApplyImpulseLinear( const Vec3 & impulse );
 	void ApplyImpulseAngular( const Vec3 & impulse );
 
+	// Moves and rotates the body directly, as if the impulse had acted for one second
+	void ApplyPositionImpulse( const Vec3 & impulsePoint, const Vec3 & impulse );
+
 	void Update( const float dt_sec );
-};
\ No newline at end of file
+
+#if GPW_BODY_STATS
+	// Profiling counters for the inverse inertia cache, off by default since every query pays for them
+	static std::atomic< int > s_numInverseInertiaQueries;	// calls to GetInverseInertiaTensorWorldSpace
+	static std::atomic< int > s_numInverseInertiaUpdates;	// times the world space inverse inertia was rebuilt
+#endif
+
+private:
+	// Cached inverse inertia tensors ( scaled by the inverse mass ).  The body space
+	// tensor only changes with the shape or mass, the world space tensor with the orientation.
+	Mat3		m_invInertiaTensorBodySpace;
+	Mat3		m_invInertiaTensorWorldSpace;
+	const Shape *	m_invInertiaShape;
+	float		m_invInertiaMass;
+	Quat		m_invInertiaOrientation;	// orientation the world space tensor was built for
+};
+
+/*
+====================================================
+SolverBodies
+
+Structure of arrays copy of the state the constraint solver touches.
+Bodies are gathered once before the solver iterations, the constraints
+read and write these arrays through Body::m_solverIndex, and the
+velocities are scattered back to the bodies once the iterations are done.
+====================================================
+*/
+class SolverBodies {
+public:
+	SolverBodies() {}
+
+	void Gather( Body * bodies, const int numBodies );
+	void Scatter( Body * bodies, const int numBodies ) const;
+
+	void ApplyImpulseLinear( const int idx, const Vec3 & impulse );
+	void ApplyImpulseAngular( const int idx, const Vec3 & impulse );
+
+	int Size() const { return (int)m_invMass.size(); }
+
+public:
+	std::vector< Vec3 >		m_linearVelocity;
+	std::vector< Vec3 >		m_angularVelocity;
+	std::vector< float >	m_invMass;
+	std::vector< Mat3 >		m_invInertiaTensorWorldSpace;
+};
+
+/*
+====================================================
+SolverBodies::ApplyImpulseLinear
+====================================================
+*/
+inline void SolverBodies::ApplyImpulseLinear( const int idx, const Vec3 & impulse ) {
+	const float invMass = m_invMass[ idx ];
+	if ( 0.0f == invMass ) {
+		return;
+	}
+
+	m_linearVelocity[ idx ] += impulse * invMass;
+}
+
+/*
+====================================================
+SolverBodies::ApplyImpulseAngular
+====================================================
+*/
+inline void SolverBodies::ApplyImpulseAngular( const int idx, const Vec3 & impulse ) {
+	if ( 0.0f == m_invMass[ idx ] ) {
+		return;
+	}
+
+	Vec3 & angularVelocity = m_angularVelocity[ idx ];
+	angularVelocity += m_invInertiaTensorWorldSpace[ idx ] * impulse;
+
+	// Same limit as Body::ApplyImpulseAngular
+	const float maxAngularSpeed = 30.0f;
+	if ( angularVelocity.GetLengthSqr() > maxAngularSpeed * maxAngularSpeed ) {
+		angularVelocity.Normalize();
+		angularVelocity *= maxAngularSpeed;
+	}
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 //  Broadphase.cpp
 //
 #include "Broadphase.h"
+#include "../Profiler/Profiler.h"
 
 struct psuedoBody_t {
 	int id;
@@ -110,6 +111,8 @@ BroadPhase
 ====================================================
 */
 void BroadPhase( const Body * bodies, const int num, std::vector< collisionPair_t > & finalPairs, const float dt_sec ) {
+	PROFILE_SCOPE( "BroadPhase" );
+
 	finalPairs.clear();
 
 	SweepAndPrune1D( bodies, num, finalPairs, dt_sec );
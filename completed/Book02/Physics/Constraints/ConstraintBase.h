@@ -9,6 +9,8 @@
 #include "../../Math/LCP.h"
 #include "../Body.h"
 #include <vector>
+#include <float.h>
+#include <string.h>
 
 /*
 ====================================================
@@ -17,10 +19,37 @@ Constraint
 */
 class Constraint {
 public:
-	virtual void PreSolve( const float dt_sec ) {}
+	Constraint() : m_bodyA( NULL ), m_bodyB( NULL ), m_solverType( LCP_SOLVER_LDLT ), m_solverBodies( NULL ), m_usePositionSolve( false ) {
+		LCP_ResetStats( m_solverStats );
+	}
+	virtual ~Constraint() {}
+
+	enum constraintType_t {
+		CONSTRAINT_DISTANCE,
+		CONSTRAINT_HINGE_QUAT,
+		CONSTRAINT_HINGE_QUAT_LIMITED,
+		CONSTRAINT_CONSTANT_VELOCITY,
+		CONSTRAINT_CONSTANT_VELOCITY_LIMITED,
+		CONSTRAINT_MOTOR,
+		CONSTRAINT_MOVER_SIMPLE,
+		CONSTRAINT_ORIENTATION,
+		CONSTRAINT_PENETRATION,
+	};
+	virtual constraintType_t GetType() const = 0;
+
+	virtual void PreSolve( const float /* dt_sec */ ) {}
 	virtual void Solve() {}
 	virtual void PostSolve() {}
 
+	// Position phase, run after the bodies have been moved.  Returns the largest error left.
+	virtual float SolvePositions() { return 0.0f; }
+
+	// Whatever the constraint carries from one step to the next ( warm starting impulses mostly ),
+	// copied out as plain bytes for scene snapshots.  Restoring must not allocate.
+	virtual int GetStateSize() const { return 0; }
+	virtual void SaveState( void * /* state */ ) const {}
+	virtual void RestoreState( const void * /* state */ ) {}
+
 	static Mat4 Left( const Quat & q );
 	static Mat4 Right( const Quat & q );
 
@@ -29,6 +58,22 @@ protected:
 	VecN GetVelocities() const;
 	void ApplyImpulses( const VecN & impulses );
 
+	MatN GetJWJt( const MatMN & jacobian ) const;
+	void ApplyImpulses( const MatMN & jacobian, const VecN & lambda );
+
+	float SolveAnchorPositions();
+
+	VecN SolveLCP( const MatN & A, const VecN & b );
+	VecN SolveLCP( const MatN & A, const VecN & b, const VecN & lo, const VecN & hi );
+
+	// Body state accessors that go through the solver bodies when they're bound
+	Vec3 GetLinearVelocity( const Body * body ) const;
+	Vec3 GetAngularVelocity( const Body * body ) const;
+	Mat3 GetInverseInertia( const Body * body ) const;
+	void ApplyBodyImpulses( Body * body, const Vec3 & impulseLinear, const Vec3 & impulseAngular );
+
+	static const int MAX_ROWS = 6;	// The most rows any one constraint's jacobian may have
+
 public:
 	Body * m_bodyA;
 	Body * m_bodyB;
@@ -38,8 +83,67 @@ public:
 
 	Vec3 m_anchorB;		// The anchor location in bodyB's space
 	Vec3 m_axisB;		// The axis direction in bodyB's space
+
+	lcpSolver_t m_solverType;	// Which solver this constraint's rows are handed to
+	lcpStats_t m_solverStats;	// Iteration and residual counters accumulated by SolveLCP
+
+	SolverBodies * m_solverBodies;	// When set, Solve reads and writes velocities here instead of the bodies
+
+	// When set, position error is left to SolvePositions instead of being fed into the velocities
+	bool m_usePositionSolve;
 };
 
+/*
+====================================================
+Constraint::GetLinearVelocity
+====================================================
+*/
+inline Vec3 Constraint::GetLinearVelocity( const Body * body ) const {
+	if ( NULL != m_solverBodies && body->m_solverIndex >= 0 ) {
+		return m_solverBodies->m_linearVelocity[ body->m_solverIndex ];
+	}
+	return body->m_linearVelocity;
+}
+
+/*
+====================================================
+Constraint::GetAngularVelocity
+====================================================
+*/
+inline Vec3 Constraint::GetAngularVelocity( const Body * body ) const {
+	if ( NULL != m_solverBodies && body->m_solverIndex >= 0 ) {
+		return m_solverBodies->m_angularVelocity[ body->m_solverIndex ];
+	}
+	return body->m_angularVelocity;
+}
+
+/*
+====================================================
+Constraint::GetInverseInertia
+====================================================
+*/
+inline Mat3 Constraint::GetInverseInertia( const Body * body ) const {
+	if ( NULL != m_solverBodies && body->m_solverIndex >= 0 ) {
+		return m_solverBodies->m_invInertiaTensorWorldSpace[ body->m_solverIndex ];
+	}
+	return body->GetInverseInertiaTensorWorldSpace();
+}
+
+/*
+====================================================
+Constraint::ApplyBodyImpulses
+====================================================
+*/
+inline void Constraint::ApplyBodyImpulses( Body * body, const Vec3 & impulseLinear, const Vec3 & impulseAngular ) {
+	if ( NULL != m_solverBodies && body->m_solverIndex >= 0 ) {
+		m_solverBodies->ApplyImpulseLinear( body->m_solverIndex, impulseLinear );
+		m_solverBodies->ApplyImpulseAngular( body->m_solverIndex, impulseAngular );
+		return;
+	}
+	body->ApplyImpulseLinear( impulseLinear );
+	body->ApplyImpulseAngular( impulseAngular );
+}
+
 /*
 ====================================================
 Constraint::GetInverseMassMatrix
@@ -53,7 +157,7 @@ inline MatMN Constraint::GetInverseMassMatrix() const {
 	invMassMatrix.rows[ 1 ][ 1 ] = m_bodyA->m_invMass;
 	invMassMatrix.rows[ 2 ][ 2 ] = m_bodyA->m_invMass;
 
-	Mat3 invInertiaA = m_bodyA->GetInverseInertiaTensorWorldSpace();
+	Mat3 invInertiaA = GetInverseInertia( m_bodyA );
 	for ( int i = 0; i < 3; i++ ) {
 		invMassMatrix.rows[ 3 + i ][ 3 + 0 ] = invInertiaA.rows[ i ][ 0 ];
 		invMassMatrix.rows[ 3 + i ][ 3 + 1 ] = invInertiaA.rows[ i ][ 1 ];
@@ -64,7 +168,7 @@ inline MatMN Constraint::GetInverseMassMatrix() const {
 	invMassMatrix.rows[ 7 ][ 7 ] = m_bodyB->m_invMass;
 	invMassMatrix.rows[ 8 ][ 8 ] = m_bodyB->m_invMass;
 
-	Mat3 invInertiaB = m_bodyB->GetInverseInertiaTensorWorldSpace();
+	Mat3 invInertiaB = GetInverseInertia( m_bodyB );
 	for ( int i = 0; i < 3; i++ ) {
 		invMassMatrix.rows[ 9 + i ][ 9 + 0 ] = invInertiaB.rows[ i ][ 0 ];
 		invMassMatrix.rows[ 9 + i ][ 9 + 1 ] = invInertiaB.rows[ i ][ 1 ];
@@ -82,21 +186,26 @@ Constraint::GetVelocities
 inline VecN Constraint::GetVelocities() const {
 	VecN q_dt( 12 );
 
-	q_dt[ 0 ] = m_bodyA->m_linearVelocity.x;
-	q_dt[ 1 ] = m_bodyA->m_linearVelocity.y;
-	q_dt[ 2 ] = m_bodyA->m_linearVelocity.z;
+	const Vec3 linearVelocityA = GetLinearVelocity( m_bodyA );
+	const Vec3 angularVelocityA = GetAngularVelocity( m_bodyA );
+	const Vec3 linearVelocityB = GetLinearVelocity( m_bodyB );
+	const Vec3 angularVelocityB = GetAngularVelocity( m_bodyB );
+
+	q_dt[ 0 ] = linearVelocityA.x;
+	q_dt[ 1 ] = linearVelocityA.y;
+	q_dt[ 2 ] = linearVelocityA.z;
 
-	q_dt[ 3 ] = m_bodyA->m_angularVelocity.x;
-	q_dt[ 4 ] = m_bodyA->m_angularVelocity.y;
-	q_dt[ 5 ] = m_bodyA->m_angularVelocity.z;
+	q_dt[ 3 ] = angularVelocityA.x;
+	q_dt[ 4 ] = angularVelocityA.y;
+	q_dt[ 5 ] = angularVelocityA.z;
 
-	q_dt[ 6 ] = m_bodyB->m_linearVelocity.x;
-	q_dt[ 7 ] = m_bodyB->m_linearVelocity.y;
-	q_dt[ 8 ] = m_bodyB->m_linearVelocity.z;
+	q_dt[ 6 ] = linearVelocityB.x;
+	q_dt[ 7 ] = linearVelocityB.y;
+	q_dt[ 8 ] = linearVelocityB.z;
 
-	q_dt[ 9 ] = m_bodyB->m_angularVelocity.x;
-	q_dt[ 10] = m_bodyB->m_angularVelocity.y;
-	q_dt[ 11] = m_bodyB->m_angularVelocity.z;
+	q_dt[ 9 ] = angularVelocityB.x;
+	q_dt[ 10] = angularVelocityB.y;
+	q_dt[ 11] = angularVelocityB.z;
 
 	return q_dt;
 }
@@ -128,11 +237,149 @@ inline void Constraint::ApplyImpulses( const VecN & impulses ) {
 	torqueInternalB[ 1 ] = impulses[ 10];
 	torqueInternalB[ 2 ] = impulses[ 11];
 
-	m_bodyA->ApplyImpulseLinear( forceInternalA );
-	m_bodyA->ApplyImpulseAngular( torqueInternalA );
+	ApplyBodyImpulses( m_bodyA, forceInternalA, torqueInternalA );
+	ApplyBodyImpulses( m_bodyB, forceInternalB, torqueInternalB );
+}
+
+/*
+====================================================
+Constraint::GetJWJt
+
+Builds J * W * J^T without forming the 12x12 inverse mass matrix.
+W is block diagonal ( invMassA * I, invInertiaA, invMassB * I, invInertiaB ),
+so each 3-wide block of a jacobian row only needs its own 3x3 block of W.
+====================================================
+*/
+inline MatN Constraint::GetJWJt( const MatMN & jacobian ) const {
+	assert( jacobian.M <= MAX_ROWS );
+	const int numRows = jacobian.M;
+
+	const float invMassA = m_bodyA->m_invMass;
+	const float invMassB = m_bodyB->m_invMass;
+	const Mat3 invInertiaA = GetInverseInertia( m_bodyA );
+	const Mat3 invInertiaB = GetInverseInertia( m_bodyB );
+
+	// Split each row into its four blocks and pre-multiply the angular blocks by the inverse inertia
+	Vec3 linearA[ MAX_ROWS ];
+	Vec3 angularA[ MAX_ROWS ];
+	Vec3 linearB[ MAX_ROWS ];
+	Vec3 angularB[ MAX_ROWS ];
+	Vec3 invInertiaAngularA[ MAX_ROWS ];
+	Vec3 invInertiaAngularB[ MAX_ROWS ];
+	for ( int i = 0; i < numRows; i++ ) {
+		const VecN & row = jacobian.rows[ i ];
+		linearA[ i ]	= Vec3( row[ 0 ], row[ 1 ], row[ 2 ] );
+		angularA[ i ]	= Vec3( row[ 3 ], row[ 4 ], row[ 5 ] );
+		linearB[ i ]	= Vec3( row[ 6 ], row[ 7 ], row[ 8 ] );
+		angularB[ i ]	= Vec3( row[ 9 ], row[ 10], row[ 11] );
+
+		invInertiaAngularA[ i ] = invInertiaA * angularA[ i ];
+		invInertiaAngularB[ i ] = invInertiaB * angularB[ i ];
+	}
+
+	// J * W * J^T is symmetric, so only build the upper triangle and mirror it
+	MatN J_W_Jt( numRows );
+	for ( int i = 0; i < numRows; i++ ) {
+		for ( int j = i; j < numRows; j++ ) {
+			float sum = 0.0f;
+			sum += linearA[ i ].Dot( linearA[ j ] ) * invMassA;
+			sum += angularA[ i ].Dot( invInertiaAngularA[ j ] );
+			sum += linearB[ i ].Dot( linearB[ j ] ) * invMassB;
+			sum += angularB[ i ].Dot( invInertiaAngularB[ j ] );
+
+			J_W_Jt.rows[ i ][ j ] = sum;
+			J_W_Jt.rows[ j ][ i ] = sum;
+		}
+	}
+
+	return J_W_Jt;
+}
+
+/*
+====================================================
+Constraint::ApplyImpulses
+
+Applies J^T * lambda directly from the rows of the jacobian,
+without building the transposed matrix.
+====================================================
+*/
+inline void Constraint::ApplyImpulses( const MatMN & jacobian, const VecN & lambda ) {
+	Vec3 forceInternalA( 0.0f );
+	Vec3 torqueInternalA( 0.0f );
+	Vec3 forceInternalB( 0.0f );
+	Vec3 torqueInternalB( 0.0f );
+
+	for ( int i = 0; i < jacobian.M; i++ ) {
+		const VecN & row = jacobian.rows[ i ];
+		const float l = lambda[ i ];
+		if ( 0.0f == l ) {
+			continue;
+		}
+
+		forceInternalA	+= Vec3( row[ 0 ], row[ 1 ], row[ 2 ] ) * l;
+		torqueInternalA	+= Vec3( row[ 3 ], row[ 4 ], row[ 5 ] ) * l;
+		forceInternalB	+= Vec3( row[ 6 ], row[ 7 ], row[ 8 ] ) * l;
+		torqueInternalB	+= Vec3( row[ 9 ], row[ 10], row[ 11] ) * l;
+	}
+
+	ApplyBodyImpulses( m_bodyA, forceInternalA, torqueInternalA );
+	ApplyBodyImpulses( m_bodyB, forceInternalB, torqueInternalB );
+}
+
+/*
+====================================================
+Constraint::SolveLCP
+====================================================
+*/
+inline VecN Constraint::SolveLCP( const MatN & A, const VecN & b ) {
+	return LCP_Solve( m_solverType, A, b, &m_solverStats );
+}
+
+/*
+====================================================
+Constraint::SolveLCP
+====================================================
+*/
+inline VecN Constraint::SolveLCP( const MatN & A, const VecN & b, const VecN & lo, const VecN & hi ) {
+	return LCP_Solve( m_solverType, A, b, lo, hi, &m_solverStats );
+}
+
+/*
+====================================================
+Constraint::SolveAnchorPositions
+
+Non-linear Gauss-Seidel step that pulls the two anchors back together.
+Shared by the joints whose anchors are meant to coincide.
+====================================================
+*/
+inline float Constraint::SolveAnchorPositions() {
+	const float slop = 0.005f;
+	const float beta = 0.2f;
+	const float maxCorrection = 0.2f;
+
+	const Vec3 a = m_bodyA->BodySpaceToWorldSpace( m_anchorA );
+	const Vec3 b = m_bodyB->BodySpaceToWorldSpace( m_anchorB );
+	const Vec3 ab = b - a;
+	const float error = ab.GetMagnitude();
+	if ( error <= slop ) {
+		return error;
+	}
+	const Vec3 n = ab / error;
+
+	const Vec3 ra = a - m_bodyA->GetCenterOfMassWorldSpace();
+	const Vec3 rb = b - m_bodyB->GetCenterOfMassWorldSpace();
+	const Vec3 angularA = ( m_bodyA->GetInverseInertiaTensorWorldSpace() * ra.Cross( n ) ).Cross( ra );
+	const Vec3 angularB = ( m_bodyB->GetInverseInertiaTensorWorldSpace() * rb.Cross( n ) ).Cross( rb );
+	const float K = m_bodyA->m_invMass + m_bodyB->m_invMass + ( angularA + angularB ).Dot( n );
+	if ( K <= 0.0f ) {
+		return error;
+	}
 
-	m_bodyB->ApplyImpulseLinear( forceInternalB );
-	m_bodyB->ApplyImpulseAngular( torqueInternalB );
+	const float correction = ( beta * ( error - slop ) < maxCorrection ) ? beta * ( error - slop ) : maxCorrection;
+	const Vec3 impulse = n * ( correction / K );
+	m_bodyA->ApplyPositionImpulse( a, impulse );
+	m_bodyB->ApplyPositionImpulse( b, impulse * -1.0f );
+	return error;
 }
 
 /*
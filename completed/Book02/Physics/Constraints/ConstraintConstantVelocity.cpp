@@ -110,8 +110,7 @@ void ConstraintConstantVelocity::PreSolve( const float dt_sec ) {
 	//
 	// Apply warm starting from last frame
 	//
-	const VecN impulses = m_Jacobian.Transpose() * m_cachedLambda;
-	ApplyImpulses( impulses );
+	ApplyImpulses( m_Jacobian, m_cachedLambda );
 
 	//
 	//	Calculate the baumgarte stabilization
@@ -120,6 +119,9 @@ void ConstraintConstantVelocity::PreSolve( const float dt_sec ) {
 	C = std::max( 0.0f, C - 0.01f );
 	const float Beta = 0.05f;
 	m_baumgarte = ( Beta / dt_sec ) * C;
+	if ( m_usePositionSolve ) {
+		m_baumgarte = 0.0f;	// SolvePositions pulls the anchors together instead
+	}
 }
 
 /*
@@ -128,21 +130,17 @@ ConstraintConstantVelocity::Solve
 ================================
 */
 void ConstraintConstantVelocity::Solve() {
-	const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
 	// Build the system of equations
 	const VecN q_dt = GetVelocities();
-	const MatMN invMassMatrix = GetInverseMassMatrix();
-	const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
+	const MatN J_W_Jt = GetJWJt( m_Jacobian );
 	VecN rhs = m_Jacobian * q_dt * -1.0f;
 	rhs[ 0 ] -= m_baumgarte;
 
 	// Solve for the Lagrange multipliers
-	const VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
+	const VecN lambdaN = SolveLCP( J_W_Jt, rhs );
 
 	// Apply the impulses
-	const VecN impulses = JacobianTranspose * lambdaN;
-	ApplyImpulses( impulses );
+	ApplyImpulses( m_Jacobian, lambdaN );
 
 	// Accumulate the impulses for warm starting
 	m_cachedLambda += lambdaN;
@@ -225,18 +223,18 @@ void ConstraintConstantVelocityLimited::PreSolve( const float dt_sec ) {
 	m_angleV = 2.0f * asinf( qrr.xyz().Dot( v ) ) * 180.0f / pi;
 
 	m_isAngleViolatedU = false;
-	if ( m_angleU > 45.0f ) {
+	if ( m_angleU > LIMIT_DEGREES ) {
 		m_isAngleViolatedU = true;
 	}
-	if ( m_angleU < -45.0f ) {
+	if ( m_angleU < -LIMIT_DEGREES ) {
 		m_isAngleViolatedU = true;
 	}
 
 	m_isAngleViolatedV = false;
-	if ( m_angleV > 45.0f ) {
+	if ( m_angleV > LIMIT_DEGREES ) {
 		m_isAngleViolatedV = true;
 	}
-	if ( m_angleV < -45.0f ) {
+	if ( m_angleV < -LIMIT_DEGREES ) {
 		m_isAngleViolatedV = true;
 	}
 
@@ -353,8 +351,7 @@ void ConstraintConstantVelocityLimited::PreSolve( const float dt_sec ) {
 	//
 	// Apply warm starting from last frame
 	//
-	const VecN impulses = m_Jacobian.Transpose() * m_cachedLambda;
-	ApplyImpulses( impulses );
+	ApplyImpulses( m_Jacobian, m_cachedLambda );
 
 	//
 	//	Calculate the baumgarte stabilization
@@ -363,6 +360,9 @@ void ConstraintConstantVelocityLimited::PreSolve( const float dt_sec ) {
 	C = std::max( 0.0f, C - 0.01f );
 	const float Beta = 0.05f;
 	m_baumgarte = ( Beta / dt_sec ) * C;
+	if ( m_usePositionSolve ) {
+		m_baumgarte = 0.0f;	// SolvePositions pulls the anchors together instead
+	}
 }
 
 /*
@@ -371,17 +371,37 @@ ConstraintConstantVelocityLimited::Solve
 ================================
 */
 void ConstraintConstantVelocityLimited::Solve() {
-	const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
 	// Build the system of equations
 	const VecN q_dt = GetVelocities();
-	const MatMN invMassMatrix = GetInverseMassMatrix();
-	const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
+	const MatN J_W_Jt = GetJWJt( m_Jacobian );
 	VecN rhs = m_Jacobian * q_dt * -1.0f;
 	rhs[ 0 ] -= m_baumgarte;
 
 	// Solve for the Lagrange multipliers
-	VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
+	// The angle limits may only push back towards the allowed range
+	VecN lo( rhs.N );
+	VecN hi( rhs.N );
+	for ( int i = 0; i < rhs.N; i++ ) {
+		lo[ i ] = -FLT_MAX;
+		hi[ i ] = FLT_MAX;
+	}
+	if ( m_isAngleViolatedU ) {
+		if ( m_angleU > 0.0f ) {
+			hi[ 2 ] = 0.0f;
+		}
+		if ( m_angleU < 0.0f ) {
+			lo[ 2 ] = 0.0f;
+		}
+	}
+	if ( m_isAngleViolatedV ) {
+		if ( m_angleV > 0.0f ) {
+			hi[ 3 ] = 0.0f;
+		}
+		if ( m_angleV < 0.0f ) {
+			lo[ 3 ] = 0.0f;
+		}
+	}
+	VecN lambdaN = SolveLCP( J_W_Jt, rhs, lo, hi );
 
 	// Clamp the torque from the angle constraint.
 	// We need to make sure it's a restorative torque.
@@ -403,8 +423,7 @@ void ConstraintConstantVelocityLimited::Solve() {
 	}
 
 	// Apply the impulses
-	const VecN impulses = JacobianTranspose * lambdaN;
-	ApplyImpulses( impulses );
+	ApplyImpulses( m_Jacobian, lambdaN );
 
 	// Accumulate the impulses for warm starting
 	m_cachedLambda += lambdaN;
@@ -15,10 +15,17 @@ public:
 		m_cachedLambda.Zero();
 		m_baumgarte = 0.0f;
 	}
+	constraintType_t GetType() const override { return CONSTRAINT_CONSTANT_VELOCITY; }
+
 	void PreSolve( const float dt_sec ) override;
 	void Solve() override;
+	float SolvePositions() override { return SolveAnchorPositions(); }
 	void PostSolve() override;
 
+	int GetStateSize() const override { return m_cachedLambda.N * sizeof( float ); }
+	void SaveState( void * state ) const override { memcpy( state, m_cachedLambda.data, GetStateSize() ); }
+	void RestoreState( const void * state ) override { memcpy( m_cachedLambda.data, state, GetStateSize() ); }
+
 	Quat m_q0;	// The initial relative quaternion q1 * q2^-1
 
 	VecN m_cachedLambda;
@@ -41,11 +48,21 @@ public:
 		m_isAngleViolatedV = false;
 		m_angleU = 0.0f;
 		m_angleV = 0.0f;
+		m_solverType = LCP_SOLVER_PGS;
 	}
+	constraintType_t GetType() const override { return CONSTRAINT_CONSTANT_VELOCITY_LIMITED; }
+
+	static constexpr float LIMIT_DEGREES = 45.0f;	// Both axes swing this far either side of m_q0
+
 	void PreSolve( const float dt_sec ) override;
 	void Solve() override;
+	float SolvePositions() override { return SolveAnchorPositions(); }
 	void PostSolve() override;
 
+	int GetStateSize() const override { return m_cachedLambda.N * sizeof( float ); }
+	void SaveState( void * state ) const override { memcpy( state, m_cachedLambda.data, GetStateSize() ); }
+	void RestoreState( const void * state ) override { memcpy( m_cachedLambda.data, state, GetStateSize() ); }
+
 	Quat m_q0;	// The initial relative quaternion q1^-1 * q2
 
 	VecN m_cachedLambda;
@@ -46,8 +46,7 @@ void ConstraintDistance::PreSolve( const float dt_sec ) {
 	//
 	// Apply warm starting from last frame
 	//
-	const VecN impulses = m_Jacobian.Transpose() * m_cachedLambda;
-	ApplyImpulses( impulses );
+	ApplyImpulses( m_Jacobian, m_cachedLambda );
 
 	//
 	//	Calculate the baumgarte stabilization
@@ -56,6 +55,9 @@ void ConstraintDistance::PreSolve( const float dt_sec ) {
 	C = std::max( 0.0f, C - 0.01f );
 	const float Beta = 0.05f;
 	m_baumgarte = ( Beta / dt_sec ) * C;
+	if ( m_usePositionSolve ) {
+		m_baumgarte = 0.0f;	// SolvePositions pulls the anchors together instead
+	}
 }
 
 /*
@@ -64,21 +66,17 @@ ConstraintDistance::Solve
 ================================
 */
 void ConstraintDistance::Solve() {
-	const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
 	// Build the system of equations
 	const VecN q_dt = GetVelocities();
-	const MatMN invMassMatrix = GetInverseMassMatrix();
-	const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
+	const MatN J_W_Jt = GetJWJt( m_Jacobian );
 	VecN rhs = m_Jacobian * q_dt * -1.0f;
 	rhs[ 0 ] -= m_baumgarte;
 	
 	// Solve for the Lagrange multipliers
-	const VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
+	const VecN lambdaN = SolveLCP( J_W_Jt, rhs );
 
 	// Apply the impulses
-	const VecN impulses = JacobianTranspose * lambdaN;
-	ApplyImpulses( impulses );
+	ApplyImpulses( m_Jacobian, lambdaN );
 
 	// Accumulate the impulses for warm starting
 	m_cachedLambda += lambdaN;
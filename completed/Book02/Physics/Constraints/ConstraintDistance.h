@@ -18,10 +18,17 @@ public:
 		m_baumgarte = 0.0f;
 	}
 
+	constraintType_t GetType() const override { return CONSTRAINT_DISTANCE; }
+
 	void PreSolve( const float dt_sec ) override;
 	void Solve() override;
+	float SolvePositions() override { return SolveAnchorPositions(); }
 	void PostSolve() override;
 
+	int GetStateSize() const override { return m_cachedLambda.N * sizeof( float ); }
+	void SaveState( void * state ) const override { memcpy( state, m_cachedLambda.data, GetStateSize() ); }
+	void RestoreState( const void * state ) override { memcpy( m_cachedLambda.data, state, GetStateSize() ); }
+
 private:
 	MatMN m_Jacobian;
 
@@ -51,8 +51,6 @@ void ConstraintHingeQuat::PreSolve( const float dt_sec ) {
 	const Mat4 MatA = P * Left( q1_inv ) * Right( q2 * q0_inv ) * P_T * -0.5f;
 	const Mat4 MatB = P * Left( q1_inv ) * Right( q2 * q0_inv ) * P_T * 0.5f;
 
-	const MatMN invMassMatrix = GetInverseMassMatrix();
-
 	m_Jacobian.Zero();
 
 	//
@@ -134,8 +132,7 @@ void ConstraintHingeQuat::PreSolve( const float dt_sec ) {
 	//
 	// Apply warm starting from last frame
 	//
-	const VecN impulses = m_Jacobian.Transpose() * m_cachedLambda;
-	ApplyImpulses( impulses );
+	ApplyImpulses( m_Jacobian, m_cachedLambda );
 
 	//
 	//	Calculate the baumgarte stabilization
@@ -144,6 +141,9 @@ void ConstraintHingeQuat::PreSolve( const float dt_sec ) {
 	C = std::max( 0.0f, C - 0.01f );
 	const float Beta = 0.05f;
 	m_baumgarte = ( Beta / dt_sec ) * C;
+	if ( m_usePositionSolve ) {
+		m_baumgarte = 0.0f;	// SolvePositions pulls the anchors together instead
+	}
 }
 
 /*
@@ -152,21 +152,17 @@ ConstraintHingeQuat::Solve
 ================================
 */
 void ConstraintHingeQuat::Solve() {
-	const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
 	// Build the system of equations
 	const VecN q_dt = GetVelocities();
-	const MatMN invMassMatrix = GetInverseMassMatrix();
-	const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
+	const MatN J_W_Jt = GetJWJt( m_Jacobian );
 	VecN rhs = m_Jacobian * q_dt * -1.0f;
 	rhs[ 0 ] -= m_baumgarte;
 
 	// Solve for the Lagrange multipliers
-	const VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
+	const VecN lambdaN = SolveLCP( J_W_Jt, rhs );
 
 	// Apply the impulses
-	const VecN impulses = JacobianTranspose * lambdaN;
-	ApplyImpulses( impulses );
+	ApplyImpulses( m_Jacobian, lambdaN );
 
 	// Accumulate the impulses for warm starting
 	m_cachedLambda += lambdaN;
@@ -248,10 +244,10 @@ void ConstraintHingeQuatLimited::PreSolve( const float dt_sec ) {
 
 	// Check if there's an angle violation
 	m_isAngleViolated = false;
-	if ( relativeAngle > 45.0f ) {
+	if ( relativeAngle > LIMIT_DEGREES ) {
 		m_isAngleViolated = true;
 	}
-	if ( relativeAngle < -45.0f ) {
+	if ( relativeAngle < -LIMIT_DEGREES ) {
 		m_isAngleViolated = true;
 	}
 	m_relativeAngle = relativeAngle;
@@ -358,8 +354,7 @@ void ConstraintHingeQuatLimited::PreSolve( const float dt_sec ) {
 	//
 	// Apply warm starting from last frame
 	//
-	const VecN impulses = m_Jacobian.Transpose() * m_cachedLambda;
-	ApplyImpulses( impulses );
+	ApplyImpulses( m_Jacobian, m_cachedLambda );
 
 	//
 	//	Calculate the baumgarte stabilization
@@ -368,6 +363,9 @@ void ConstraintHingeQuatLimited::PreSolve( const float dt_sec ) {
 	C = std::max( 0.0f, C - 0.01f );
 	const float Beta = 0.05f;
 	m_baumgarte = ( Beta / dt_sec ) * C;
+	if ( m_usePositionSolve ) {
+		m_baumgarte = 0.0f;	// SolvePositions pulls the anchors together instead
+	}
 }
 
 /*
@@ -376,17 +374,29 @@ ConstraintHingeQuatLimited::Solve
 ================================
 */
 void ConstraintHingeQuatLimited::Solve() {
-	const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
 	// Build the system of equations
 	const VecN q_dt = GetVelocities();
-	const MatMN invMassMatrix = GetInverseMassMatrix();
-	const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
+	const MatN J_W_Jt = GetJWJt( m_Jacobian );
 	VecN rhs = m_Jacobian * q_dt * -1.0f;
 	rhs[ 0 ] -= m_baumgarte;
 
 	// Solve for the Lagrange multipliers
-	VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
+	// The angle limit may only push back towards the allowed range
+	VecN lo( rhs.N );
+	VecN hi( rhs.N );
+	for ( int i = 0; i < rhs.N; i++ ) {
+		lo[ i ] = -FLT_MAX;
+		hi[ i ] = FLT_MAX;
+	}
+	if ( m_isAngleViolated ) {
+		if ( m_relativeAngle > 0.0f ) {
+			hi[ 3 ] = 0.0f;
+		}
+		if ( m_relativeAngle < 0.0f ) {
+			lo[ 3 ] = 0.0f;
+		}
+	}
+	VecN lambdaN = SolveLCP( J_W_Jt, rhs, lo, hi );
 
 	// Clamp the torque from the angle constraint.
 	// We need to make sure it's a restorative torque.
@@ -400,8 +410,7 @@ void ConstraintHingeQuatLimited::Solve() {
 	}
 
 	// Apply the impulses
-	const VecN impulses = JacobianTranspose * lambdaN;
-	ApplyImpulses( impulses );
+	ApplyImpulses( m_Jacobian, lambdaN );
 
 	// Accumulate the impulses for warm starting
 	m_cachedLambda += lambdaN;
@@ -184,21 +184,17 @@ void ConstraintMotor::Solve() {
 	w_dt[ 10 ] = motorAxis[ 1 ] * m_motorSpeed;
 	w_dt[ 11 ] = motorAxis[ 2 ] * m_motorSpeed;
 
-	const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
 	// Build the system of equations
 	const VecN q_dt = GetVelocities() - w_dt;	// By subtracting by the desired velocity, the solver is tricked into applying the impulse to give us that velocity
-	const MatMN invMassMatrix = GetInverseMassMatrix();
-	const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
+	const MatN J_W_Jt = GetJWJt( m_Jacobian );
 	VecN rhs = m_Jacobian * q_dt * -1.0f;
 	for ( int i = 0; i < 3; i++ ) {
 		rhs[ i ] -= m_baumgarte[ i ];
 	}
 
 	// Solve for the Lagrange multipliers
-	VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
+	VecN lambdaN = SolveLCP( J_W_Jt, rhs );
 
 	// Apply the impulses
-	const VecN impulses = JacobianTranspose * lambdaN;
-	ApplyImpulses( impulses );
+	ApplyImpulses( m_Jacobian, lambdaN );
 }
\ No newline at end of file
@@ -13,7 +13,13 @@ class ConstraintMoverSimple : public Constraint {
 public:
 	ConstraintMoverSimple() : Constraint(), m_time( 0 ) {}
 
+	constraintType_t GetType() const override { return CONSTRAINT_MOVER_SIMPLE; }
+
 	void PreSolve( const float dt_sec ) override;
 
+	int GetStateSize() const override { return sizeof( m_time ); }
+	void SaveState( void * state ) const override { memcpy( state, &m_time, sizeof( m_time ) ); }
+	void RestoreState( const void * state ) override { memcpy( &m_time, state, sizeof( m_time ) ); }
+
 	float m_time;
 };
\ No newline at end of file
@@ -158,19 +158,15 @@ ConstraintOrientation::Solve
 ================================
 */
 void ConstraintOrientation::Solve() {
-	const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
 	// Build the system of equations
 	const VecN q_dt = GetVelocities();
-	const MatMN invMassMatrix = GetInverseMassMatrix();
-	const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
+	const MatN J_W_Jt = GetJWJt( m_Jacobian );
 	VecN rhs = m_Jacobian * q_dt * -1.0f;
 	rhs[ 0 ] -= m_baumgarte;
 
 	// Solve for the Lagrange multipliers
-	VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
+	VecN lambdaN = SolveLCP( J_W_Jt, rhs );
 
 	// Apply the impulses
-	const VecN impulses = JacobianTranspose * lambdaN;
-	ApplyImpulses( impulses );
+	ApplyImpulses( m_Jacobian, lambdaN );
 }
\ No newline at end of file
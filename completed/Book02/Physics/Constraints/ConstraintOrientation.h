@@ -10,6 +10,8 @@ public:
 		m_baumgarte = 0.0f;
 	}
 
+	constraintType_t GetType() const override { return CONSTRAINT_ORIENTATION; }
+
 	void PreSolve( const float dt_sec ) override;
 	void Solve() override;
 
@@ -104,30 +104,91 @@ void ConstraintPenetration::PreSolve( const float dt_sec ) {
 	//
 	// Apply warm starting from last frame
 	//
-	const VecN impulses = m_Jacobian.Transpose() * m_cachedLambda;
-	ApplyImpulses( impulses );
+	ApplyImpulses( m_Jacobian, m_cachedLambda );
+
+	UpdateBias( dt_sec );
+}
+
+/*
+====================================================
+ConstraintPenetration::PreSolveSubstep
+====================================================
+*/
+void ConstraintPenetration::PreSolveSubstep( const float dt_sec ) {
+	ApplyImpulses( m_Jacobian, m_cachedLambda );
+
+	UpdateBias( dt_sec );
+}
+
+/*
+====================================================
+ConstraintPenetration::UpdateBias
+
+Measures the current separation of the anchors and turns it into the velocity bias.
+Soft contacts use a damped spring tuned to the step size, which only corrects part of
+the error and lets go of part of the accumulated impulse each step.
+====================================================
+*/
+void ConstraintPenetration::UpdateBias( const float dt_sec ) {
+	const Vec3 a = m_bodyA->BodySpaceToWorldSpace( m_anchorA );
+	const Vec3 b = m_bodyB->BodySpaceToWorldSpace( m_anchorB );
+	const Vec3 normal = m_bodyA->m_orientation.RotatePoint( m_normal );
 
-	//
-	//	Calculate the baumgarte stabilization
-	//
 	float C = ( b - a ).Dot( normal );
 	C = std::min( 0.0f, C + 0.02f );	// Add slop
-	float Beta = 0.25f;
-	m_baumgarte = Beta * C / dt_sec;
+
+	if ( m_usePositionSolve ) {
+		// Penetration is fixed up by SolvePositions, the velocities only need to stop the approach
+		m_baumgarte = 0.0f;
+		m_softMassScale = 1.0f;
+		m_softImpulseScale = 0.0f;
+		return;
+	}
+
+	if ( m_contactHertz <= 0.0f ) {
+		//
+		//	Calculate the baumgarte stabilization
+		//
+		float Beta = 0.25f;
+		m_baumgarte = Beta * C / dt_sec;
+		m_softMassScale = 1.0f;
+		m_softImpulseScale = 0.0f;
+		return;
+	}
+
+	const float pi = acosf( -1.0f );
+	const float omega = 2.0f * pi * m_contactHertz;
+	const float a1 = 2.0f * m_contactDampingRatio + dt_sec * omega;
+	const float a2 = dt_sec * omega * a1;
+	const float a3 = 1.0f / ( 1.0f + a2 );
+
+	m_baumgarte = omega / a1 * C;
+	m_softMassScale = a2 * a3;
+	m_softImpulseScale = a3;
 }
 
 void ConstraintPenetration::Solve() {
-	const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
 	// Build the system of equations
 	const VecN q_dt = GetVelocities();
-	const MatMN invMassMatrix = GetInverseMassMatrix();
-	const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
+	const MatN J_W_Jt = GetJWJt( m_Jacobian );
 	VecN rhs = m_Jacobian * q_dt * -1.0f;
 	rhs[ 0 ] -= m_baumgarte;
 
+	// A soft contact only pushes back part of the way ( rigid contacts have a scale of one and zero )
+	rhs[ 0 ] = rhs[ 0 ] * m_softMassScale - m_softImpulseScale * m_cachedLambda[ 0 ] * J_W_Jt.rows[ 0 ][ 0 ];
+
 	// Solve for the Lagrange multipliers
-	VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
+	// The accumulated normal impulse may never pull, so bound this iteration's
+	// normal impulse by what has been accumulated so far.  Friction is clamped below,
+	// since its limit depends on the normal impulse.
+	VecN lo( rhs.N );
+	VecN hi( rhs.N );
+	for ( int i = 0; i < rhs.N; i++ ) {
+		lo[ i ] = -FLT_MAX;
+		hi[ i ] = FLT_MAX;
+	}
+	lo[ 0 ] = -m_cachedLambda[ 0 ];
+	VecN lambdaN = SolveLCP( J_W_Jt, rhs, lo, hi );
 
 	// Accumulate the impulses and clamp to within the constraint limits
 	VecN oldLambda = m_cachedLambda;
@@ -158,6 +219,166 @@ void ConstraintPenetration::Solve() {
 	lambdaN = m_cachedLambda - oldLambda;
 
 	// Apply the impulses
-	const VecN impulses = JacobianTranspose * lambdaN;
-	ApplyImpulses( impulses );
-}
\ No newline at end of file
+	ApplyImpulses( m_Jacobian, lambdaN );
+}
+
+/*
+====================================================
+ConstraintPenetration::SolvePositions
+
+Non-linear Gauss-Seidel: measures the penetration at the current positions and
+pushes the bodies apart directly.  Returns the remaining penetration depth.
+====================================================
+*/
+float ConstraintPenetration::SolvePositions() {
+	const float slop = 0.005f;
+	const float beta = 0.2f;
+	const float maxCorrection = 0.2f;
+
+	const Vec3 a = m_bodyA->BodySpaceToWorldSpace( m_anchorA );
+	const Vec3 b = m_bodyB->BodySpaceToWorldSpace( m_anchorB );
+	const Vec3 normal = m_bodyA->m_orientation.RotatePoint( m_normal );
+
+	// Negative when penetrating
+	const float C = ( b - a ).Dot( normal );
+	if ( C >= -slop ) {
+		return 0.0f;
+	}
+
+	const Vec3 ra = a - m_bodyA->GetCenterOfMassWorldSpace();
+	const Vec3 rb = b - m_bodyB->GetCenterOfMassWorldSpace();
+	const Vec3 angularA = ( m_bodyA->GetInverseInertiaTensorWorldSpace() * ra.Cross( normal ) ).Cross( ra );
+	const Vec3 angularB = ( m_bodyB->GetInverseInertiaTensorWorldSpace() * rb.Cross( normal ) ).Cross( rb );
+	const float K = m_bodyA->m_invMass + m_bodyB->m_invMass + ( angularA + angularB ).Dot( normal );
+	if ( K <= 0.0f ) {
+		return -C;
+	}
+
+	const float correction = std::min( beta * ( -C - slop ), maxCorrection );
+	const Vec3 impulse = normal * ( correction / K );
+	m_bodyA->ApplyPositionImpulse( a, impulse * -1.0f );
+	m_bodyB->ApplyPositionImpulse( b, impulse );
+	return -C;
+}
+
+/*
+====================================================
+ConstraintPenetration::SolveFriction
+
+Solves the two friction rows one at a time, bounded by the accumulated normal impulse.
+====================================================
+*/
+void ConstraintPenetration::SolveFriction() {
+	if ( m_friction <= 0.0f ) {
+		return;
+	}
+
+	const float umg = m_friction * 10.0f * 1.0f / ( m_bodyA->m_invMass + m_bodyB->m_invMass );
+	const float normalForce = fabsf( m_cachedLambda[ 0 ] * m_friction );
+	const float maxForce = ( umg > normalForce ) ? umg : normalForce;
+
+	const VecN q_dt = GetVelocities();
+	const MatN J_W_Jt = GetJWJt( m_Jacobian );
+	VecN lambdaN( 3 );
+	lambdaN.Zero();
+	for ( int row = 1; row < 3; row++ ) {
+		const float effectiveMass = J_W_Jt.rows[ row ][ row ];
+		if ( effectiveMass <= 0.0f ) {
+			continue;
+		}
+
+		float jv = 0.0f;
+		for ( int i = 0; i < 12; i++ ) {
+			jv += m_Jacobian.rows[ row ][ i ] * q_dt[ i ];
+		}
+
+		const float oldLambda = m_cachedLambda[ row ];
+		m_cachedLambda[ row ] = std::max( -maxForce, std::min( maxForce, oldLambda - jv / effectiveMass ) );
+		lambdaN[ row ] = m_cachedLambda[ row ] - oldLambda;
+	}
+
+	ApplyImpulses( m_Jacobian, lambdaN );
+}
+
+/*
+====================================================
+ConstraintPenetration::SolveNormal
+
+Gauss-Seidel on the normal row alone, for the contacts the block solver leaves out
+====================================================
+*/
+void ConstraintPenetration::SolveNormal() {
+	float jacobian[ 12 ];
+	float invMassJacobian[ 12 ];
+	GetNormalRow( jacobian, invMassJacobian );
+
+	float diagonal = 0.0f;
+	for ( int i = 0; i < 12; i++ ) {
+		diagonal += jacobian[ i ] * invMassJacobian[ i ];
+	}
+	if ( diagonal <= 0.0f ) {
+		return;
+	}
+
+	// Same soft contact scaling as Solve
+	const float rhs = -GetNormalVelocity() - m_baumgarte;
+	const float oldLambda = m_cachedLambda[ 0 ];
+	const float dLambda = rhs * m_softMassScale / diagonal - m_softImpulseScale * oldLambda;
+	m_cachedLambda[ 0 ] = std::max( 0.0f, oldLambda + dLambda );
+	ApplyNormalImpulse( m_cachedLambda[ 0 ] - oldLambda );
+}
+
+/*
+====================================================
+ConstraintPenetration::GetNormalRow
+
+The normal row of the jacobian and M^-1 * J^T for it
+====================================================
+*/
+void ConstraintPenetration::GetNormalRow( float jacobian[ 12 ], float invMassJacobian[ 12 ] ) const {
+	for ( int i = 0; i < 12; i++ ) {
+		jacobian[ i ] = m_Jacobian.rows[ 0 ][ i ];
+	}
+
+	const Vec3 linA( jacobian[ 0 ], jacobian[ 1 ], jacobian[ 2 ] );
+	const Vec3 angA( jacobian[ 3 ], jacobian[ 4 ], jacobian[ 5 ] );
+	const Vec3 linB( jacobian[ 6 ], jacobian[ 7 ], jacobian[ 8 ] );
+	const Vec3 angB( jacobian[ 9 ], jacobian[ 10 ], jacobian[ 11 ] );
+
+	const Vec3 wLinA = linA * m_bodyA->m_invMass;
+	const Vec3 wAngA = GetInverseInertia( m_bodyA ) * angA;
+	const Vec3 wLinB = linB * m_bodyB->m_invMass;
+	const Vec3 wAngB = GetInverseInertia( m_bodyB ) * angB;
+	for ( int i = 0; i < 3; i++ ) {
+		invMassJacobian[ 0 + i ] = wLinA[ i ];
+		invMassJacobian[ 3 + i ] = wAngA[ i ];
+		invMassJacobian[ 6 + i ] = wLinB[ i ];
+		invMassJacobian[ 9 + i ] = wAngB[ i ];
+	}
+}
+
+/*
+====================================================
+ConstraintPenetration::GetNormalVelocity
+====================================================
+*/
+float ConstraintPenetration::GetNormalVelocity() const {
+	const VecN q_dt = GetVelocities();
+	float jv = 0.0f;
+	for ( int i = 0; i < 12; i++ ) {
+		jv += m_Jacobian.rows[ 0 ][ i ] * q_dt[ i ];
+	}
+	return jv;
+}
+
+/*
+====================================================
+ConstraintPenetration::ApplyNormalImpulse
+====================================================
+*/
+void ConstraintPenetration::ApplyNormalImpulse( const float impulse ) {
+	VecN lambdaN( 3 );
+	lambdaN.Zero();
+	lambdaN[ 0 ] = impulse;
+	ApplyImpulses( m_Jacobian, lambdaN );
+}
@@ -10,10 +10,30 @@ public:
 		m_cachedLambda.Zero();
 		m_baumgarte = 0.0f;
 		m_friction = 0.0f;
+		m_solverType = LCP_SOLVER_PGS;
+		m_contactHertz = 0.0f;
+		m_contactDampingRatio = 0.0f;
+		m_softMassScale = 1.0f;
+		m_softImpulseScale = 0.0f;
 	}
 
+	constraintType_t GetType() const override { return CONSTRAINT_PENETRATION; }
+
 	void PreSolve( const float dt_sec ) override;
 	void Solve() override;
+	float SolvePositions() override;
+
+	// For the substeps after the first, the jacobian is kept from PreSolve.
+	// Only the separation is measured again, and last substep's impulse is reapplied.
+	void PreSolveSubstep( const float dt_sec );
+
+	// Pieces used by the manifold block solver, which solves the normal rows of
+	// all the contacts in a manifold together and the friction rows per contact
+	void SolveFriction();
+	void SolveNormal();
+	void GetNormalRow( float jacobian[ 12 ], float invMassJacobian[ 12 ] ) const;
+	float GetNormalVelocity() const;
+	void ApplyNormalImpulse( const float impulse );
 
 	VecN m_cachedLambda;
 	Vec3 m_normal;		// in Body A's local space
@@ -22,4 +42,13 @@ public:
 
 	float m_baumgarte;
 	float m_friction;
+
+	// Soft contact spring, a zero frequency means a rigid contact with baumgarte stabilization
+	float m_contactHertz;
+	float m_contactDampingRatio;
+	float m_softMassScale;
+	float m_softImpulseScale;
+
+private:
+	void UpdateBias( const float dt_sec );
 };
\ No newline at end of file
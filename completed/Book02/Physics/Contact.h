@@ -15,6 +15,10 @@ struct contact_t {
 	float separationDistance;	// positive when non-penetrating, negative when penetrating
 	float timeOfImpact;
 
+	// Packed ids of the touching features (see GJK_PackFeature), zero when unknown
+	unsigned int featureA;
+	unsigned int featureB;
+
 	Body * bodyA;
 	Body * bodyB;
 };
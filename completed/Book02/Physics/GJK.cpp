@@ -2,6 +2,13 @@
 //  GJK.cpp
 //
 #include "GJK.h"
+#include "../Profiler/Profiler.h"
+#include <string.h>
+
+std::atomic< int > g_numGJKCalls( 0 );
+std::atomic< int > g_numGJKIterations( 0 );
+std::atomic< int > g_numEPACalls( 0 );
+std::atomic< int > g_numEPAIterations( 0 );
 
 /*
 ================================================================================================
@@ -305,13 +312,17 @@ struct point_t {
 	Vec3 xyz;	// The point on the minkowski sum
 	Vec3 ptA;	// The point on bodyA
 	Vec3 ptB;	// The point on bodyB
+	int idA;	// The support feature on bodyA
+	int idB;	// The support feature on bodyB
 
-	point_t() : xyz( 0.0f ), ptA( 0.0f ), ptB( 0.0f ) {}
+	point_t() : xyz( 0.0f ), ptA( 0.0f ), ptB( 0.0f ), idA( -1 ), idB( -1 ) {}
 
 	const point_t & operator = ( const point_t & rhs ) {
 		xyz = rhs.xyz;
 		ptA = rhs.ptA;
 		ptB = rhs.ptB;
+		idA = rhs.idA;
+		idB = rhs.idB;
 		return *this;
 	}
 
@@ -331,12 +342,12 @@ point_t Support( const Body * bodyA, const Body * bodyB, Vec3 dir, const float b
 	point_t point;
 
 	// Find the point in A furthest in direction
-	point.ptA = bodyA->m_shape->Support( dir, bodyA->m_position, bodyA->m_orientation, bias );
+	point.ptA = bodyA->m_shape->Support( dir, bodyA->m_position, bodyA->m_orientation, bias, point.idA );
 
 	dir *= -1.0f;
 
 	// Find the point in B furthest in the opposite direction
-	point.ptB = bodyB->m_shape->Support( dir, bodyB->m_position, bodyB->m_orientation, bias );
+	point.ptB = bodyB->m_shape->Support( dir, bodyB->m_position, bodyB->m_orientation, bias, point.idB );
 
 	// Return the point, in the minkowski sum, furthest in the direction
 	point.xyz = point.ptA - point.ptB;
@@ -474,6 +485,8 @@ GJK_DoesIntersect
 ================================
 */
 bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB ) {
+	PROFILE_SCOPE( "GJK_DoesIntersect" );
+
 	const Vec3 origin( 0.0f );
 
 	int numPts = 1;
@@ -483,7 +496,10 @@ bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB ) {
 	float closestDist = 1e10f;
 	bool doesContainOrigin = false;
 	Vec3 newDir = simplexPoints[ 0 ].xyz * -1.0f;
+	int numIters = 0;
 	do {
+		numIters++;
+
 		// Get the new point to check on
 		point_t newPt = Support( bodyA, bodyB, newDir, 0.0f );
 
@@ -521,6 +537,9 @@ bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB ) {
 		doesContainOrigin = ( 4 == numPts );
 	} while ( !doesContainOrigin );
 
+	g_numGJKCalls.fetch_add( 1, std::memory_order_relaxed );
+	g_numGJKIterations.fetch_add( numIters, std::memory_order_relaxed );
+
 	return doesContainOrigin;
 }
 
@@ -569,7 +588,103 @@ void GJK_ClosestPoints( const Body * bodyA, const Body * bodyB, Vec3 & ptOnA, Ve
 	}
 }
 
-bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB, const float bias, Vec3 & ptOnA, Vec3 & ptOnB ) {
+/*
+================================
+GJK_ShapeCast
+
+Sweeps bodyA along translation against a stationary bodyB.  Sweeping A is the same as
+casting a ray from the origin along -translation into the minkowski difference A - B,
+so this is the GJK ray cast: each support plane the ray point is still in front of
+pushes the point along the ray, then the simplex is projected from the new point.
+toi is the fraction of the translation at first touch, normal points from A to B.
+================================
+*/
+bool GJK_ShapeCast( const Body * bodyA, const Body * bodyB, const Vec3 & translation, const float tolerance, float & toi, Vec3 & normal, int * numIterations ) {
+	const Vec3 rayDir = translation * -1.0f;
+	const int maxIters = 32;
+
+	float lambda = 0.0f;
+	Vec3 x( 0.0f );	// The ray point
+	normal.Zero();
+
+	int numPts = 0;
+	point_t simplexPoints[ 4 ];
+
+	Vec3 v = x - Support( bodyA, bodyB, Vec3( 1, 1, 1 ), 0.0f ).xyz;
+
+	int iters = 0;
+	bool didHit = true;
+	while ( v.GetLengthSqr() > tolerance * tolerance ) {
+		if ( iters >= maxIters ) {
+			break;
+		}
+		iters++;
+
+		const point_t newPt = Support( bodyA, bodyB, v, 0.0f );
+		const Vec3 w = x - newPt.xyz;
+		const float vw = v.Dot( w );
+		if ( vw > 0.0f ) {
+			// The ray point is in front of this support plane, so advance it to the plane
+			const float vr = v.Dot( rayDir );
+			if ( vr >= 0.0f ) {
+				didHit = false;
+				break;
+			}
+			lambda -= vw / vr;
+			if ( lambda > 1.0f ) {
+				didHit = false;
+				break;
+			}
+			x = rayDir * lambda;
+			normal = v;
+		}
+
+		// A repeated support point means the simplex can't get any closer
+		if ( numPts > 0 && HasPoint( simplexPoints, newPt ) ) {
+			break;
+		}
+		simplexPoints[ numPts ] = newPt;
+		numPts++;
+
+		// Project the ray point onto the simplex
+		Vec4 lambdas( 1, 0, 0, 0 );
+		if ( 1 == numPts ) {
+			v = x - simplexPoints[ 0 ].xyz;
+		} else {
+			point_t relativePoints[ 4 ];
+			for ( int i = 0; i < numPts; i++ ) {
+				relativePoints[ i ] = simplexPoints[ i ];
+				relativePoints[ i ].xyz = x - simplexPoints[ i ].xyz;
+			}
+			Vec3 newDir;
+			SimplexSignedVolumes( relativePoints, numPts, newDir, lambdas );
+			v = newDir * -1.0f;
+		}
+
+		SortValids( simplexPoints, lambdas );
+		numPts = NumValids( lambdas );
+		if ( 4 == numPts ) {
+			// The ray point is enclosed
+			break;
+		}
+	}
+
+	if ( NULL != numIterations ) {
+		*numIterations = iters;
+	}
+
+	if ( !didHit ) {
+		return false;
+	}
+
+	toi = lambda;
+	normal.Normalize();
+	return true;
+}
+
+bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB, const float bias, Vec3 & ptOnA, Vec3 & ptOnB, unsigned int * featureA, unsigned int * featureB ) {
+	PROFILE_SCOPE( "GJK_DoesIntersect contact" );
+
 	const Vec3 origin( 0.0f );
 
 	int numPts = 1;
@@ -579,7 +694,10 @@ bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB, const float bias
 	float closestDist = 1e10f;
 	bool doesContainOrigin = false;
 	Vec3 newDir = simplexPoints[ 0 ].xyz * -1.0f;
+	int numIters = 0;
 	do {
+		numIters++;
+
 		// Get the new point to check on
 		point_t newPt = Support( bodyA, bodyB, newDir, 0.0f );
 
@@ -617,6 +735,9 @@ bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB, const float bias
 		doesContainOrigin = ( 4 == numPts );
 	} while ( !doesContainOrigin );
 
+	g_numGJKCalls.fetch_add( 1, std::memory_order_relaxed );
+	g_numGJKIterations.fetch_add( numIters, std::memory_order_relaxed );
+
 	if ( !doesContainOrigin ) {
 		return false;
 	}
@@ -676,7 +797,7 @@ bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB, const float bias
 	//
 	// Perform EPA expansion of the simplex to find the closest face on the CSO
 	//
-	EPA_Expand( bodyA, bodyB, bias, simplexPoints, ptOnA, ptOnB );
+	EPA_Expand( bodyA, bodyB, bias, simplexPoints, ptOnA, ptOnB, featureA, featureB );
 	return true;
 }
 
@@ -921,12 +1042,64 @@ void FindDanglingEdges( std::vector< edge_t > & danglingEdges, const std::vector
 	}
 }
 
+/*
+================================
+GJK_PackFeature
+
+Packs a set of up to three support vertex ids into a single key.  The key
+doesn't depend on the order of the ids, and a key of zero means the feature
+couldn't be identified.
+================================
+*/
+unsigned int GJK_PackFeature( const int * ids, const int num ) {
+	int sorted[ 3 ];
+	int numUnique = 0;
+	for ( int i = 0; i < num && i < 3; i++ ) {
+		const int id = ids[ i ];
+		if ( id < 0 || id >= 1024 ) {
+			return 0;
+		}
+
+		// Insertion sort, skipping duplicates
+		int j = numUnique;
+		bool isDuplicate = false;
+		for ( int k = 0; k < numUnique; k++ ) {
+			if ( sorted[ k ] == id ) {
+				isDuplicate = true;
+				break;
+			}
+		}
+		if ( isDuplicate ) {
+			continue;
+		}
+		while ( j > 0 && sorted[ j - 1 ] > id ) {
+			sorted[ j ] = sorted[ j - 1 ];
+			j--;
+		}
+		sorted[ j ] = id;
+		numUnique++;
+	}
+
+	if ( 0 == numUnique ) {
+		return 0;
+	}
+
+	// The top two bits hold the count (vertex, edge, face), so a valid key is never zero
+	unsigned int key = (unsigned int)numUnique << 30;
+	for ( int i = 0; i < numUnique; i++ ) {
+		key |= (unsigned int)sorted[ i ] << ( i * 10 );
+	}
+	return key;
+}
+
 /*
 ================================
 EPA_Expand
 ================================
 */
-float EPA_Expand( const Body * bodyA, const Body * bodyB, const float bias, const point_t simplexPoints[ 4 ], Vec3 & ptOnA, Vec3 & ptOnB ) {
+float EPA_Expand( const Body * bodyA, const Body * bodyB, const float bias, const point_t simplexPoints[ 4 ], Vec3 & ptOnA, Vec3 & ptOnB, unsigned int * featureA, unsigned int * featureB ) {
+	PROFILE_SCOPE( "EPA_Expand" );
+
 	std::vector< point_t > points;
 	std::vector< tri_t > triangles;
 	std::vector< edge_t > danglingEdges;
@@ -961,7 +1134,10 @@ float EPA_Expand( const Body * bodyA, const Body * bodyB, const float bias, cons
 	//
 	//	Expand the simplex to find the closest face of the CSO to the origin
 	//
+	int numIters = 0;
 	while ( 1 ) {
+		numIters++;
+
 		const int idx = ClosestTriangle( triangles, points );
 		Vec3 normal = NormalDirection( triangles[ idx ], points );
 
@@ -1015,6 +1191,9 @@ float EPA_Expand( const Body * bodyA, const Body * bodyB, const float bias, cons
 		}
 	}
 
+	g_numEPACalls.fetch_add( 1, std::memory_order_relaxed );
+	g_numEPAIterations.fetch_add( numIters, std::memory_order_relaxed );
+
 	// Get the projection of the origin on the closest triangle
 	const int idx = ClosestTriangle( triangles, points );
 	const tri_t & tri = triangles[ idx ];
@@ -1035,6 +1214,24 @@ float EPA_Expand( const Body * bodyA, const Body * bodyB, const float bias, cons
 	Vec3 ptC_b = points[ tri.c ].ptB;
 	ptOnB = ptA_b * lambdas[ 0 ] + ptB_b * lambdas[ 1 ] + ptC_b * lambdas[ 2 ];
 
+	// The support features that actually carry weight in the contact point identify
+	// which vertex/edge/face of each shape is touching
+	if ( NULL != featureA && NULL != featureB ) {
+		const int triIdx[ 3 ] = { tri.a, tri.b, tri.c };
+		int idsA[ 3 ];
+		int idsB[ 3 ];
+		int num = 0;
+		for ( int i = 0; i < 3; i++ ) {
+			if ( lambdas[ i ] > 0.01f ) {
+				idsA[ num ] = points[ triIdx[ i ] ].idA;
+				idsB[ num ] = points[ triIdx[ i ] ].idB;
+				num++;
+			}
+		}
+		*featureA = GJK_PackFeature( idsA, num );
+		*featureB = GJK_PackFeature( idsB, num );
+	}
+
 	// Return the penetration distance
 	Vec3 delta = ptOnB - ptOnA;
 	return delta.GetMagnitude();
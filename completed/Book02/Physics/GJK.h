@@ -8,10 +8,21 @@
 #include "../Math/Bounds.h"
 #include "Body.h"
 #include "Shapes.h"
+#include <atomic>
+
+// Intersection tests and the simplex / polytope refinements they took, counted since startup.
+// Atomic since the narrowphase runs its pairs in parallel.
+extern std::atomic< int > g_numGJKCalls;
+extern std::atomic< int > g_numGJKIterations;
+extern std::atomic< int > g_numEPACalls;
+extern std::atomic< int > g_numEPAIterations;
 
 bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB );
-bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB, const float bias, Vec3 & ptOnA, Vec3 & ptOnB );
+bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB, const float bias, Vec3 & ptOnA, Vec3 & ptOnB, unsigned int * featureA = NULL, unsigned int * featureB = NULL );
 void GJK_ClosestPoints( const Body * bodyA, const Body * bodyB, Vec3 & ptOnA, Vec3 & ptOnB );
+bool GJK_ShapeCast( const Body * bodyA, const Body * bodyB, const Vec3 & translation, const float tolerance, float & toi, Vec3 & normal, int * numIterations = NULL );
 
 struct point_t;
-float EPA_Expand( const Body * bodyA, const Body * bodyB, const float bias, const point_t simplexPoints[ 4 ], Vec3 & ptOnA, Vec3 & ptOnB );
\ No newline at end of file
+float EPA_Expand( const Body * bodyA, const Body * bodyB, const float bias, const point_t simplexPoints[ 4 ], Vec3 & ptOnA, Vec3 & ptOnB, unsigned int * featureA = NULL, unsigned int * featureB = NULL );
+
+unsigned int GJK_PackFeature( const int * ids, const int num );
\ No newline at end of file
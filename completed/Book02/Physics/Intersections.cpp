@@ -3,7 +3,12 @@
 //
 #include "Intersections.h"
 #include "GJK.h"
+#include "../Profiler/Profiler.h"
 
+std::atomic< int > g_numNarrowphasePairs( 0 );
+std::atomic< int > g_numContinuousPairs( 0 );
+std::atomic< int > g_toiIterationHistogram[ TOI_HISTOGRAM_SIZE ];
+std::atomic< int > g_numTOIIterations( 0 );
 
 /*
 ====================================================
@@ -33,9 +38,13 @@ Intersect
 ====================================================
 */
 bool Intersect( Body * bodyA, Body * bodyB, contact_t & contact ) {
+	PROFILE_SCOPE( "Intersect" );
+
 	contact.bodyA = bodyA;
 	contact.bodyB = bodyB;
 	contact.timeOfImpact = 0.0f;
+	contact.featureA = 0;
+	contact.featureB = 0;
 
 	if ( bodyA->m_shape->GetType() == Shape::SHAPE_SPHERE && bodyB->m_shape->GetType() == Shape::SHAPE_SPHERE ) {
 		const ShapeSphere * sphereA = (const ShapeSphere *)bodyA->m_shape;
@@ -48,6 +57,11 @@ bool Intersect( Body * bodyA, Body * bodyB, contact_t & contact ) {
 			contact.normal = posA - posB;
 			contact.normal.Normalize();
 
+			// A sphere only has the one feature
+			const int sphereFeature = 0;
+			contact.featureA = GJK_PackFeature( &sphereFeature, 1 );
+			contact.featureB = contact.featureA;
+
 			contact.ptOnA_LocalSpace = bodyA->WorldSpaceToBodySpace( contact.ptOnA_WorldSpace );
 			contact.ptOnB_LocalSpace = bodyB->WorldSpaceToBodySpace( contact.ptOnB_WorldSpace );
 
@@ -60,7 +74,7 @@ bool Intersect( Body * bodyA, Body * bodyB, contact_t & contact ) {
 		Vec3 ptOnA;
 		Vec3 ptOnB;
 		const float bias = 0.001f;
-		if ( GJK_DoesIntersect( bodyA, bodyB, bias, ptOnA, ptOnB ) ) {
+		if ( GJK_DoesIntersect( bodyA, bodyB, bias, ptOnA, ptOnB, &contact.featureA, &contact.featureB ) ) {
 			// There was an intersection, so get the contact data
 			Vec3 normal = ptOnB - ptOnA;
 			normal.Normalize();
@@ -99,64 +113,206 @@ bool Intersect( Body * bodyA, Body * bodyB, contact_t & contact ) {
 
 /*
 ====================================================
-ConservativeAdvance
+GetSweptBody
+
+Copy of the body moved t seconds along its current velocities, the same motion Body::Update makes
 ====================================================
 */
-bool ConservativeAdvance( Body * bodyA, Body * bodyB, float dt, contact_t & contact ) {
-	contact.bodyA = bodyA;
-	contact.bodyB = bodyB;
+static void GetSweptBody( const Body * body, const float t, Body & swept ) {
+	swept = *body;
+
+	const Vec3 centerOfMass = body->GetCenterOfMassWorldSpace() + body->m_linearVelocity * t;
+	const Vec3 dAngle = body->m_angularVelocity * t;
+	const Quat dq = Quat( dAngle, dAngle.GetMagnitude() );
+	swept.m_orientation = dq * body->m_orientation;
+	swept.m_orientation.Normalize();
+	swept.m_position = centerOfMass - swept.m_orientation.RotatePoint( body->m_shape->GetCenterOfMass() );
+}
 
-	float toi = 0.0f;
+/*
+====================================================
+EvaluateSeparation
 
-	int numIters = 0;
+Separation along the axis of two body space points at time t
+====================================================
+*/
+static float EvaluateSeparation( const Body * bodyA, const Body * bodyB, const Vec3 & localA, const Vec3 & localB, const Vec3 & axis, const float t ) {
+	Body sweptA;
+	Body sweptB;
+	GetSweptBody( bodyA, t, sweptA );
+	GetSweptBody( bodyB, t, sweptB );
+
+	const Vec3 ptA = sweptA.m_position + sweptA.m_orientation.RotatePoint( localA );
+	const Vec3 ptB = sweptB.m_position + sweptB.m_orientation.RotatePoint( localB );
+	return axis.Dot( ptB - ptA );
+}
+
+/*
+====================================================
+BilateralAdvance
+
+Time of impact for rotating bodies.  The closest points at t1 give a separating axis,
+the deepest points along that axis at t2 bound how far the bodies can go before the axis
+stops separating them, and a root finder bracketed between t1 and t2 finds where those
+points reach the target separation.  That time is safe to advance to, and the next
+distance query starts from there.  Only a distance query that finds the bodies within
+the tolerance of the target reports a hit, running out of iterations or stalling on an
+axis reports none rather than a time the bodies never reach.
+====================================================
+*/
+static bool BilateralAdvance( const Body * bodyA, const Body * bodyB, const float dt, const float tolerance, float & toi, int & numIters ) {
+	const int maxIters = 20;
+	const int maxPushBackIters = 8;
+	const int maxRootIters = 50;
 
-	// Advance the positions of the bodies until they touch or there's not time left
-	while ( dt > 0.0f ) {
-		// Check for intersection
-		bool didIntersect = Intersect( bodyA, bodyB, contact );
-		if ( didIntersect ) {
-			contact.timeOfImpact = toi;
-			bodyA->Update( -toi );
-			bodyB->Update( -toi );
+	// Stop just short of touching, inside the bias Intersect tests with
+	const float target = tolerance * 2.0f;
+
+	float t1 = 0.0f;
+	numIters = 0;
+	while ( true ) {
+		numIters++;
+
+		Body sweptA;
+		Body sweptB;
+		GetSweptBody( bodyA, t1, sweptA );
+		GetSweptBody( bodyB, t1, sweptB );
+
+		Vec3 ptOnA;
+		Vec3 ptOnB;
+		GJK_ClosestPoints( &sweptA, &sweptB, ptOnA, ptOnB );
+		Vec3 axis = ptOnB - ptOnA;
+		const float distance = axis.GetMagnitude();
+		if ( distance < target + tolerance ) {
+			toi = t1;
 			return true;
 		}
 
-		++numIters;
-		if ( numIters > 10 ) {
-			break;
+		// Gave up short of touching, t1 is only where the search stopped
+		if ( numIters >= maxIters || t1 >= dt ) {
+			return false;
+		}
+		axis /= distance;
+
+		bool didAdvance = false;
+		float t2 = dt;
+		for ( int pushBackIter = 0; pushBackIter < maxPushBackIters; pushBackIter++ ) {
+			// The deepest points along the axis at t2
+			GetSweptBody( bodyA, t2, sweptA );
+			GetSweptBody( bodyB, t2, sweptB );
+			const Vec3 deepestA = sweptA.m_shape->Support( axis, sweptA.m_position, sweptA.m_orientation, 0.0f );
+			const Vec3 deepestB = sweptB.m_shape->Support( axis * -1.0f, sweptB.m_position, sweptB.m_orientation, 0.0f );
+			float s2 = axis.Dot( deepestB - deepestA );
+
+			// Still separated at the end of the step
+			if ( s2 > target + tolerance ) {
+				return false;
+			}
+
+			// Close enough at t2, start the next distance query there
+			if ( s2 > target - tolerance ) {
+				t1 = t2;
+				didAdvance = true;
+				break;
+			}
+
+			const Vec3 localA = sweptA.m_orientation.Inverse().RotatePoint( deepestA - sweptA.m_position );
+			const Vec3 localB = sweptB.m_orientation.Inverse().RotatePoint( deepestB - sweptB.m_position );
+			float s1 = EvaluateSeparation( bodyA, bodyB, localA, localB, axis, t1 );
+
+			// These points were already past the target at t1, this axis can't advance any further
+			if ( s1 < target + tolerance ) {
+				break;
+			}
+
+			// Alternate the secant and bisection steps, both keep the root bracketed
+			float a1 = t1;
+			float a2 = t2;
+			for ( int rootIter = 0; rootIter < maxRootIters; rootIter++ ) {
+				const float t = ( rootIter & 1 ) ? a1 + ( target - s1 ) * ( a2 - a1 ) / ( s2 - s1 ) : 0.5f * ( a1 + a2 );
+				const float s = EvaluateSeparation( bodyA, bodyB, localA, localB, axis, t );
+				if ( fabsf( s - target ) < tolerance ) {
+					t2 = t;
+					break;
+				}
+				if ( s > target ) {
+					a1 = t;
+					s1 = s;
+				} else {
+					a2 = t;
+					s2 = s;
+				}
+			}
 		}
 
-		// Get the vector from the closest point on A to the closest point on B
-		Vec3 ab = contact.ptOnB_WorldSpace - contact.ptOnA_WorldSpace;
-		ab.Normalize();
+		// The distance at t1 was checked above, so the bodies aren't touching there
+		if ( !didAdvance ) {
+			return false;
+		}
+	}
+}
 
-		// project the relative velocity onto the ray of shortest distance
-		Vec3 relativeVelocity = bodyA->m_linearVelocity - bodyB->m_linearVelocity;
-		float orthoSpeed = relativeVelocity.Dot( ab );
+/*
+====================================================
+TimeOfImpact
 
-		// Add to the orthoSpeed the maximum angular speeds of the relative shapes
-		float angularSpeedA = bodyA->m_shape->FastestLinearSpeed( bodyA->m_angularVelocity, ab );
-		float angularSpeedB = bodyB->m_shape->FastestLinearSpeed( bodyB->m_angularVelocity, ab * -1.0f );
-		orthoSpeed += angularSpeedA + angularSpeedB;
-		if ( orthoSpeed <= 0.0f ) {
-			break;
-		}
+Earliest time in [0,dt] the two bodies touch, to within the tolerance.  Bodies that
+aren't rotating only need a single shape cast.
+====================================================
+*/
+bool TimeOfImpact( const Body * bodyA, const Body * bodyB, const float dt, const float tolerance, float & toi ) {
+	int numIters = 0;
+	bool didHit = false;
+	if ( bodyA->m_angularVelocity.GetLengthSqr() == 0.0f && bodyB->m_angularVelocity.GetLengthSqr() == 0.0f ) {
+		const Vec3 translation = ( bodyA->m_linearVelocity - bodyB->m_linearVelocity ) * dt;
+		Vec3 normal;
+		float fraction = 0.0f;
+		didHit = GJK_ShapeCast( bodyA, bodyB, translation, tolerance, fraction, normal, &numIters );
+		toi = fraction * dt;
+	} else {
+		didHit = BilateralAdvance( bodyA, bodyB, dt, tolerance, toi, numIters );
+	}
 
-		float timeToGo = contact.separationDistance / orthoSpeed;
-		if ( timeToGo > dt ) {
-			break;
-		}
+	const int bucket = ( numIters < TOI_HISTOGRAM_SIZE - 1 ) ? numIters : TOI_HISTOGRAM_SIZE - 1;
+	g_toiIterationHistogram[ bucket ]++;
+	g_numTOIIterations.fetch_add( numIters, std::memory_order_relaxed );
+	return didHit;
+}
+
+/*
+====================================================
+ConservativeAdvance
+====================================================
+*/
+bool ConservativeAdvance( Body * bodyA, Body * bodyB, const float dt, const float tolerance, contact_t & contact ) {
+	contact.bodyA = bodyA;
+	contact.bodyB = bodyB;
 
-		dt -= timeToGo;
-		toi += timeToGo;
-		bodyA->Update( timeToGo );
-		bodyB->Update( timeToGo );
+	float toi = 0.0f;
+	if ( !TimeOfImpact( bodyA, bodyB, dt, tolerance, toi ) ) {
+		return false;
 	}
 
-	// unwind the clock
-	bodyA->Update( -toi );
-	bodyB->Update( -toi );
-	return false;
+	// Get the contact data from copies moved to the time of impact, other pairs may be reading these bodies
+	Body sweptA = *bodyA;
+	Body sweptB = *bodyB;
+	sweptA.Update( toi );
+	sweptB.Update( toi );
+
+	if ( !Intersect( &sweptA, &sweptB, contact ) ) {
+		// Stopped a hair short of the bias, the closest points make a fine contact.
+		// The time of impact stops within three tolerances of touching, any further
+		// apart and the query didn't converge.
+		if ( contact.separationDistance > 3.0f * tolerance ) {
+			return false;
+		}
+		contact.normal = contact.ptOnA_WorldSpace - contact.ptOnB_WorldSpace;
+		contact.normal.Normalize();
+	}
+	contact.bodyA = bodyA;
+	contact.bodyB = bodyB;
+	contact.timeOfImpact = toi;
+	return true;
 }
 
 /*
@@ -238,14 +394,49 @@ bool SphereSphereDynamic( const ShapeSphere * shapeA, const ShapeSphere * shapeB
 	return true;
 }
 
+/*
+====================================================
+NeedsContinuousCollision
+
+Conservative advancement costs up to ten GJK calls.  Only pairs that can move a good
+part of the thinner shape's width within the step need it, the rest get one discrete
+test and any overlap they pick up is left to the contact manifolds next step.
+====================================================
+*/
+bool NeedsContinuousCollision( const Body * bodyA, const Body * bodyB, const float dt ) {
+	if ( !bodyA->m_enableCCD || !bodyB->m_enableCCD ) {
+		return false;
+	}
+
+	// Upper bound on how far any point of one body moves relative to the other
+	const Vec3 relativeVelocity = bodyA->m_linearVelocity - bodyB->m_linearVelocity;
+	float motion = relativeVelocity.GetMagnitude();
+	motion += bodyA->m_angularVelocity.GetMagnitude() * bodyA->m_shape->GetMaximumRadius();
+	motion += bodyB->m_angularVelocity.GetMagnitude() * bodyB->m_shape->GetMaximumRadius();
+	motion *= dt;
+
+	const float extentA = bodyA->m_shape->GetMinimumExtent();
+	const float extentB = bodyB->m_shape->GetMinimumExtent();
+	const float minExtent = ( extentA < extentB ) ? extentA : extentB;
+
+	const float ccdMotionFraction = 0.25f;
+	return ( motion > minExtent * ccdMotionFraction );
+}
+
 /*
 ====================================================
 Intersect
 ====================================================
 */
-bool Intersect( Body * bodyA, Body * bodyB, const float dt, contact_t & contact ) {
+bool Intersect( Body * bodyA, Body * bodyB, const float dt, const float toiTolerance, contact_t & contact ) {
+	PROFILE_SCOPE( "Intersect swept" );
+
+	g_numNarrowphasePairs++;
+
 	contact.bodyA = bodyA;
 	contact.bodyB = bodyB;
+	contact.featureA = 0;
+	contact.featureB = 0;
 
 	if ( bodyA->m_shape->GetType() == Shape::SHAPE_SPHERE && bodyB->m_shape->GetType() == Shape::SHAPE_SPHERE ) {
 		const ShapeSphere * sphereA = (const ShapeSphere *)bodyA->m_shape;
@@ -258,31 +449,33 @@ bool Intersect( Body * bodyA, Body * bodyB, const float dt, contact_t & contact
 		Vec3 velB = bodyB->m_linearVelocity;
 
 		if ( SphereSphereDynamic( sphereA, sphereB, posA, posB, velA, velB, dt, contact.ptOnA_WorldSpace, contact.ptOnB_WorldSpace, contact.timeOfImpact ) ) {
-			// Step bodies forward to get local space collision points
-			bodyA->Update( contact.timeOfImpact );
-			bodyB->Update( contact.timeOfImpact );
+			// Step copies of the bodies forward to get local space collision points
+			Body sweptA = *bodyA;
+			Body sweptB = *bodyB;
+			sweptA.Update( contact.timeOfImpact );
+			sweptB.Update( contact.timeOfImpact );
 
 			// Convert world space contacts to local space
-			contact.ptOnA_LocalSpace = bodyA->WorldSpaceToBodySpace( contact.ptOnA_WorldSpace );
-			contact.ptOnB_LocalSpace = bodyB->WorldSpaceToBodySpace( contact.ptOnB_WorldSpace );
+			contact.ptOnA_LocalSpace = sweptA.WorldSpaceToBodySpace( contact.ptOnA_WorldSpace );
+			contact.ptOnB_LocalSpace = sweptB.WorldSpaceToBodySpace( contact.ptOnB_WorldSpace );
 
-			contact.normal = bodyA->m_position - bodyB->m_position;
+			contact.normal = sweptA.m_position - sweptB.m_position;
 			contact.normal.Normalize();
 
-			// Unwind time step
-			bodyA->Update( -contact.timeOfImpact );
-			bodyB->Update( -contact.timeOfImpact );
-
 			// Calculate the separation distance
 			Vec3 ab = bodyB->m_position - bodyA->m_position;
 			float r = ab.GetMagnitude() - ( sphereA->m_radius + sphereB->m_radius );
 			contact.separationDistance = r;
 			return true;
 		}
-	} else {
+	} else if ( NeedsContinuousCollision( bodyA, bodyB, dt ) ) {
 		// Use GJK to perform conservative advancement
-		bool result = ConservativeAdvance( bodyA, bodyB, dt, contact );
+		g_numContinuousPairs++;
+		bool result = ConservativeAdvance( bodyA, bodyB, dt, toiTolerance, contact );
 		return result;
+	} else {
+		// Too slow to tunnel, a single GJK / EPA test at the start of the step will do
+		return Intersect( bodyA, bodyB, contact );
 	}
 	return false;
 }
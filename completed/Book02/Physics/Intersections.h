@@ -3,6 +3,20 @@
 //
 #pragma once
 #include "Contact.h"
+#include <atomic>
+
+// Narrowphase counters, every pair tested over a step and the ones that needed conservative advancement.
+// Atomic since the narrowphase runs its pairs in parallel.
+extern std::atomic< int > g_numNarrowphasePairs;
+extern std::atomic< int > g_numContinuousPairs;
+
+// How many iterations each time of impact query took, the last bucket collects everything longer
+const int TOI_HISTOGRAM_SIZE = 16;
+extern std::atomic< int > g_toiIterationHistogram[ TOI_HISTOGRAM_SIZE ];
+extern std::atomic< int > g_numTOIIterations;	// every iteration, including the ones past the last bucket
+
+bool NeedsContinuousCollision( const Body * bodyA, const Body * bodyB, const float dt );
 
 bool Intersect( Body * bodyA, Body * bodyB, contact_t & contact );
-bool Intersect( Body * bodyA, Body * bodyB, const float dt, contact_t & contact );
\ No newline at end of file
+bool TimeOfImpact( const Body * bodyA, const Body * bodyB, const float dt, const float tolerance, float & toi );
+bool Intersect( Body * bodyA, Body * bodyB, const float dt, const float toiTolerance, contact_t & contact );
\ No newline at end of file
@@ -2,7 +2,9 @@
 //  Manifold.cpp
 //
 #include "Manifold.h"
-
+#include "../Profiler/Profiler.h"
+#include <string.h>
+#include <algorithm>
 
 /*
 ================================================================================================
@@ -19,27 +21,407 @@ ManifoldCollector::AddContact
 */
 void ManifoldCollector::AddContact( const contact_t & contact ) {
 	// Try to find the previously existing manifold for contacts between these two bodies
-	int foundIdx = -1;
-	for ( int i = 0; i < m_manifolds.size(); i++ ) {
-		const Manifold & manifold = m_manifolds[ i ];
-		bool hasA = ( manifold.m_bodyA == contact.bodyA || manifold.m_bodyB == contact.bodyA );
-		bool hasB = ( manifold.m_bodyA == contact.bodyB || manifold.m_bodyB == contact.bodyB );
-		if ( hasA && hasB ) {
-			foundIdx = i;
-			break;
+	int slot = FindManifold( contact.bodyA, contact.bodyB );
+
+	// Add contact to manifolds
+	if ( slot < 0 ) {
+		slot = AllocateSlot();
+		m_pool[ slot ].Reset( contact.bodyA, contact.bodyB );
+		InsertLookup( contact.bodyA, contact.bodyB, slot );
+	}
+
+	const Manifold::addContactResult_t result = m_pool[ slot ].AddContact( contact );
+	if ( Manifold::ADD_CONTACT_REJECTED != result ) {
+		m_numContactsAdded++;
+		if ( Manifold::ADD_CONTACT_WARM == result ) {
+			m_numWarmStarts++;
 		}
 	}
+}
 
-	// Add contact to manifolds
-	if ( foundIdx >= 0 ) {
-		m_manifolds[ foundIdx ].AddContact( contact );
+/*
+================================
+ManifoldCollector::AllocateSlot
+================================
+*/
+int ManifoldCollector::AllocateSlot() {
+	int slot;
+	if ( !m_freeSlots.empty() ) {
+		slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
 	} else {
-		Manifold manifold;
-		manifold.m_bodyA = contact.bodyA;
-		manifold.m_bodyB = contact.bodyB;
+		slot = (int)m_pool.size();
+		m_pool.emplace_back();
+		m_generations.push_back( 0 );
+		m_activeIndex.push_back( -1 );
+	}
+
+	m_activeIndex[ slot ] = (int)m_active.size();
+	m_active.push_back( slot );
+	return slot;
+}
+
+/*
+================================
+ManifoldCollector::FreeSlot
+================================
+*/
+void ManifoldCollector::FreeSlot( const int slot ) {
+	// Swap the last active slot into this one's place in the dense list
+	const int idx = m_activeIndex[ slot ];
+	const int lastSlot = m_active.back();
+	m_active[ idx ] = lastSlot;
+	m_activeIndex[ lastSlot ] = idx;
+	m_active.pop_back();
+
+	m_activeIndex[ slot ] = -1;
+	m_generations[ slot ]++;
+	m_freeSlots.push_back( slot );
+}
+
+/*
+================================
+ManifoldCollector::GetHandle
+================================
+*/
+manifoldHandle_t ManifoldCollector::GetHandle( const int idx ) const {
+	manifoldHandle_t handle;
+	handle.slot = m_active[ idx ];
+	handle.generation = m_generations[ handle.slot ];
+	return handle;
+}
+
+/*
+================================
+ManifoldCollector::Resolve
+================================
+*/
+Manifold * ManifoldCollector::Resolve( const manifoldHandle_t & handle ) {
+	if ( handle.slot < 0 || handle.slot >= (int)m_pool.size() ) {
+		return NULL;
+	}
+	if ( m_generations[ handle.slot ] != handle.generation || m_activeIndex[ handle.slot ] < 0 ) {
+		return NULL;
+	}
+	return &m_pool[ handle.slot ];
+}
+
+/*
+================================
+ManifoldCollector::Clear
+================================
+*/
+void ManifoldCollector::Clear() {
+	// Keep the pooled manifolds around for reuse, but invalidate every handle
+	while ( !m_active.empty() ) {
+		FreeSlot( m_active.back() );
+	}
+	m_lookup.clear();
+	m_numLookupEntries = 0;
+}
+
+/*
+================================
+ManifoldCollector::ResetContactStats
+
+Contacts live as long as their manifold, and pooled manifolds are reused,
+so their counters would otherwise run on from whatever used the slot before
+================================
+*/
+void ManifoldCollector::ResetContactStats() {
+	for ( int i = 0; i < m_active.size(); i++ ) {
+		Manifold & manifold = m_pool[ m_active[ i ] ];
+		for ( int c = 0; c < manifold.m_numContacts; c++ ) {
+			LCP_ResetStats( manifold.m_constraints[ c ].m_solverStats );
+		}
+	}
+}
+
+/*
+================================
+ManifoldCollector::GetStateSize
+================================
+*/
+int ManifoldCollector::GetStateSize() const {
+	const int numSlots = (int)m_pool.size();
+	const int numFree = (int)m_freeSlots.size();
+	const int numActive = (int)m_active.size();
+	return 3 * sizeof( int ) + numSlots * sizeof( unsigned int ) + ( numFree + numActive ) * sizeof( int ) + numActive * sizeof( manifoldState_t );
+}
+
+/*
+================================
+ManifoldCollector::SaveState
+
+Stores the pool layout as well as the manifolds.  The solver visits the
+manifolds in m_active order and new ones take slots from the end of the free
+list, both have to come back exactly for a restored scene to replay the same.
+================================
+*/
+void ManifoldCollector::SaveState( void * state, const Body * bodies ) const {
+	unsigned char * dst = (unsigned char *)state;
 
-		manifold.AddContact( contact );
-		m_manifolds.push_back( manifold );
+	const int header[ 3 ] = { (int)m_pool.size(), (int)m_freeSlots.size(), (int)m_active.size() };
+	memcpy( dst, header, sizeof( header ) );
+	dst += sizeof( header );
+
+	memcpy( dst, m_generations.data(), header[ 0 ] * sizeof( unsigned int ) );
+	dst += header[ 0 ] * sizeof( unsigned int );
+	memcpy( dst, m_freeSlots.data(), header[ 1 ] * sizeof( int ) );
+	dst += header[ 1 ] * sizeof( int );
+	memcpy( dst, m_active.data(), header[ 2 ] * sizeof( int ) );
+	dst += header[ 2 ] * sizeof( int );
+
+	for ( int i = 0; i < m_active.size(); i++ ) {
+		const Manifold & manifold = m_pool[ m_active[ i ] ];
+
+		manifoldState_t manifoldState = {};
+		manifoldState.bodyA = (int)( manifold.m_bodyA - bodies );
+		manifoldState.bodyB = (int)( manifold.m_bodyB - bodies );
+		manifoldState.numContacts = manifold.m_numContacts;
+		manifoldState.numRetired = manifold.m_numRetired;
+		for ( int j = 0; j < manifold.m_numContacts; j++ ) {
+			const ConstraintPenetration & constraint = manifold.m_constraints[ j ];
+			manifoldState.contacts[ j ] = manifold.m_contacts[ j ];
+			manifoldState.contacts[ j ].bodyA = NULL;
+			manifoldState.contacts[ j ].bodyB = NULL;
+			manifoldState.contactBodies[ j ][ 0 ] = (int)( manifold.m_contacts[ j ].bodyA - bodies );
+			manifoldState.contactBodies[ j ][ 1 ] = (int)( manifold.m_contacts[ j ].bodyB - bodies );
+			manifoldState.normals[ j ] = constraint.m_normal;
+			for ( int k = 0; k < 3; k++ ) {
+				manifoldState.cachedLambda[ j ][ k ] = constraint.m_cachedLambda[ k ];
+			}
+		}
+		for ( int j = 0; j < manifold.m_numRetired; j++ ) {
+			manifoldState.retired[ j ] = manifold.m_retired[ j ];
+		}
+
+		memcpy( dst, &manifoldState, sizeof( manifoldState ) );
+		dst += sizeof( manifoldState );
+	}
+}
+
+/*
+================================
+ManifoldCollector::RestoreState
+================================
+*/
+void ManifoldCollector::RestoreState( const void * state, Body * bodies ) {
+	const unsigned char * src = (const unsigned char *)state;
+
+	int header[ 3 ];
+	memcpy( header, src, sizeof( header ) );
+	src += sizeof( header );
+	const int numSlots = header[ 0 ];
+	const int numFree = header[ 1 ];
+	const int numActive = header[ 2 ];
+
+	// The pool never shrinks, so this only happens when restoring into a different collector
+	while ( (int)m_pool.size() < numSlots ) {
+		m_pool.emplace_back();
+		m_generations.push_back( 0 );
+		m_activeIndex.push_back( -1 );
+	}
+
+	memcpy( m_generations.data(), src, numSlots * sizeof( unsigned int ) );
+	src += numSlots * sizeof( unsigned int );
+
+	// Slots made since the snapshot go to the bottom of the free list, lowest last,
+	// so they're handed out in the same order they were first made
+	m_freeSlots.clear();
+	for ( int slot = (int)m_pool.size() - 1; slot >= numSlots; slot-- ) {
+		m_generations[ slot ]++;
+		m_freeSlots.push_back( slot );
+	}
+	const int numNewSlots = (int)m_freeSlots.size();
+	m_freeSlots.resize( numNewSlots + numFree );
+	memcpy( m_freeSlots.data() + numNewSlots, src, numFree * sizeof( int ) );
+	src += numFree * sizeof( int );
+
+	m_active.resize( numActive );
+	memcpy( m_active.data(), src, numActive * sizeof( int ) );
+	src += numActive * sizeof( int );
+
+	for ( int slot = 0; slot < m_activeIndex.size(); slot++ ) {
+		m_activeIndex[ slot ] = -1;
+	}
+
+	for ( int i = 0; i < numActive; i++ ) {
+		m_activeIndex[ m_active[ i ] ] = i;
+
+		// The buffer isn't aligned for a manifoldState_t, so copy the bytes out rather than point into it
+		manifoldState_t manifoldState = {};
+		memcpy( (void *)&manifoldState, src, sizeof( manifoldState ) );
+		src += sizeof( manifoldState );
+
+		Manifold & manifold = m_pool[ m_active[ i ] ];
+		manifold.Reset( bodies + manifoldState.bodyA, bodies + manifoldState.bodyB );
+		manifold.m_numContacts = manifoldState.numContacts;
+		manifold.m_numRetired = manifoldState.numRetired;
+		for ( int j = 0; j < manifoldState.numContacts; j++ ) {
+			contact_t & contact = manifold.m_contacts[ j ];
+			contact = manifoldState.contacts[ j ];
+			contact.bodyA = bodies + manifoldState.contactBodies[ j ][ 0 ];
+			contact.bodyB = bodies + manifoldState.contactBodies[ j ][ 1 ];
+
+			ConstraintPenetration & constraint = manifold.m_constraints[ j ];
+			constraint.m_bodyA = contact.bodyA;
+			constraint.m_bodyB = contact.bodyB;
+			constraint.m_anchorA = contact.ptOnA_LocalSpace;
+			constraint.m_anchorB = contact.ptOnB_LocalSpace;
+			constraint.m_normal = manifoldState.normals[ j ];
+			for ( int k = 0; k < 3; k++ ) {
+				constraint.m_cachedLambda[ k ] = manifoldState.cachedLambda[ j ][ k ];
+			}
+		}
+		for ( int j = 0; j < manifoldState.numRetired; j++ ) {
+			manifold.m_retired[ j ] = manifoldState.retired[ j ];
+		}
+	}
+
+	RebuildLookup();
+}
+
+/*
+================================
+ManifoldCollector::HashPair
+================================
+*/
+unsigned int ManifoldCollector::HashPair( const Body * bodyA, const Body * bodyB ) {
+	// Mix the two addresses, the low bits are mostly alignment so fold the high bits down
+	unsigned long long key = (unsigned long long)(size_t)bodyA * 0x9E3779B97F4A7C15ULL;
+	key ^= (unsigned long long)(size_t)bodyB + 0x7F4A7C159E3779B9ULL + ( key << 6 ) + ( key >> 2 );
+	key ^= key >> 29;
+	key *= 0xBF58476D1CE4E5B9ULL;
+	key ^= key >> 32;
+	return (unsigned int)key;
+}
+
+/*
+================================
+ManifoldCollector::FindManifold
+================================
+*/
+int ManifoldCollector::FindManifold( const Body * bodyA, const Body * bodyB ) const {
+	if ( m_lookup.empty() ) {
+		return -1;
+	}
+
+	// The key is order independent
+	if ( bodyB < bodyA ) {
+		std::swap( bodyA, bodyB );
+	}
+
+	const unsigned int mask = (unsigned int)m_lookup.size() - 1;
+	unsigned int probe = HashPair( bodyA, bodyB ) & mask;
+	while ( NULL != m_lookup[ probe ].bodyA ) {
+		const lookupEntry_t & entry = m_lookup[ probe ];
+		if ( entry.bodyA == bodyA && entry.bodyB == bodyB ) {
+			return entry.slot;
+		}
+		probe = ( probe + 1 ) & mask;
+	}
+	return -1;
+}
+
+/*
+================================
+ManifoldCollector::InsertLookup
+
+The manifold must already be active in the pool.
+================================
+*/
+void ManifoldCollector::InsertLookup( const Body * bodyA, const Body * bodyB, const int slot ) {
+	// Keep the load factor at or below one half so the probe chains stay short
+	if ( ( m_numLookupEntries + 1 ) * 2 > (int)m_lookup.size() ) {
+		RebuildLookup();
+		return;
+	}
+
+	if ( bodyB < bodyA ) {
+		std::swap( bodyA, bodyB );
+	}
+
+	const unsigned int mask = (unsigned int)m_lookup.size() - 1;
+	unsigned int probe = HashPair( bodyA, bodyB ) & mask;
+	while ( NULL != m_lookup[ probe ].bodyA ) {
+		probe = ( probe + 1 ) & mask;
+	}
+
+	m_lookup[ probe ].bodyA = bodyA;
+	m_lookup[ probe ].bodyB = bodyB;
+	m_lookup[ probe ].slot = slot;
+	m_numLookupEntries++;
+}
+
+/*
+================================
+ManifoldCollector::RemoveLookup
+
+Backward shift deletion, so no tombstones are needed.
+================================
+*/
+void ManifoldCollector::RemoveLookup( const Body * bodyA, const Body * bodyB ) {
+	if ( m_lookup.empty() ) {
+		return;
+	}
+
+	if ( bodyB < bodyA ) {
+		std::swap( bodyA, bodyB );
+	}
+
+	const unsigned int mask = (unsigned int)m_lookup.size() - 1;
+	unsigned int hole = HashPair( bodyA, bodyB ) & mask;
+	while ( m_lookup[ hole ].bodyA != bodyA || m_lookup[ hole ].bodyB != bodyB ) {
+		if ( NULL == m_lookup[ hole ].bodyA ) {
+			return;
+		}
+		hole = ( hole + 1 ) & mask;
+	}
+
+	// Pull later entries of the probe chain back into the hole, as long as
+	// that doesn't move them in front of their home position
+	unsigned int probe = hole;
+	while ( true ) {
+		probe = ( probe + 1 ) & mask;
+		const lookupEntry_t & entry = m_lookup[ probe ];
+		if ( NULL == entry.bodyA ) {
+			break;
+		}
+
+		const unsigned int home = HashPair( entry.bodyA, entry.bodyB ) & mask;
+		const unsigned int distHome = ( probe - home ) & mask;
+		const unsigned int distHole = ( probe - hole ) & mask;
+		if ( distHome >= distHole ) {
+			m_lookup[ hole ] = entry;
+			hole = probe;
+		}
+	}
+
+	m_lookup[ hole ].bodyA = NULL;
+	m_lookup[ hole ].bodyB = NULL;
+	m_lookup[ hole ].slot = -1;
+	m_numLookupEntries--;
+}
+
+/*
+================================
+ManifoldCollector::RebuildLookup
+================================
+*/
+void ManifoldCollector::RebuildLookup() {
+	const int numManifolds = (int)m_active.size();
+	int size = m_lookup.empty() ? 64 : (int)m_lookup.size();
+	while ( numManifolds * 2 > size ) {
+		size *= 2;
+	}
+
+	lookupEntry_t empty = { NULL, NULL, -1 };
+	m_lookup.assign( size, empty );
+	m_numLookupEntries = 0;
+	for ( int i = 0; i < numManifolds; i++ ) {
+		const Manifold & manifold = m_pool[ m_active[ i ] ];
+		InsertLookup( manifold.m_bodyA, manifold.m_bodyB, m_active[ i ] );
 	}
 }
 
@@ -49,13 +431,15 @@ ManifoldCollector::RemoveExpired
 ================================
 */
 void ManifoldCollector::RemoveExpired() {
-	// Remove expired manifolds
-	for ( int i = (int)m_manifolds.size() - 1; i >= 0; i-- ) {
-		Manifold & manifold = m_manifolds[ i ];
+	// Remove expired manifolds.  Walk backwards since freeing swaps the last active manifold into place.
+	for ( int i = (int)m_active.size() - 1; i >= 0; i-- ) {
+		const int slot = m_active[ i ];
+		Manifold & manifold = m_pool[ slot ];
 		manifold.RemoveExpiredContacts();
 
 		if ( 0 == manifold.m_numContacts ) {
-			m_manifolds.erase( m_manifolds.begin() + i );
+			RemoveLookup( manifold.m_bodyA, manifold.m_bodyB );
+			FreeSlot( slot );
 		}
 	}
 }
@@ -66,8 +450,22 @@ ManifoldCollector::PreSolve
 ================================
 */
 void ManifoldCollector::PreSolve( const float dt_sec ) {
-	for ( int i = 0; i < m_manifolds.size(); i++ ) {
-		m_manifolds[ i ].PreSolve( dt_sec );
+	for ( int i = 0; i < m_active.size(); i++ ) {
+		Manifold & manifold = m_pool[ m_active[ i ] ];
+		manifold.SetSoftness( m_contactHertz, m_contactDampingRatio );
+		manifold.SetPositionSolve( m_usePositionSolve );
+		manifold.PreSolve( dt_sec );
+	}
+}
+
+/*
+================================
+ManifoldCollector::PreSolveSubstep
+================================
+*/
+void ManifoldCollector::PreSolveSubstep( const float dt_sec ) {
+	for ( int i = 0; i < m_active.size(); i++ ) {
+		m_pool[ m_active[ i ] ].PreSolveSubstep( dt_sec );
 	}
 }
 
@@ -77,8 +475,25 @@ ManifoldCollector::Solve
 ================================
 */
 void ManifoldCollector::Solve() {
-	for ( int i = 0; i < m_manifolds.size(); i++ ) {
-		m_manifolds[ i ].Solve();
+	PROFILE_SCOPE( "ManifoldCollector::Solve" );
+
+	// The batched solver needs the packed solver bodies
+	if ( CONTACT_SOLVER_SIMD == m_solverMode && NULL != m_solverBodies ) {
+		for ( int i = 0; i < m_batches.size(); i++ ) {
+			SolveBatch( m_batches[ i ] );
+		}
+		return;
+	}
+
+	if ( CONTACT_SOLVER_BLOCK == m_solverMode ) {
+		for ( int i = 0; i < m_active.size(); i++ ) {
+			m_pool[ m_active[ i ] ].SolveBlock( &m_blockStats );
+		}
+		return;
+	}
+
+	for ( int i = 0; i < m_active.size(); i++ ) {
+		m_pool[ m_active[ i ] ].Solve();
 	}
 }
 
@@ -88,8 +503,296 @@ Manifold::PostSolve
 ================================
 */
 void ManifoldCollector::PostSolve() {
-	for ( int i = 0; i < m_manifolds.size(); i++ ) {
-		m_manifolds[ i ].PostSolve();
+	for ( int i = 0; i < m_active.size(); i++ ) {
+		m_pool[ m_active[ i ] ].PostSolve();
+	}
+}
+
+/*
+================================
+ManifoldCollector::SolvePositions
+================================
+*/
+float ManifoldCollector::SolvePositions() {
+	float maxPenetration = 0.0f;
+	for ( int i = 0; i < m_active.size(); i++ ) {
+		maxPenetration = std::max( maxPenetration, m_pool[ m_active[ i ] ].SolvePositions() );
+	}
+	return maxPenetration;
+}
+
+/*
+================================
+ManifoldCollector::SetSolverBodies
+================================
+*/
+void ManifoldCollector::SetSolverBodies( SolverBodies * solverBodies ) {
+	for ( int i = 0; i < m_active.size(); i++ ) {
+		m_pool[ m_active[ i ] ].SetSolverBodies( solverBodies );
+	}
+
+	if ( CONTACT_SOLVER_SIMD == m_solverMode ) {
+		if ( NULL != solverBodies ) {
+			m_solverBodies = solverBodies;
+			BuildBatches();
+		} else if ( NULL != m_solverBodies ) {
+			// Hand the accumulated impulses back to the constraints for warm starting
+			StoreBatches();
+		}
+	}
+	m_solverBodies = solverBodies;
+}
+
+/*
+================================
+ManifoldCollector::BuildBatches
+
+Packs every contact into SIMD batches.  Each dynamic body keeps a bit mask
+of the batches ( in the current window of 64 ) that already use it, so a
+contact goes in the first batch that neither of its bodies is in yet.
+================================
+*/
+void ManifoldCollector::BuildBatches() {
+	m_batches.clear();
+
+	const int numBodies = m_solverBodies->Size();
+	m_bodyBatchMask.assign( numBodies, 0 );
+
+	int windowStart = 0;
+	unsigned long long fullMask = 0;
+
+	for ( int m = 0; m < m_active.size(); m++ ) {
+		Manifold & manifold = m_pool[ m_active[ m ] ];
+		for ( int c = 0; c < manifold.m_numContacts; c++ ) {
+			ConstraintPenetration & constraint = manifold.m_constraints[ c ];
+			const int idxA = constraint.m_bodyA->m_solverIndex;
+			const int idxB = constraint.m_bodyB->m_solverIndex;
+			const bool isDynamicA = ( 0.0f != m_solverBodies->m_invMass[ idxA ] );
+			const bool isDynamicB = ( 0.0f != m_solverBodies->m_invMass[ idxB ] );
+
+			// Find the first batch in the window that's neither full nor already touching these bodies
+			unsigned long long used = fullMask;
+			if ( isDynamicA ) {
+				used |= m_bodyBatchMask[ idxA ];
+			}
+			if ( isDynamicB ) {
+				used |= m_bodyBatchMask[ idxB ];
+			}
+
+			int slot = -1;
+			for ( int bit = 0; bit < 64; bit++ ) {
+				if ( 0 == ( used & ( 1ULL << bit ) ) ) {
+					slot = bit;
+					break;
+				}
+			}
+
+			// Every batch in this window is taken, start a fresh window
+			if ( -1 == slot ) {
+				windowStart = (int)m_batches.size();
+				fullMask = 0;
+				m_bodyBatchMask.assign( numBodies, 0 );
+				slot = 0;
+			}
+
+			const int batchIdx = windowStart + slot;
+			if ( batchIdx >= m_batches.size() ) {
+				contactBatch_t batch;
+				memset( &batch, 0, sizeof( batch ) );
+				m_batches.push_back( batch );
+			}
+
+			contactBatch_t & batch = m_batches[ batchIdx ];
+			const int lane = batch.numLanes;
+			batch.numLanes++;
+			if ( SIMD_WIDTH == batch.numLanes ) {
+				fullMask |= ( 1ULL << slot );
+			}
+			if ( isDynamicA ) {
+				m_bodyBatchMask[ idxA ] |= ( 1ULL << slot );
+			}
+			if ( isDynamicB ) {
+				m_bodyBatchMask[ idxB ] |= ( 1ULL << slot );
+			}
+
+			batch.bodyA[ lane ] = idxA;
+			batch.bodyB[ lane ] = idxB;
+			batch.constraint[ lane ] = &constraint;
+
+			const float invMassA = m_solverBodies->m_invMass[ idxA ];
+			const float invMassB = m_solverBodies->m_invMass[ idxB ];
+			const Mat3 & invInertiaA = m_solverBodies->m_invInertiaTensorWorldSpace[ idxA ];
+			const Mat3 & invInertiaB = m_solverBodies->m_invInertiaTensorWorldSpace[ idxB ];
+
+			for ( int row = 0; row < 3; row++ ) {
+				const VecN & J = constraint.m_Jacobian.rows[ row ];
+				const Vec3 linearA( J[ 0 ], J[ 1 ], J[ 2 ] );
+				const Vec3 angularA( J[ 3 ], J[ 4 ], J[ 5 ] );
+				const Vec3 linearB( J[ 6 ], J[ 7 ], J[ 8 ] );
+				const Vec3 angularB( J[ 9 ], J[ 10], J[ 11] );
+
+				const Vec3 dLinearA = linearA * invMassA;
+				const Vec3 dAngularA = invInertiaA * angularA;
+				const Vec3 dLinearB = linearB * invMassB;
+				const Vec3 dAngularB = invInertiaB * angularB;
+
+				for ( int k = 0; k < 3; k++ ) {
+					batch.invMassJacobian[ row ][ 0 + k ][ lane ] = dLinearA[ k ];
+					batch.invMassJacobian[ row ][ 3 + k ][ lane ] = dAngularA[ k ];
+					batch.invMassJacobian[ row ][ 6 + k ][ lane ] = dLinearB[ k ];
+					batch.invMassJacobian[ row ][ 9 + k ][ lane ] = dAngularB[ k ];
+				}
+
+				float diagonal = 0.0f;
+				for ( int k = 0; k < 12; k++ ) {
+					batch.jacobian[ row ][ k ][ lane ] = J[ k ];
+					diagonal += J[ k ] * batch.invMassJacobian[ row ][ k ][ lane ];
+				}
+
+				// Empty rows ( friction on frictionless contacts ) never receive an impulse
+				batch.effectiveMass[ row ][ lane ] = ( diagonal > 1e-9f ) ? ( 1.0f / diagonal ) : 0.0f;
+				batch.lambda[ row ][ lane ] = constraint.m_cachedLambda[ row ];
+			}
+
+			batch.baumgarte[ lane ] = constraint.m_baumgarte;
+			batch.softMassScale[ lane ] = constraint.m_softMassScale;
+			batch.softImpulseScale[ lane ] = constraint.m_softImpulseScale;
+			batch.friction[ lane ] = constraint.m_friction;
+			batch.frictionLimit[ lane ] = constraint.m_friction * 10.0f * 1.0f / ( invMassA + invMassB );
+		}
+	}
+}
+
+/*
+================================
+ManifoldCollector::StoreBatches
+================================
+*/
+void ManifoldCollector::StoreBatches() {
+	for ( int i = 0; i < m_batches.size(); i++ ) {
+		const contactBatch_t & batch = m_batches[ i ];
+		for ( int lane = 0; lane < batch.numLanes; lane++ ) {
+			ConstraintPenetration * constraint = batch.constraint[ lane ];
+			for ( int row = 0; row < 3; row++ ) {
+				constraint->m_cachedLambda[ row ] = batch.lambda[ row ][ lane ];
+			}
+		}
+	}
+	m_batches.clear();
+}
+
+/*
+================================
+ManifoldCollector::SolveBatch
+
+Sequential impulses on all lanes at once: the normal row first,
+then the two friction rows limited by the normal impulse.
+================================
+*/
+void ManifoldCollector::SolveBatch( contactBatch_t & batch ) {
+	// Gather the lanes' velocities
+	float velocities[ 12 ][ SIMD_WIDTH ];
+	for ( int lane = 0; lane < SIMD_WIDTH; lane++ ) {
+		if ( lane >= batch.numLanes ) {
+			for ( int k = 0; k < 12; k++ ) {
+				velocities[ k ][ lane ] = 0.0f;
+			}
+			continue;
+		}
+
+		const int idxA = batch.bodyA[ lane ];
+		const int idxB = batch.bodyB[ lane ];
+		const Vec3 & linearA = m_solverBodies->m_linearVelocity[ idxA ];
+		const Vec3 & angularA = m_solverBodies->m_angularVelocity[ idxA ];
+		const Vec3 & linearB = m_solverBodies->m_linearVelocity[ idxB ];
+		const Vec3 & angularB = m_solverBodies->m_angularVelocity[ idxB ];
+		for ( int k = 0; k < 3; k++ ) {
+			velocities[ 0 + k ][ lane ] = linearA[ k ];
+			velocities[ 3 + k ][ lane ] = angularA[ k ];
+			velocities[ 6 + k ][ lane ] = linearB[ k ];
+			velocities[ 9 + k ][ lane ] = angularB[ k ];
+		}
+	}
+
+	simdFloat_t v[ 12 ];
+	for ( int k = 0; k < 12; k++ ) {
+		v[ k ] = SimdLoad( velocities[ k ] );
+	}
+
+	const simdFloat_t zero = SimdSet( 0.0f );
+	simdFloat_t normalImpulse = zero;
+
+	for ( int row = 0; row < 3; row++ ) {
+		// J * v
+		simdFloat_t jv = zero;
+		for ( int k = 0; k < 12; k++ ) {
+			jv = SimdMadd( SimdLoad( batch.jacobian[ row ][ k ] ), v[ k ], jv );
+		}
+
+		// The normal row also carries the baumgarte bias
+		simdFloat_t rhs = SimdSub( zero, jv );
+		if ( 0 == row ) {
+			rhs = SimdSub( rhs, SimdLoad( batch.baumgarte ) );
+		}
+		simdFloat_t dLambda = SimdMul( rhs, SimdLoad( batch.effectiveMass[ row ] ) );
+
+		// Accumulate and clamp
+		const simdFloat_t oldLambda = SimdLoad( batch.lambda[ row ] );
+
+		// A soft contact only pushes back part of the way, the same as ConstraintPenetration::Solve
+		if ( 0 == row ) {
+			dLambda = SimdMul( dLambda, SimdLoad( batch.softMassScale ) );
+			dLambda = SimdSub( dLambda, SimdMul( SimdLoad( batch.softImpulseScale ), oldLambda ) );
+		}
+		simdFloat_t newLambda = SimdAdd( oldLambda, dLambda );
+		if ( 0 == row ) {
+			newLambda = SimdMax( newLambda, zero );
+		} else {
+			const simdFloat_t normalForce = SimdMul( SimdAbs( normalImpulse ), SimdLoad( batch.friction ) );
+			const simdFloat_t maxForce = SimdMax( SimdLoad( batch.frictionLimit ), normalForce );
+			newLambda = SimdMin( newLambda, maxForce );
+			newLambda = SimdMax( newLambda, SimdSub( zero, maxForce ) );
+		}
+		SimdStore( batch.lambda[ row ], newLambda );
+
+		const simdFloat_t appliedLambda = SimdSub( newLambda, oldLambda );
+		if ( 0 == row ) {
+			normalImpulse = appliedLambda;
+		}
+
+		// v += M^-1 * J^T * lambda
+		for ( int k = 0; k < 12; k++ ) {
+			v[ k ] = SimdMadd( SimdLoad( batch.invMassJacobian[ row ][ k ] ), appliedLambda, v[ k ] );
+		}
+	}
+
+	for ( int k = 0; k < 12; k++ ) {
+		SimdStore( velocities[ k ], v[ k ] );
+	}
+
+	// Scatter the velocities back, static bodies never change so they're skipped
+	const float maxAngularSpeed = 30.0f;
+	for ( int lane = 0; lane < batch.numLanes; lane++ ) {
+		const int idx[ 2 ] = { batch.bodyA[ lane ], batch.bodyB[ lane ] };
+		for ( int side = 0; side < 2; side++ ) {
+			if ( 0.0f == m_solverBodies->m_invMass[ idx[ side ] ] ) {
+				continue;
+			}
+
+			const int offset = side * 6;
+			Vec3 & linear = m_solverBodies->m_linearVelocity[ idx[ side ] ];
+			Vec3 & angular = m_solverBodies->m_angularVelocity[ idx[ side ] ];
+			for ( int k = 0; k < 3; k++ ) {
+				linear[ k ] = velocities[ offset + k ][ lane ];
+				angular[ k ] = velocities[ offset + 3 + k ][ lane ];
+			}
+
+			// Same limit as SolverBodies::ApplyImpulseAngular
+			if ( angular.GetLengthSqr() > maxAngularSpeed * maxAngularSpeed ) {
+				angular.Normalize();
+				angular *= maxAngularSpeed;
+			}
+		}
 	}
 }
 
@@ -101,12 +804,53 @@ Manifold
 ================================================================================================
 */
 
+/*
+================================
+IsPointFeature
+
+Only pairs of features that touch at a single point identify a contact.
+A vertex touches anything at one point, and two edges cross at one point.
+Face against face ( or face against edge ) touches along a whole patch,
+so every contact in the patch would share the same feature pair.
+================================
+*/
+bool IsPointFeature( const unsigned int featureA, const unsigned int featureB ) {
+	// The top two bits of a packed feature are its vertex count
+	const int numA = (int)( featureA >> 30 );
+	const int numB = (int)( featureB >> 30 );
+	if ( 0 == numA || 0 == numB ) {
+		return false;
+	}
+	return ( 1 == numA || 1 == numB || ( 2 == numA && 2 == numB ) );
+}
+
+/*
+================================
+Manifold::Reset
+
+Readies a pooled manifold for a new pair of bodies.
+================================
+*/
+void Manifold::Reset( Body * bodyA, Body * bodyB ) {
+	m_bodyA = bodyA;
+	m_bodyB = bodyB;
+	m_numContacts = 0;
+	m_numRetired = 0;
+	for ( int i = 0; i < MAX_CONTACTS; i++ ) {
+		m_constraints[ i ].m_cachedLambda.Zero();
+		m_constraints[ i ].m_solverBodies = NULL;
+	}
+}
+
 /*
 ================================
 Manifold::RemoveExpiredContacts
 ================================
 */
 void Manifold::RemoveExpiredContacts() {
+	// Only last frame's retirees are worth remembering
+	m_numRetired = 0;
+
 	// remove any contacts that have drifted too far
 	for ( int i = 0; i < m_numContacts; i++ ) {
 		contact_t & contact = m_contacts[ i ];
@@ -133,6 +877,17 @@ void Manifold::RemoveExpiredContacts() {
 			continue;
 		}
 
+		// A contact that slid but is still touching will most likely be found again this frame,
+		// so remember its impulse under its features
+		if ( penetrationDepth <= 0.0f && IsPointFeature( contact.featureA, contact.featureB ) ) {
+			retiredContact_t & retired = m_retired[ m_numRetired++ ];
+			retired.featureA = contact.featureA;
+			retired.featureB = contact.featureB;
+			for ( int j = 0; j < 3; j++ ) {
+				retired.cachedLambda[ j ] = m_constraints[ i ].m_cachedLambda[ j ];
+			}
+		}
+
 		// This contact has moved beyond its threshold and should be removed
 		for ( int j = i; j < MAX_CONTACTS - 1; j++ ) {
 			m_constraints[ j ] = m_constraints[ j + 1 ];
@@ -151,7 +906,7 @@ void Manifold::RemoveExpiredContacts() {
 Manifold::AddContact
 ================================
 */
-void Manifold::AddContact( const contact_t & contact_old ) {
+Manifold::addContactResult_t Manifold::AddContact( const contact_t & contact_old ) {
 	// Make sure the contact's BodyA and BodyB are of the correct order
 	contact_t contact = contact_old;
 	if ( contact_old.bodyA != m_bodyA || contact_old.bodyB != m_bodyB ) {
@@ -159,11 +914,25 @@ void Manifold::AddContact( const contact_t & contact_old ) {
 		contact.ptOnB_LocalSpace = contact_old.ptOnA_LocalSpace;
 		contact.ptOnA_WorldSpace = contact_old.ptOnB_WorldSpace;
 		contact.ptOnB_WorldSpace = contact_old.ptOnA_WorldSpace;
+		contact.featureA = contact_old.featureB;
+		contact.featureB = contact_old.featureA;
 
 		contact.bodyA = m_bodyA;
 		contact.bodyB = m_bodyB;
 	}
 
+	// If the same pair of features is already in the manifold, then it's the same contact.
+	// Move it to where the features touch now, but keep its accumulated impulse.
+	const bool hasFeature = IsPointFeature( contact.featureA, contact.featureB );
+	if ( hasFeature ) {
+		for ( int i = 0; i < m_numContacts; i++ ) {
+			if ( m_contacts[ i ].featureA == contact.featureA && m_contacts[ i ].featureB == contact.featureB ) {
+				SetContact( i, contact );
+				return ADD_CONTACT_WARM;
+			}
+		}
+	}
+
 	// If this contact is close to another contact, then keep the old contact
 	for ( int i = 0; i < m_numContacts; i++ ) {
 		const Body * bodyA = m_contacts[ i ].bodyA;
@@ -180,10 +949,10 @@ void Manifold::AddContact( const contact_t & contact_old ) {
 
 		const float distanceThreshold = 0.02f;
 		if ( aa.GetLengthSqr() < distanceThreshold * distanceThreshold ) {
-			return;
+			return ADD_CONTACT_REJECTED;
 		}
 		if ( bb.GetLengthSqr() < distanceThreshold * distanceThreshold ) {
-			return;
+			return ADD_CONTACT_REJECTED;
 		}
 	}
 
@@ -212,27 +981,56 @@ void Manifold::AddContact( const contact_t & contact_old ) {
 		if ( -1 != newIdx ) {
 			newSlot = newIdx;
 		} else {
-			return;
+			return ADD_CONTACT_REJECTED;
 		}
 	}
 
-	m_contacts[ newSlot ] = contact;
+	SetContact( newSlot, contact );
+
+	if ( newSlot == m_numContacts ) {
+		m_numContacts++;
+	}
 
-	m_constraints[ newSlot ].m_bodyA = contact.bodyA;
-	m_constraints[ newSlot ].m_bodyB = contact.bodyB;
-	m_constraints[ newSlot ].m_anchorA = contact.ptOnA_LocalSpace;
-	m_constraints[ newSlot ].m_anchorB = contact.ptOnB_LocalSpace;
+	// Pick the impulse back up if these features only just drifted out of the manifold
+	if ( hasFeature ) {
+		for ( int i = 0; i < m_numRetired; i++ ) {
+			const retiredContact_t & retired = m_retired[ i ];
+			if ( retired.featureA != contact.featureA || retired.featureB != contact.featureB ) {
+				continue;
+			}
 
-	// Get the normal in BodyA's space
-	Vec3 normal = m_bodyA->m_orientation.Inverse().RotatePoint( contact.normal * -1.0f );
-	m_constraints[ newSlot ].m_normal = normal;
-	m_constraints[ newSlot ].m_normal.Normalize();
+			for ( int j = 0; j < 3; j++ ) {
+				m_constraints[ newSlot ].m_cachedLambda[ j ] = retired.cachedLambda[ j ];
+			}
+			m_retired[ i ] = m_retired[ m_numRetired - 1 ];
+			m_numRetired--;
+			return ADD_CONTACT_WARM;
+		}
+	}
 
 	m_constraints[ newSlot ].m_cachedLambda.Zero();
+	return ADD_CONTACT_COLD;
+}
 
-	if ( newSlot == m_numContacts ) {
-		m_numContacts++;
-	}
+/*
+================================
+Manifold::SetContact
+
+Stores the contact and points its constraint at it, leaving the cached impulse alone.
+================================
+*/
+void Manifold::SetContact( const int idx, const contact_t & contact ) {
+	m_contacts[ idx ] = contact;
+
+	m_constraints[ idx ].m_bodyA = contact.bodyA;
+	m_constraints[ idx ].m_bodyB = contact.bodyB;
+	m_constraints[ idx ].m_anchorA = contact.ptOnA_LocalSpace;
+	m_constraints[ idx ].m_anchorB = contact.ptOnB_LocalSpace;
+
+	// Get the normal in BodyA's space
+	Vec3 normal = m_bodyA->m_orientation.Inverse().RotatePoint( contact.normal * -1.0f );
+	m_constraints[ idx ].m_normal = normal;
+	m_constraints[ idx ].m_normal.Normalize();
 }
 
 /*
@@ -246,6 +1044,53 @@ void Manifold::PreSolve( const float dt_sec ) {
 	}
 }
 
+/*
+================================
+Manifold::PreSolveSubstep
+================================
+*/
+void Manifold::PreSolveSubstep( const float dt_sec ) {
+	for ( int i = 0; i < m_numContacts; i++ ) {
+		m_constraints[ i ].PreSolveSubstep( dt_sec );
+	}
+}
+
+/*
+================================
+Manifold::SetPositionSolve
+================================
+*/
+void Manifold::SetPositionSolve( const bool usePositionSolve ) {
+	for ( int i = 0; i < m_numContacts; i++ ) {
+		m_constraints[ i ].m_usePositionSolve = usePositionSolve;
+	}
+}
+
+/*
+================================
+Manifold::SolvePositions
+================================
+*/
+float Manifold::SolvePositions() {
+	float maxPenetration = 0.0f;
+	for ( int i = 0; i < m_numContacts; i++ ) {
+		maxPenetration = std::max( maxPenetration, m_constraints[ i ].SolvePositions() );
+	}
+	return maxPenetration;
+}
+
+/*
+================================
+Manifold::SetSoftness
+================================
+*/
+void Manifold::SetSoftness( const float contactHertz, const float dampingRatio ) {
+	for ( int i = 0; i < m_numContacts; i++ ) {
+		m_constraints[ i ].m_contactHertz = contactHertz;
+		m_constraints[ i ].m_contactDampingRatio = dampingRatio;
+	}
+}
+
 /*
 ================================
 Manifold::Solve
@@ -257,6 +1102,146 @@ void Manifold::Solve() {
 	}
 }
 
+/*
+================================
+Manifold::ChooseBlockContacts
+
+The contacts the block solver solves together.  A flat box resting on four
+contacts has only three independent normal directions ( one linear, two
+angular ), so at most three go in the block: the three spanning the largest
+triangle, which keeps the block as well conditioned as it can be.  Contacts
+along a line ( an edge resting on a face ) only have two independent
+directions, then the two furthest apart are the block.  Returns how many
+were chosen, the rest follow them in the list.
+================================
+*/
+int Manifold::ChooseBlockContacts( int contacts[ MAX_CONTACTS ] ) const {
+	// The anchors all move with body A, so its local space is as good as any to measure in
+	int bestPair[ 2 ] = { 0, 1 };
+	float maxDistanceSqr = -1.0f;
+	int bestTriangle[ 3 ] = { 0, 1, 2 };
+	float maxAreaSqr = -1.0f;
+	for ( int i = 0; i < m_numContacts; i++ ) {
+		const Vec3 & a = m_contacts[ i ].ptOnA_LocalSpace;
+		for ( int j = i + 1; j < m_numContacts; j++ ) {
+			const Vec3 & b = m_contacts[ j ].ptOnA_LocalSpace;
+			const float distanceSqr = ( b - a ).GetLengthSqr();
+			if ( distanceSqr > maxDistanceSqr ) {
+				maxDistanceSqr = distanceSqr;
+				bestPair[ 0 ] = i;
+				bestPair[ 1 ] = j;
+			}
+
+			for ( int k = j + 1; k < m_numContacts; k++ ) {
+				const Vec3 & c = m_contacts[ k ].ptOnA_LocalSpace;
+				const float areaSqr = ( b - a ).Cross( c - a ).GetLengthSqr();
+				if ( areaSqr > maxAreaSqr ) {
+					maxAreaSqr = areaSqr;
+					bestTriangle[ 0 ] = i;
+					bestTriangle[ 1 ] = j;
+					bestTriangle[ 2 ] = k;
+				}
+			}
+		}
+	}
+
+	// A triangle less than a hundredth as tall as it is wide is as good as a line
+	const bool isFlat = ( maxAreaSqr < 1e-4f * maxDistanceSqr * maxDistanceSqr );
+	const int numBlock = isFlat ? 2 : MAX_BLOCK_CONTACTS;
+	const int * best = isFlat ? bestPair : bestTriangle;
+
+	bool isInBlock[ MAX_CONTACTS ] = { false };
+	for ( int i = 0; i < numBlock; i++ ) {
+		contacts[ i ] = best[ i ];
+		isInBlock[ best[ i ] ] = true;
+	}
+	int numChosen = numBlock;
+	for ( int i = 0; i < m_numContacts; i++ ) {
+		if ( !isInBlock[ i ] ) {
+			contacts[ numChosen ] = i;
+			numChosen++;
+		}
+	}
+	return numBlock;
+}
+
+/*
+================================
+Manifold::SolveBlock
+
+Friction is solved per contact first.  Then the contacts left out of the
+block get a Gauss-Seidel pass on their normal rows, and the normal rows of
+the block are solved together.  When the direct solution would pull on a
+contact the solver falls back to projected Gauss-Seidel.  If the block is
+degenerate anyway ( three contacts in a line ) the direct solver drops a
+pivot, and the contacts are solved one at a time instead.
+================================
+*/
+void Manifold::SolveBlock( lcpStats_t * stats ) {
+	if ( m_numContacts < 2 ) {
+		Solve();
+		return;
+	}
+
+	for ( int i = 0; i < m_numContacts; i++ ) {
+		m_constraints[ i ].SolveFriction();
+	}
+
+	int contacts[ MAX_CONTACTS ];
+	const int N = ChooseBlockContacts( contacts );
+	for ( int i = N; i < m_numContacts; i++ ) {
+		m_constraints[ contacts[ i ] ].SolveNormal();
+	}
+
+	float jacobian[ MAX_BLOCK_CONTACTS ][ 12 ];
+	float invMassJacobian[ MAX_BLOCK_CONTACTS ][ 12 ];
+	for ( int i = 0; i < N; i++ ) {
+		m_constraints[ contacts[ i ] ].GetNormalRow( jacobian[ i ], invMassJacobian[ i ] );
+	}
+
+	MatN A( N );
+	VecN b( N );
+	VecN lo( N );
+	VecN hi( N );
+	for ( int i = 0; i < N; i++ ) {
+		for ( int j = i; j < N; j++ ) {
+			float sum = 0.0f;
+			for ( int k = 0; k < 12; k++ ) {
+				sum += jacobian[ i ][ k ] * invMassJacobian[ j ][ k ];
+			}
+			A.rows[ i ][ j ] = sum;
+			A.rows[ j ][ i ] = sum;
+		}
+
+		const ConstraintPenetration & constraint = m_constraints[ contacts[ i ] ];
+		b[ i ] = -constraint.GetNormalVelocity() - constraint.m_baumgarte;
+		b[ i ] = b[ i ] * constraint.m_softMassScale - constraint.m_softImpulseScale * constraint.m_cachedLambda[ 0 ] * A.rows[ i ][ i ];
+
+		// The accumulated impulse may never pull
+		lo[ i ] = -constraint.m_cachedLambda[ 0 ];
+		hi[ i ] = FLT_MAX;
+	}
+
+	lcpStats_t blockStats;
+	LCP_ResetStats( blockStats );
+	lcpStats_t * solveStats = ( NULL != stats ) ? stats : &blockStats;
+	const int numDroppedBefore = solveStats->droppedPivots;
+	const VecN lambdaN = LCP_Solve( LCP_SOLVER_LDLT, A, b, lo, hi, solveStats );
+	if ( solveStats->droppedPivots > numDroppedBefore ) {
+		for ( int i = 0; i < N; i++ ) {
+			m_constraints[ contacts[ i ] ].Solve();
+		}
+		return;
+	}
+
+	for ( int i = 0; i < N; i++ ) {
+		ConstraintPenetration & constraint = m_constraints[ contacts[ i ] ];
+		const float oldLambda = constraint.m_cachedLambda[ 0 ];
+		constraint.m_cachedLambda[ 0 ] = std::max( 0.0f, oldLambda + lambdaN[ i ] );
+		constraint.ApplyNormalImpulse( constraint.m_cachedLambda[ 0 ] - oldLambda );
+	}
+}
+
 /*
 ================================
 Manifold::PostSolve
@@ -266,4 +1251,15 @@ void Manifold::PostSolve() {
 	for ( int i = 0; i < m_numContacts; i++ ) {
 		m_constraints[ i ].PostSolve();
 	}
+}
+
+/*
+================================
+Manifold::SetSolverBodies
+================================
+*/
+void Manifold::SetSolverBodies( SolverBodies * solverBodies ) {
+	for ( int i = 0; i < m_numContacts; i++ ) {
+		m_constraints[ i ].m_solverBodies = solverBodies;
+	}
 }
\ No newline at end of file
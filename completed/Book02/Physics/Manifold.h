@@ -5,6 +5,10 @@
 #include "Body.h"
 #include "Constraints.h"
 #include "Contact.h"
+#include "../Math/Simd.h"
+#include <deque>
+
+bool IsPointFeature( const unsigned int featureA, const unsigned int featureB );
 
 /*
 ================================
@@ -13,24 +17,55 @@ Manifold
 */
 class Manifold {
 public:
-	Manifold() : m_bodyA( NULL ), m_bodyB( NULL ), m_numContacts( 0 ) {}
+	Manifold() : m_bodyA( NULL ), m_bodyB( NULL ), m_numContacts( 0 ), m_numRetired( 0 ) {}
 
-	void AddContact( const contact_t & contact );
+	enum addContactResult_t {
+		ADD_CONTACT_REJECTED,	// too close to an existing contact, the old one is kept
+		ADD_CONTACT_COLD,		// new contact starting from zero impulse
+		ADD_CONTACT_WARM,		// matched a persistent feature and kept its accumulated impulse
+	};
+	addContactResult_t AddContact( const contact_t & contact );
 	void RemoveExpiredContacts();
 
 	void PreSolve( const float dt_sec );
+	void PreSolveSubstep( const float dt_sec );
 	void Solve();
+	void SolveBlock( lcpStats_t * stats );	// the normal rows of up to MAX_BLOCK_CONTACTS contacts at once
 	void PostSolve();
 
+	void SetSolverBodies( SolverBodies * solverBodies );
+	void SetSoftness( const float contactHertz, const float dampingRatio );
+	void SetPositionSolve( const bool usePositionSolve );
+	float SolvePositions();
+
 	contact_t GetContact( const int idx ) const { return m_contacts[ idx ]; }
 	int GetNumContacts() const { return m_numContacts; }
+	const ConstraintPenetration & GetConstraint( const int idx ) const { return m_constraints[ idx ]; }
+
+	Body * GetBodyA() const { return m_bodyA; }
+	Body * GetBodyB() const { return m_bodyB; }
 
 private:
+	void Reset( Body * bodyA, Body * bodyB );
+	void SetContact( const int idx, const contact_t & contact );
+
 	static const int MAX_CONTACTS = 4;
+	static const int MAX_BLOCK_CONTACTS = 3;
+	int ChooseBlockContacts( int contacts[ MAX_CONTACTS ] ) const;
 	contact_t m_contacts[ MAX_CONTACTS ];
 
 	int m_numContacts;
 
+	// Contacts that drifted out of the manifold last frame while still touching.
+	// If the same features show up again their impulse is carried over.
+	struct retiredContact_t {
+		unsigned int featureA;
+		unsigned int featureB;
+		float cachedLambda[ 3 ];	// normal and two friction impulses
+	};
+	retiredContact_t m_retired[ MAX_CONTACTS ];
+	int m_numRetired;
+
 	Body * m_bodyA;
 	Body * m_bodyB;
 
@@ -39,6 +74,55 @@ private:
 	friend class ManifoldCollector;
 };
 
+/*
+================================
+contactSolverMode_t
+================================
+*/
+enum contactSolverMode_t {
+	CONTACT_SOLVER_SCALAR,	// each contact solves its own constraint, one after the other
+	CONTACT_SOLVER_SIMD,	// contacts are packed into batches and solved SIMD_WIDTH at a time
+	CONTACT_SOLVER_BLOCK,	// the normal rows of each manifold are solved together as one small LCP
+};
+
+/*
+================================
+contactBatch_t
+
+SIMD_WIDTH contacts laid out lane by lane.  No dynamic body appears
+in more than one lane of a batch, so the lanes can't race on velocities.
+================================
+*/
+struct contactBatch_t {
+	int numLanes;
+	int bodyA[ SIMD_WIDTH ];	// solver body indices
+	int bodyB[ SIMD_WIDTH ];
+	ConstraintPenetration * constraint[ SIMD_WIDTH ];
+
+	float jacobian[ 3 ][ 12 ][ SIMD_WIDTH ];		// normal and two friction rows
+	float invMassJacobian[ 3 ][ 12 ][ SIMD_WIDTH ];	// M^-1 * J^T, the velocity change per unit impulse
+	float effectiveMass[ 3 ][ SIMD_WIDTH ];			// 1 / ( J * M^-1 * J^T ) for each row
+	float lambda[ 3 ][ SIMD_WIDTH ];				// accumulated impulses
+	float baumgarte[ SIMD_WIDTH ];
+	float softMassScale[ SIMD_WIDTH ];				// soft contacts, one and zero when rigid
+	float softImpulseScale[ SIMD_WIDTH ];
+	float friction[ SIMD_WIDTH ];
+	float frictionLimit[ SIMD_WIDTH ];
+};
+
+/*
+================================
+manifoldHandle_t
+
+Refers to a manifold by pool slot.  The generation changes whenever the
+slot is recycled, so a handle to an expired manifold resolves to NULL.
+================================
+*/
+struct manifoldHandle_t {
+	int slot;
+	unsigned int generation;
+};
+
 /*
 ================================
 ManifoldCollector
@@ -46,17 +130,103 @@ ManifoldCollector
 */
 class ManifoldCollector {
 public:
-	ManifoldCollector() {}
+	ManifoldCollector() : m_solverMode( CONTACT_SOLVER_SCALAR ), m_contactHertz( 0.0f ), m_contactDampingRatio( 10.0f ), m_usePositionSolve( false ), m_numContactsAdded( 0 ), m_numWarmStarts( 0 ), m_numLookupEntries( 0 ), m_solverBodies( NULL ) {
+		LCP_ResetStats( m_blockStats );
+	}
 
 	void AddContact( const contact_t & contact );
 
 	void PreSolve( const float dt_sec );
+	void PreSolveSubstep( const float dt_sec );	// for every substep after the first
 	void Solve();
 	void PostSolve();
+	float SolvePositions();	// returns the deepest penetration left
+
+	void SetSolverBodies( SolverBodies * solverBodies );
 
 	void RemoveExpired();
-	void Clear() { m_manifolds.clear(); }	// For resetting the demo
+	void Clear();	// For resetting the demo
+
+	// Zeroes the LCP counters of the active contacts, so they only count the solves that follow
+	void ResetContactStats();
+
+	// The manifolds and their warm starting for scene snapshots, with the bodies stored as indices
+	// into the given array.  Restoring doesn't allocate once the collector has been as big as the snapshot.
+	int GetStateSize() const;
+	void SaveState( void * state, const Body * bodies ) const;
+	void RestoreState( const void * state, Body * bodies );
+
+	// The active manifolds, in no particular order
+	int GetNumManifolds() const { return (int)m_active.size(); }
+	Manifold & GetManifold( const int idx ) { return m_pool[ m_active[ idx ] ]; }
+	const Manifold & GetManifold( const int idx ) const { return m_pool[ m_active[ idx ] ]; }
+
+	manifoldHandle_t GetHandle( const int idx ) const;
+	Manifold * Resolve( const manifoldHandle_t & handle );
+
+	// Fraction of the contacts added since the last reset that started with a carried over impulse
+	float GetWarmStartHitRate() const { return ( m_numContactsAdded > 0 ) ? (float)m_numWarmStarts / (float)m_numContactsAdded : 0.0f; }
+	void ResetWarmStartStats() { m_numContactsAdded = 0; m_numWarmStarts = 0; }
 
 public:
-	std::vector< Manifold > m_manifolds;
+	contactSolverMode_t m_solverMode;
+
+	// Soft contact spring applied by PreSolve, zero frequency keeps the rigid baumgarte contacts
+	float m_contactHertz;
+	float m_contactDampingRatio;
+
+	// Leaves penetration to SolvePositions rather than biasing the velocities
+	bool m_usePositionSolve;
+
+	int m_numContactsAdded;
+	int m_numWarmStarts;
+
+	lcpStats_t m_blockStats;	// accumulated by the block solver
+
+private:
+	// Pool of manifolds.  A deque so growing never moves ( or deep copies ) the existing manifolds.
+	int AllocateSlot();
+	void FreeSlot( const int slot );
+
+	std::deque< Manifold > m_pool;
+	std::vector< unsigned int > m_generations;	// per slot, bumped every time the slot is freed
+	std::vector< int > m_activeIndex;			// per slot, position in m_active or -1 when free
+	std::vector< int > m_freeSlots;
+	std::vector< int > m_active;				// dense list of slots in use, removal is swap and pop
+
+	// Open addressing ( linear probing ) map from an ordered body pair to its pool slot
+	struct lookupEntry_t {
+		const Body * bodyA;	// the lower of the two body addresses, NULL for an empty slot
+		const Body * bodyB;
+		int slot;
+	};
+	static unsigned int HashPair( const Body * bodyA, const Body * bodyB );
+	int FindManifold( const Body * bodyA, const Body * bodyB ) const;
+	void InsertLookup( const Body * bodyA, const Body * bodyB, const int slot );
+	void RemoveLookup( const Body * bodyA, const Body * bodyB );
+	void RebuildLookup();
+
+	std::vector< lookupEntry_t > m_lookup;	// size is always zero or a power of two
+	int m_numLookupEntries;
+
+	// One active manifold as stored in a snapshot, the lookup is rebuilt from these on restore
+	struct manifoldState_t {
+		int bodyA;
+		int bodyB;
+		int numContacts;
+		int numRetired;
+		contact_t contacts[ Manifold::MAX_CONTACTS ];	// body pointers are cleared, contactBodies has them
+		int contactBodies[ Manifold::MAX_CONTACTS ][ 2 ];
+		Vec3 normals[ Manifold::MAX_CONTACTS ];
+		float cachedLambda[ Manifold::MAX_CONTACTS ][ 3 ];
+		Manifold::retiredContact_t retired[ Manifold::MAX_CONTACTS ];
+	};
+
+	void BuildBatches();
+	void StoreBatches();
+	void SolveBatch( contactBatch_t & batch );
+
+	SolverBodies * m_solverBodies;
+	std::vector< contactBatch_t > m_batches;
+	std::vector< unsigned long long > m_bodyBatchMask;
 };
\ No newline at end of file
@@ -15,6 +15,8 @@ Shape
 */
 class Shape {
 public:
+	virtual ~Shape() {}
+
 	virtual Mat3 InertiaTensor() const = 0;
 
 	virtual Bounds GetBounds( const Vec3 & pos, const Quat & orient ) const = 0;
@@ -31,8 +33,37 @@ public:
 
 	virtual Vec3 Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias ) const = 0;
 
+	// Same as above, but also reports which feature of the shape the support point came from.
+	// Polytopes return the index of the support vertex, shapes without discrete features return 0.
+	virtual Vec3 Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias, int & featureIdx ) const {
+		featureIdx = 0;
+		return Support( dir, pos, orient, bias );
+	}
+
 	virtual float FastestLinearSpeed( const Vec3 & angularVelocity, const Vec3 & dir ) const { return 0.0f; }
 
+	// Thinnest width of the local bounds, a body moving a fraction of this per step can't tunnel
+	virtual float GetMinimumExtent() const {
+		const Bounds bounds = GetBounds();
+		float extent = bounds.WidthX();
+		extent = ( bounds.WidthY() < extent ) ? bounds.WidthY() : extent;
+		extent = ( bounds.WidthZ() < extent ) ? bounds.WidthZ() : extent;
+		return extent;
+	}
+
+	// Furthest the local bounds reach from the center of mass
+	float GetMaximumRadius() const {
+		const Bounds bounds = GetBounds();
+		const Vec3 centerOfMass = GetCenterOfMass();
+		Vec3 corner;
+		for ( int i = 0; i < 3; i++ ) {
+			const float toMins = fabsf( bounds.mins[ i ] - centerOfMass[ i ] );
+			const float toMaxs = fabsf( bounds.maxs[ i ] - centerOfMass[ i ] );
+			corner[ i ] = ( toMins > toMaxs ) ? toMins : toMaxs;
+		}
+		return corner.GetMagnitude();
+	}
+
 protected:
 	Vec3 m_centerOfMass;
 };
@@ -41,9 +41,20 @@ ShapeBox::Support
 ====================================================
 */
 Vec3 ShapeBox::Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias ) const {
+	int featureIdx;
+	return Support( dir, pos, orient, bias, featureIdx );
+}
+
+/*
+====================================================
+ShapeBox::Support
+====================================================
+*/
+Vec3 ShapeBox::Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias, int & featureIdx ) const {
 	// Find the point in furthest in direction
 	Vec3 maxPt = orient.RotatePoint( m_points[ 0 ] ) + pos;
 	float maxDist = dir.Dot( maxPt );
+	featureIdx = 0;
 	for ( int i = 1; i < m_points.size(); i++ ) {
 		const Vec3 pt = orient.RotatePoint( m_points[ i ] ) + pos;
 		const float dist = dir.Dot( pt );
@@ -51,6 +62,7 @@ Vec3 ShapeBox::Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient,
 		if ( dist > maxDist ) {
 			maxDist = dist;
 			maxPt = pt;
+			featureIdx = i;
 		}
 	}
 
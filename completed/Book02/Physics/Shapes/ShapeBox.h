@@ -17,6 +17,7 @@ public:
 	void Build( const Vec3 * pts, const int num );
 
 	Vec3 Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias ) const override;
+	Vec3 Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias, int & featureIdx ) const override;
 
 	Mat3 InertiaTensor() const override;
 
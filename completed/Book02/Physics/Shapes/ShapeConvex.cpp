@@ -528,9 +528,20 @@ ShapeConvex::Support
 ====================================================
 */
 Vec3 ShapeConvex::Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias ) const {
+	int featureIdx;
+	return Support( dir, pos, orient, bias, featureIdx );
+}
+
+/*
+====================================================
+ShapeConvex::Support
+====================================================
+*/
+Vec3 ShapeConvex::Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias, int & featureIdx ) const {
 	// Find the point in furthest in direction
 	Vec3 maxPt = orient.RotatePoint( m_points[ 0 ] ) + pos;
 	float maxDist = dir.Dot( maxPt );
+	featureIdx = 0;
 	for ( int i = 1; i < m_points.size(); i++ ) {
 		const Vec3 pt = orient.RotatePoint( m_points[ i ] ) + pos;
 		const float dist = dir.Dot( pt );
@@ -538,6 +549,7 @@ Vec3 ShapeConvex::Support( const Vec3 & dir, const Vec3 & pos, const Quat & orie
 		if ( dist > maxDist ) {
 			maxDist = dist;
 			maxPt = pt;
+			featureIdx = i;
 		}
 	}
 
@@ -31,9 +31,17 @@ public:
 	explicit ShapeConvex( const Vec3 * pts, const int num ) {
 		Build( pts, num );
 	}
+	// Takes a hull that was already built ( by a scene file export say ) and skips the hull and mass calculations
+	ShapeConvex( const Vec3 * hullPts, const int num, const Vec3 & centerOfMass, const Bounds & bounds, const Mat3 & inertiaTensor ) :
+	m_points( hullPts, hullPts + num ),
+	m_bounds( bounds ),
+	m_inertiaTensor( inertiaTensor ) {
+		m_centerOfMass = centerOfMass;
+	}
 	void Build( const Vec3 * pts, const int num );
 
 	Vec3 Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias ) const override;
+	Vec3 Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias, int & featureIdx ) const override;
 
 	Mat3 InertiaTensor() const override { return m_inertiaTensor; }
 
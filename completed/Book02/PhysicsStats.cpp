@@ -0,0 +1,128 @@
+//
+//  PhysicsStats.cpp
+//
+#include "PhysicsStats.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+====================================================
+PhysicsStats::Clear
+====================================================
+*/
+void PhysicsStats::Clear() {
+	memset( m_steps, 0, sizeof( m_steps ) );
+	m_numSteps = 0;
+}
+
+/*
+====================================================
+PhysicsStats::AddStep
+====================================================
+*/
+void PhysicsStats::AddStep( const physicsStepStats_t & step ) {
+	m_steps[ m_numSteps % STATS_WINDOW ] = step;
+	m_numSteps++;
+
+	// Keep the count from wrapping, the window only needs to know it's full
+	if ( m_numSteps >= 2 * STATS_WINDOW ) {
+		m_numSteps -= STATS_WINDOW;
+	}
+}
+
+/*
+====================================================
+PhysicsStats::GetMin
+====================================================
+*/
+float PhysicsStats::GetMin( const physicsStat_t stat ) const {
+	const int num = GetNumSteps();
+	if ( 0 == num ) {
+		return 0.0f;
+	}
+	float minValue = m_steps[ 0 ].values[ stat ];
+	for ( int i = 1; i < num; i++ ) {
+		minValue = ( m_steps[ i ].values[ stat ] < minValue ) ? m_steps[ i ].values[ stat ] : minValue;
+	}
+	return minValue;
+}
+
+/*
+====================================================
+PhysicsStats::GetAvg
+====================================================
+*/
+float PhysicsStats::GetAvg( const physicsStat_t stat ) const {
+	const int num = GetNumSteps();
+	if ( 0 == num ) {
+		return 0.0f;
+	}
+	double sum = 0.0;
+	for ( int i = 0; i < num; i++ ) {
+		sum += m_steps[ i ].values[ stat ];
+	}
+	return (float)( sum / (double)num );
+}
+
+/*
+====================================================
+PhysicsStats::GetMax
+====================================================
+*/
+float PhysicsStats::GetMax( const physicsStat_t stat ) const {
+	const int num = GetNumSteps();
+	if ( 0 == num ) {
+		return 0.0f;
+	}
+	float maxValue = m_steps[ 0 ].values[ stat ];
+	for ( int i = 1; i < num; i++ ) {
+		maxValue = ( m_steps[ i ].values[ stat ] > maxValue ) ? m_steps[ i ].values[ stat ] : maxValue;
+	}
+	return maxValue;
+}
+
+/*
+====================================================
+PhysicsStats::Print
+====================================================
+*/
+int PhysicsStats::Print( char * buffer, const int bufferSize ) const {
+	if ( bufferSize <= 0 ) {
+		return 0;
+	}
+	buffer[ 0 ] = '\0';
+
+	int length = snprintf( buffer, bufferSize, "%-18s %10s %10s %10s %10s\n", "stat", "last", "min", "avg", "max" );
+	for ( int i = 0; i < NUM_PHYSICS_STATS && length < bufferSize; i++ ) {
+		const physicsStat_t stat = (physicsStat_t)i;
+		length += snprintf( buffer + length, bufferSize - length, "%-18s %10.4g %10.4g %10.4g %10.4g\n", GetStatName( stat ), GetLast( stat ), GetMin( stat ), GetAvg( stat ), GetMax( stat ) );
+	}
+	return ( length < bufferSize ) ? length : bufferSize - 1;
+}
+
+/*
+====================================================
+PhysicsStats::GetStatName
+====================================================
+*/
+const char * PhysicsStats::GetStatName( const physicsStat_t stat ) {
+	switch ( stat ) {
+		case PHYSICS_STAT_PAIRS:				return "pairs";
+		case PHYSICS_STAT_STATIC_PAIRS:			return "static pairs";
+		case PHYSICS_STAT_GJK_CALLS:			return "gjk calls";
+		case PHYSICS_STAT_GJK_ITERATIONS:		return "gjk iterations";
+		case PHYSICS_STAT_EPA_CALLS:			return "epa calls";
+		case PHYSICS_STAT_EPA_ITERATIONS:		return "epa iterations";
+		case PHYSICS_STAT_CA_ITERATIONS:		return "ca iterations";
+		case PHYSICS_STAT_TOI_CONTACTS:			return "toi contacts";
+		case PHYSICS_STAT_MANIFOLDS:			return "manifolds";
+		case PHYSICS_STAT_MANIFOLD_CONTACTS:	return "manifold contacts";
+		case PHYSICS_STAT_SOLVER_ITERATIONS:	return "solver iterations";
+		case PHYSICS_STAT_LCP_ITERATIONS:		return "lcp iterations";
+		case PHYSICS_STAT_SOLVER_RESIDUAL:		return "solver residual";
+		case PHYSICS_STAT_POSITION_ITERATIONS:	return "position passes";
+		case PHYSICS_STAT_POSITION_ERROR:		return "position error";
+		default: break;
+	}
+	return "unknown";
+}
@@ -0,0 +1,74 @@
+//
+//  PhysicsStats.h
+//
+#pragma once
+
+// The skeleton's Scene doesn't keep stats, the application checks for this before showing them
+#define PHYSICS_STATS_AVAILABLE
+
+/*
+====================================================
+physicsStat_t
+
+The engine counters Scene::Update records every step
+====================================================
+*/
+enum physicsStat_t {
+	PHYSICS_STAT_PAIRS,					// broadphase candidate pairs
+	PHYSICS_STAT_STATIC_PAIRS,			// candidates skipped because neither body can move
+	PHYSICS_STAT_GJK_CALLS,				// GJK intersection tests
+	PHYSICS_STAT_GJK_ITERATIONS,
+	PHYSICS_STAT_EPA_CALLS,
+	PHYSICS_STAT_EPA_ITERATIONS,
+	PHYSICS_STAT_CA_ITERATIONS,			// conservative advancement steps of the time of impact queries
+	PHYSICS_STAT_TOI_CONTACTS,			// contacts resolved at their time of impact
+	PHYSICS_STAT_MANIFOLDS,				// active once the narrowphase is done
+	PHYSICS_STAT_MANIFOLD_CONTACTS,
+	PHYSICS_STAT_SOLVER_ITERATIONS,		// velocity iterations, over every substep
+	PHYSICS_STAT_LCP_ITERATIONS,		// sweeps of the joints', contacts' and block contact solver's LCP solves
+	PHYSICS_STAT_SOLVER_RESIDUAL,		// largest row residual the LCP solves left
+	PHYSICS_STAT_POSITION_ITERATIONS,	// NGS passes, over every substep
+	PHYSICS_STAT_POSITION_ERROR,		// largest error the last NGS pass left
+	NUM_PHYSICS_STATS,
+};
+
+struct physicsStepStats_t {
+	float values[ NUM_PHYSICS_STATS ];
+};
+
+/*
+====================================================
+PhysicsStats
+
+The counters of the last STATS_WINDOW steps.  The min, avg and max are taken
+over the steps in the window when asked for, adding a step is just a copy.
+====================================================
+*/
+class PhysicsStats {
+public:
+	PhysicsStats() { Clear(); }
+
+	void Clear();
+	void AddStep( const physicsStepStats_t & step );
+
+	int GetNumSteps() const { return ( m_numSteps < STATS_WINDOW ) ? m_numSteps : STATS_WINDOW; }
+
+	// The most recent step, all zeros before the first
+	const physicsStepStats_t & GetLast() const { return m_steps[ ( m_numSteps + STATS_WINDOW - 1 ) % STATS_WINDOW ]; }
+	float GetLast( const physicsStat_t stat ) const { return GetLast().values[ stat ]; }
+
+	float GetMin( const physicsStat_t stat ) const;
+	float GetAvg( const physicsStat_t stat ) const;
+	float GetMax( const physicsStat_t stat ) const;
+
+	// A line per counter with its last, min, avg and max.  Returns the length written.
+	int Print( char * buffer, const int bufferSize ) const;
+
+	static const char * GetStatName( const physicsStat_t stat );
+
+	static const int STATS_WINDOW = 120;	// two seconds at 60hz
+
+private:
+	physicsStepStats_t m_steps[ STATS_WINDOW ];
+	int m_numSteps;	// every step added since the last Clear
+};
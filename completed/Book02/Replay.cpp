@@ -0,0 +1,381 @@
+//
+//  Replay.cpp
+//
+#include "Replay.h"
+#include "SceneFile.h"
+#include <string.h>
+
+/*
+========================================================================================================
+
+Replay files
+
+========================================================================================================
+*/
+
+static const unsigned int REPLAY_MAGIC = 0x4c505250;	// "PRPL"
+static const unsigned int REPLAY_VERSION = 1;
+
+struct replayHeader_t {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int sceneFileSize;
+	unsigned int snapshotSize;
+	int numBodies;
+	int recordBodyHashes;
+
+	// The scene settings that change the answer
+	int numSolverIterations;
+	int numSubsteps;
+	float contactHertz;
+	float toiTolerance;
+	int positionCorrection;
+	int numPositionIterations;
+};
+
+struct replayStep_t {
+	float dt_sec;
+	int numImpulses;
+	unsigned long long stateHash;
+};
+
+/*
+====================================================
+ReplayRecorder::Begin
+====================================================
+*/
+bool ReplayRecorder::Begin( const Scene & scene, const char * fileName, const bool recordBodyHashes ) {
+	End();
+
+	if ( !scene.m_articulations.empty() ) {
+		printf( "ERROR: Scenes with articulations can't be recorded\n" );
+		return false;
+	}
+
+	std::vector< unsigned char > sceneFile;
+	SceneFile_Export( scene, sceneFile );
+
+	std::vector< unsigned char > snapshot( scene.GetSnapshotSize() );
+	scene.SaveSnapshot( snapshot.data(), (int)snapshot.size() );
+
+	m_file = fopen( fileName, "wb" );
+	if ( NULL == m_file ) {
+		printf( "ERROR: Unable to open %s for recording\n", fileName );
+		return false;
+	}
+
+	replayHeader_t header;
+	memset( &header, 0, sizeof( header ) );
+	header.magic = REPLAY_MAGIC;
+	header.version = REPLAY_VERSION;
+	header.sceneFileSize = (unsigned int)sceneFile.size();
+	header.snapshotSize = (unsigned int)snapshot.size();
+	header.numBodies = (int)scene.m_bodies.size();
+	header.recordBodyHashes = recordBodyHashes ? 1 : 0;
+	header.numSolverIterations = scene.m_numSolverIterations;
+	header.numSubsteps = scene.m_numSubsteps;
+	header.contactHertz = scene.m_contactHertz;
+	header.toiTolerance = scene.m_toiTolerance;
+	header.positionCorrection = scene.m_positionCorrection;
+	header.numPositionIterations = scene.m_numPositionIterations;
+
+	fwrite( &header, sizeof( header ), 1, m_file );
+	fwrite( sceneFile.data(), 1, sceneFile.size(), m_file );
+	fwrite( snapshot.data(), 1, snapshot.size(), m_file );
+
+	m_recordBodyHashes = recordBodyHashes;
+	m_numSteps = 0;
+	m_impulses.clear();
+	m_bodyHashes.resize( recordBodyHashes ? scene.m_bodies.size() : 0 );
+	return true;
+}
+
+/*
+====================================================
+ReplayRecorder::End
+====================================================
+*/
+void ReplayRecorder::End() {
+	if ( NULL == m_file ) {
+		return;
+	}
+	fclose( m_file );
+	m_file = NULL;
+}
+
+/*
+====================================================
+ReplayRecorder::ApplyImpulse
+====================================================
+*/
+void ReplayRecorder::ApplyImpulse( Scene & scene, const int bodyIdx, const Vec3 & point, const Vec3 & impulse ) {
+	scene.m_bodies[ bodyIdx ].ApplyImpulse( point, impulse );
+
+	if ( NULL == m_file ) {
+		return;
+	}
+	replayImpulse_t record;
+	record.body = bodyIdx;
+	record.point = point;
+	record.impulse = impulse;
+	m_impulses.push_back( record );
+}
+
+/*
+====================================================
+ReplayRecorder::Update
+====================================================
+*/
+void ReplayRecorder::Update( Scene & scene, const float dt_sec ) {
+	scene.Update( dt_sec );
+
+	if ( NULL == m_file ) {
+		return;
+	}
+
+	replayStep_t step;
+	memset( &step, 0, sizeof( step ) );
+	step.dt_sec = dt_sec;
+	step.numImpulses = (int)m_impulses.size();
+	step.stateHash = scene.m_stateHash;
+	fwrite( &step, sizeof( step ), 1, m_file );
+	if ( !m_impulses.empty() ) {
+		fwrite( m_impulses.data(), sizeof( replayImpulse_t ), m_impulses.size(), m_file );
+		m_impulses.clear();
+	}
+
+	if ( m_recordBodyHashes ) {
+		for ( int i = 0; i < m_bodyHashes.size(); i++ ) {
+			m_bodyHashes[ i ] = scene.GetBodyStateHash( i );
+		}
+		fwrite( m_bodyHashes.data(), sizeof( unsigned long long ), m_bodyHashes.size(), m_file );
+	}
+	m_numSteps++;
+}
+
+/*
+========================================================================================================
+
+ReplayPlayer
+
+========================================================================================================
+*/
+
+/*
+====================================================
+ReplayPlayer::Clear
+====================================================
+*/
+void ReplayPlayer::Clear( replayReport_t & report ) {
+	report.numSteps = 0;
+	report.divergedStep = -1;
+	report.divergedBody = -1;
+	report.expectedHash = 0;
+	report.actualHash = 0;
+}
+
+/*
+====================================================
+ReplayPlayer::Open
+====================================================
+*/
+bool ReplayPlayer::Open( Scene & scene, const char * fileName ) {
+	Close();
+	Clear( m_report );
+
+	m_file = fopen( fileName, "rb" );
+	if ( NULL == m_file ) {
+		printf( "ERROR: Unable to open replay %s\n", fileName );
+		return false;
+	}
+
+	replayHeader_t header;
+	if ( 1 != fread( &header, sizeof( header ), 1, m_file ) || REPLAY_MAGIC != header.magic || REPLAY_VERSION != header.version ) {
+		printf( "ERROR: %s isn't a replay, or was recorded by a different version\n", fileName );
+		Close();
+		return false;
+	}
+
+	std::vector< unsigned char > sceneFile( header.sceneFileSize );
+	std::vector< unsigned char > snapshot( header.snapshotSize );
+	if ( sceneFile.size() != fread( sceneFile.data(), 1, sceneFile.size(), m_file ) || snapshot.size() != fread( snapshot.data(), 1, snapshot.size(), m_file ) ) {
+		printf( "ERROR: Replay %s is truncated\n", fileName );
+		Close();
+		return false;
+	}
+
+	if ( !SceneFile_Load( scene, sceneFile.data(), (unsigned int)sceneFile.size() ) || !scene.RestoreSnapshot( snapshot.data(), (int)snapshot.size() ) ) {
+		printf( "ERROR: Unable to load the scene recorded in %s\n", fileName );
+		Close();
+		return false;
+	}
+
+	scene.m_numSolverIterations = header.numSolverIterations;
+	scene.m_numSubsteps = header.numSubsteps;
+	scene.m_contactHertz = header.contactHertz;
+	scene.m_toiTolerance = header.toiTolerance;
+	scene.m_positionCorrection = (positionCorrection_t)header.positionCorrection;
+	scene.m_numPositionIterations = header.numPositionIterations;
+
+	m_recordBodyHashes = ( 0 != header.recordBodyHashes );
+	m_bodyHashes.resize( m_recordBodyHashes ? header.numBodies : 0 );
+	return true;
+}
+
+/*
+====================================================
+ReplayPlayer::Close
+====================================================
+*/
+void ReplayPlayer::Close() {
+	if ( NULL == m_file ) {
+		return;
+	}
+	fclose( m_file );
+	m_file = NULL;
+}
+
+/*
+====================================================
+ReplayPlayer::ReadStep
+
+Reads the next step's record, leaving its impulses and body hashes in the members
+====================================================
+*/
+bool ReplayPlayer::ReadStep( float & dt_sec, unsigned long long & stateHash ) {
+	if ( NULL == m_file ) {
+		return false;
+	}
+
+	replayStep_t step;
+	if ( 1 != fread( &step, sizeof( step ), 1, m_file ) || step.numImpulses < 0 ) {
+		return false;
+	}
+
+	m_impulses.resize( step.numImpulses );
+	if ( step.numImpulses > 0 && m_impulses.size() != fread( m_impulses.data(), sizeof( replayImpulse_t ), m_impulses.size(), m_file ) ) {
+		return false;
+	}
+	if ( !m_bodyHashes.empty() && m_bodyHashes.size() != fread( m_bodyHashes.data(), sizeof( unsigned long long ), m_bodyHashes.size(), m_file ) ) {
+		return false;
+	}
+
+	dt_sec = step.dt_sec;
+	stateHash = step.stateHash;
+	return true;
+}
+
+/*
+====================================================
+ReplayPlayer::Step
+====================================================
+*/
+bool ReplayPlayer::Step( Scene & scene ) {
+	float dt_sec;
+	unsigned long long expectedHash;
+	if ( !ReadStep( dt_sec, expectedHash ) ) {
+		return false;
+	}
+
+	for ( int i = 0; i < m_impulses.size(); i++ ) {
+		const replayImpulse_t & impulse = m_impulses[ i ];
+		if ( impulse.body >= 0 && impulse.body < scene.m_bodies.size() ) {
+			scene.m_bodies[ impulse.body ].ApplyImpulse( impulse.point, impulse.impulse );
+		}
+	}
+	scene.Update( dt_sec );
+
+	const int step = m_report.numSteps;
+	m_report.numSteps++;
+	if ( m_report.divergedStep >= 0 || scene.m_stateHash == expectedHash ) {
+		return true;
+	}
+
+	m_report.divergedStep = step;
+	m_report.expectedHash = expectedHash;
+	m_report.actualHash = scene.m_stateHash;
+	for ( int i = 0; i < m_bodyHashes.size() && i < scene.m_bodies.size(); i++ ) {
+		if ( scene.GetBodyStateHash( i ) != m_bodyHashes[ i ] ) {
+			m_report.divergedBody = i;
+			break;
+		}
+	}
+	return true;
+}
+
+/*
+====================================================
+Replay_Verify
+
+Stops at the first step that diverges, everything after it diverges too
+====================================================
+*/
+bool Replay_Verify( const char * fileName, Scene & scene, replayReport_t & report ) {
+	ReplayPlayer player;
+	if ( !player.Open( scene, fileName ) ) {
+		ReplayPlayer::Clear( report );
+		return false;
+	}
+
+	while ( player.Step( scene ) ) {
+		if ( player.GetReport().divergedStep >= 0 ) {
+			break;
+		}
+	}
+	report = player.GetReport();
+	return report.divergedStep < 0;
+}
+
+/*
+====================================================
+Replay_Compare
+====================================================
+*/
+bool Replay_Compare( const char * fileName, Scene & reference, Scene & test, replayReport_t & report ) {
+	ReplayPlayer::Clear( report );
+
+	ReplayPlayer referencePlayer;
+	ReplayPlayer testPlayer;
+	if ( !referencePlayer.Open( reference, fileName ) || !testPlayer.Open( test, fileName ) ) {
+		return false;
+	}
+
+	while ( referencePlayer.Step( reference ) && testPlayer.Step( test ) ) {
+		const int step = report.numSteps;
+		report.numSteps++;
+		if ( reference.m_stateHash == test.m_stateHash ) {
+			continue;
+		}
+
+		report.divergedStep = step;
+		report.expectedHash = reference.m_stateHash;
+		report.actualHash = test.m_stateHash;
+		for ( int i = 0; i < reference.m_bodies.size(); i++ ) {
+			if ( reference.GetBodyStateHash( i ) != test.GetBodyStateHash( i ) ) {
+				report.divergedBody = i;
+				break;
+			}
+		}
+		break;
+	}
+	return report.divergedStep < 0;
+}
+
+/*
+====================================================
+Replay_PrintReport
+====================================================
+*/
+void Replay_PrintReport( const replayReport_t & report ) {
+	if ( report.divergedStep < 0 ) {
+		printf( "Replay matched for all %i steps\n", report.numSteps );
+		return;
+	}
+
+	printf( "Replay diverged at step %i of %i: expected %016llx, got %016llx\n", report.divergedStep, report.numSteps, report.expectedHash, report.actualHash );
+	if ( report.divergedBody >= 0 ) {
+		printf( "  first differing body: %i\n", report.divergedBody );
+	} else {
+		printf( "  no body hashes were recorded, record with them or compare two scenes to find the body\n" );
+	}
+}
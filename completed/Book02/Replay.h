@@ -0,0 +1,116 @@
+//
+//  Replay.h
+//
+#pragma once
+#include <stdio.h>
+#include <vector>
+
+#include "Scene.h"
+
+/*
+====================================================
+Replays
+
+A recording is the scene as it was when recording started, followed by one
+record per Update: the time step, any impulses applied before it and the
+state hash the step left behind.  The scene goes in as a scene file plus a
+snapshot, so the contacts and warm starting carry over and a recording can
+start at any point in a session.
+
+Playing a recording back steps a scene with the same inputs and checks every
+step's hash against the recorded one.  Recordings can also keep a hash per
+body, which is what lets the report name the body that diverged first, at the
+cost of eight bytes per body per step.
+
+Articulations aren't in scene files, so scenes with them can't be recorded.
+====================================================
+*/
+
+struct replayImpulse_t {
+	int body;
+	Vec3 point;		// world space
+	Vec3 impulse;
+};
+
+struct replayReport_t {
+	int numSteps;			// steps played back
+	int divergedStep;		// first step whose state didn't match, -1 if none did
+	int divergedBody;		// first body that didn't match in that step, -1 if unknown
+	unsigned long long expectedHash;
+	unsigned long long actualHash;
+};
+
+/*
+====================================================
+ReplayRecorder
+====================================================
+*/
+class ReplayRecorder {
+public:
+	ReplayRecorder() : m_file( NULL ), m_recordBodyHashes( false ), m_numSteps( 0 ) {}
+	~ReplayRecorder() { End(); }
+
+	bool Begin( const Scene & scene, const char * fileName, const bool recordBodyHashes );
+	void End();
+	bool IsRecording() const { return NULL != m_file; }
+
+	// Applies the impulse now and records it against the next Update
+	void ApplyImpulse( Scene & scene, const int bodyIdx, const Vec3 & point, const Vec3 & impulse );
+
+	// Steps the scene and records the step
+	void Update( Scene & scene, const float dt_sec );
+
+	int GetNumSteps() const { return m_numSteps; }
+
+private:
+	FILE * m_file;
+	bool m_recordBodyHashes;
+	int m_numSteps;
+	std::vector< replayImpulse_t > m_impulses;	// waiting for the next Update
+	std::vector< unsigned long long > m_bodyHashes;
+};
+
+/*
+====================================================
+ReplayPlayer
+
+Open loads the recorded scene into the scene along with the settings that
+change the answer ( iterations, substeps, position correction... ).  Settings
+that shouldn't change the answer, the thread count and contact solver mode,
+are left as they are, so those are what a playback checks.
+====================================================
+*/
+class ReplayPlayer {
+public:
+	ReplayPlayer() : m_file( NULL ), m_recordBodyHashes( false ) { Clear( m_report ); }
+	~ReplayPlayer() { Close(); }
+
+	bool Open( Scene & scene, const char * fileName );
+	void Close();
+
+	// Plays back one step, returns false once the recording runs out
+	bool Step( Scene & scene );
+
+	const replayReport_t & GetReport() const { return m_report; }
+
+	static void Clear( replayReport_t & report );
+
+private:
+	bool ReadStep( float & dt_sec, unsigned long long & stateHash );
+
+	FILE * m_file;
+	bool m_recordBodyHashes;
+	replayReport_t m_report;
+	std::vector< replayImpulse_t > m_impulses;
+	std::vector< unsigned long long > m_bodyHashes;
+};
+
+// Plays the whole recording back and checks every step against the recorded hashes
+bool Replay_Verify( const char * fileName, Scene & scene, replayReport_t & report );
+
+// Plays the recording on both scenes side by side and reports where the test scene first strays from the
+// reference.  The scenes are compared with each other rather than the recording, so any two modes can be
+// checked against each other and the first differing body is always found.
+bool Replay_Compare( const char * fileName, Scene & reference, Scene & test, replayReport_t & report );
+
+void Replay_PrintReport( const replayReport_t & report );
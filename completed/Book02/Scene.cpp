@@ -6,6 +6,14 @@
 #include "Physics/Contact.h"
 #include "Physics/Broadphase.h"
 #include "Physics/Intersections.h"
+#include "Jobs/JobSystem.h"
+#include "Profiler/Profiler.h"
+#include <algorithm>
+#include <chrono>
+
+// Items per job for the parallel stages, small enough to balance and large enough to beat the scheduling cost
+const int BODY_GRAIN_SIZE = 64;
+const int PAIR_GRAIN_SIZE = 16;
 
 /*
 ========================================================================================================
@@ -15,26 +23,112 @@ Scene
 ========================================================================================================
 */
 
+typedef std::chrono::steady_clock phaseClock_t;
+
+/*
+====================================================
+narrowphaseCounters_t
+
+The GJK, EPA and time of impact counters run from startup, a step's share is
+the difference between reads before and after it.  Unsigned, so the difference
+survives the counters wrapping.
+====================================================
+*/
+struct narrowphaseCounters_t {
+	unsigned int gjkCalls;
+	unsigned int gjkIterations;
+	unsigned int epaCalls;
+	unsigned int epaIterations;
+	unsigned int toiIterations;
+};
+
+static void ReadNarrowphaseCounters( narrowphaseCounters_t & counters ) {
+	counters.gjkCalls = (unsigned int)g_numGJKCalls.load( std::memory_order_relaxed );
+	counters.gjkIterations = (unsigned int)g_numGJKIterations.load( std::memory_order_relaxed );
+	counters.epaCalls = (unsigned int)g_numEPACalls.load( std::memory_order_relaxed );
+	counters.epaIterations = (unsigned int)g_numEPAIterations.load( std::memory_order_relaxed );
+	counters.toiIterations = (unsigned int)g_numTOIIterations.load( std::memory_order_relaxed );
+}
+
+/*
+====================================================
+SumSolverStats
+
+The LCP sweeps the joints, the contacts and the block contact solver have run so
+far, and the largest residual any of them was left with
+====================================================
+*/
+static void AddSolverStats( const lcpStats_t & stats, int & totalIterations, float & maxResidual ) {
+	totalIterations += stats.totalIterations;
+	if ( stats.numSolves > 0 ) {
+		maxResidual = std::max( maxResidual, stats.residual );
+	}
+}
+
+static void SumSolverStats( const std::vector< Constraint * > & constraints, const ManifoldCollector & manifolds, int & totalIterations, float & maxResidual ) {
+	totalIterations = 0;
+	maxResidual = 0.0f;
+	AddSolverStats( manifolds.m_blockStats, totalIterations, maxResidual );
+	for ( int i = 0; i < constraints.size(); i++ ) {
+		AddSolverStats( constraints[ i ]->m_solverStats, totalIterations, maxResidual );
+	}
+	for ( int i = 0; i < manifolds.GetNumManifolds(); i++ ) {
+		const Manifold & manifold = manifolds.GetManifold( i );
+		for ( int c = 0; c < manifold.GetNumContacts(); c++ ) {
+			AddSolverStats( manifold.GetConstraint( c ).m_solverStats, totalIterations, maxResidual );
+		}
+	}
+}
+
+/*
+====================================================
+EndPhase
+
+Adds the time since start to the phase and starts the next one.  While
+profiling the phase also goes in the trace as a zone.
+====================================================
+*/
+static void EndPhase( float * phaseTimes, const scenePhase_t phase, phaseClock_t::time_point & start ) {
+	const phaseClock_t::time_point now = phaseClock_t::now();
+	phaseTimes[ phase ] += std::chrono::duration< float, std::milli >( now - start ).count();
+#if GPW_PROFILER
+	if ( Profiler_IsEnabled() ) {
+		const long long end = Profiler_Now();
+		Profiler_Record( Scene::GetPhaseName( phase ), end - std::chrono::duration_cast< std::chrono::nanoseconds >( now - start ).count(), end );
+	}
+#endif
+	start = now;
+}
+
 /*
 ====================================================
 Scene::~Scene
 ====================================================
 */
 Scene::~Scene() {
-	for ( int i = 0; i < m_bodies.size(); i++ ) {
-		delete m_bodies[ i ].m_shape;
-	}
-	m_bodies.clear();
+	Clear();
+
+	delete m_jobs;
+	m_jobs = NULL;
 }
 
 /*
 ====================================================
-Scene::Reset
+Scene::Clear
+
+Bodies may share a shape ( scene files dedupe them ), so each one is only deleted once
 ====================================================
 */
-void Scene::Reset() {
+void Scene::Clear() {
+	std::vector< Shape * > shapes;
+	shapes.reserve( m_bodies.size() );
 	for ( int i = 0; i < m_bodies.size(); i++ ) {
-		delete m_bodies[ i ].m_shape;
+		shapes.push_back( m_bodies[ i ].m_shape );
+	}
+	std::sort( shapes.begin(), shapes.end() );
+	shapes.erase( std::unique( shapes.begin(), shapes.end() ), shapes.end() );
+	for ( int i = 0; i < shapes.size(); i++ ) {
+		delete shapes[ i ];
 	}
 	m_bodies.clear();
 
@@ -43,6 +137,22 @@ void Scene::Reset() {
 	}
 	m_constraints.clear();
 
+	for ( int i = 0; i < m_articulations.size(); i++ ) {
+		delete m_articulations[ i ];
+	}
+	m_articulations.clear();
+
+	m_manifolds.Clear();
+	m_stats.Clear();
+}
+
+/*
+====================================================
+Scene::Reset
+====================================================
+*/
+void Scene::Reset() {
+	Clear();
 	Initialize();
 }
 
@@ -107,170 +217,183 @@ void AddStandardSandBox( std::vector< Body > & bodies ) {
 
 /*
 ====================================================
-Scene::Initialize
+AddRagdoll
+
+Six boxes joined at the neck, shoulders and hips
 ====================================================
 */
-void Scene::Initialize() {
-	const float pi = acosf( -1.0f );
+void AddRagdoll( std::vector< Body > & bodies, std::vector< Constraint * > & constraints, const Vec3 & offset ) {
 	Body body;
+	const int idxFirst = (int)bodies.size();
 
-	//
-	//	Build a ragdoll
-	//
-	{
-		Vec3 offset = Vec3( -5, 0, 0 );
-		
-		// head
-		body.m_position = Vec3( 0, 0, 5.5f ) + offset;
-		body.m_orientation = Quat( 0, 0, 0, 1 );
-		body.m_shape = new ShapeBox( g_boxSmall, sizeof( g_boxSmall ) / sizeof( Vec3 ) );
-		body.m_invMass = 2.0f;
-		body.m_elasticity = 1.0f;
-		body.m_friction = 1.0f;
-		m_bodies.push_back( body );
+	// head
+	body.m_position = Vec3( 0, 0, 5.5f ) + offset;
+	body.m_orientation = Quat( 0, 0, 0, 1 );
+	body.m_shape = new ShapeBox( g_boxSmall, sizeof( g_boxSmall ) / sizeof( Vec3 ) );
+	body.m_invMass = 2.0f;
+	body.m_elasticity = 1.0f;
+	body.m_friction = 1.0f;
+	bodies.push_back( body );
 
-		// torso
-		body.m_position = Vec3( 0, 0, 4 ) + offset;
-		body.m_orientation = Quat( 0, 0, 0, 1 );
-		body.m_shape = new ShapeBox( g_boxBody, sizeof( g_boxBody ) / sizeof( Vec3 ) );
-		body.m_invMass = 0.5f;
-		body.m_elasticity = 1.0f;
-		body.m_friction = 1.0f;
-		m_bodies.push_back( body );
+	// torso
+	body.m_position = Vec3( 0, 0, 4 ) + offset;
+	body.m_orientation = Quat( 0, 0, 0, 1 );
+	body.m_shape = new ShapeBox( g_boxBody, sizeof( g_boxBody ) / sizeof( Vec3 ) );
+	body.m_invMass = 0.5f;
+	body.m_elasticity = 1.0f;
+	body.m_friction = 1.0f;
+	bodies.push_back( body );
 
-		// left arm
-		body.m_position = Vec3( 0.0f, 2.0f, 4.75f ) + offset;
-		body.m_orientation = Quat( Vec3( 0, 0, 1 ), -3.1415f / 2.0f );
-		body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
-		body.m_invMass = 1.0f;
-		body.m_elasticity = 1.0f;
-		body.m_friction = 1.0f;
-		m_bodies.push_back( body );
+	// left arm
+	body.m_position = Vec3( 0.0f, 2.0f, 4.75f ) + offset;
+	body.m_orientation = Quat( Vec3( 0, 0, 1 ), -3.1415f / 2.0f );
+	body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
+	body.m_invMass = 1.0f;
+	body.m_elasticity = 1.0f;
+	body.m_friction = 1.0f;
+	bodies.push_back( body );
 
-		// right arm
-		body.m_position = Vec3( 0.0f, -2.0f, 4.75f ) + offset;
-		body.m_orientation = Quat( Vec3( 0, 0, 1 ), 3.1415f / 2.0f );
-		body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
-		body.m_invMass = 1.0f;
-		body.m_elasticity = 1.0f;
-		body.m_friction = 1.0f;
-		m_bodies.push_back( body );
+	// right arm
+	body.m_position = Vec3( 0.0f, -2.0f, 4.75f ) + offset;
+	body.m_orientation = Quat( Vec3( 0, 0, 1 ), 3.1415f / 2.0f );
+	body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
+	body.m_invMass = 1.0f;
+	body.m_elasticity = 1.0f;
+	body.m_friction = 1.0f;
+	bodies.push_back( body );
 
-		// left leg
-		body.m_position = Vec3( 0.0f, 1.0f, 2.5f ) + offset;
-		body.m_orientation = Quat( Vec3( 0, 1, 0 ), 3.1415f / 2.0f );
-		body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
-		body.m_invMass = 1.0f;
-		body.m_elasticity = 1.0f;
-		body.m_friction = 1.0f;
-		m_bodies.push_back( body );
+	// left leg
+	body.m_position = Vec3( 0.0f, 1.0f, 2.5f ) + offset;
+	body.m_orientation = Quat( Vec3( 0, 1, 0 ), 3.1415f / 2.0f );
+	body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
+	body.m_invMass = 1.0f;
+	body.m_elasticity = 1.0f;
+	body.m_friction = 1.0f;
+	bodies.push_back( body );
 
-		// right leg
-		body.m_position = Vec3( 0.0f, -1.0f, 2.5f ) + offset;
-		body.m_orientation = Quat( Vec3( 0, 1, 0 ), 3.1415f / 2.0f );
-		body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
-		body.m_invMass = 1.0f;
-		body.m_elasticity = 1.0f;
-		body.m_friction = 1.0f;
-		m_bodies.push_back( body );
+	// right leg
+	body.m_position = Vec3( 0.0f, -1.0f, 2.5f ) + offset;
+	body.m_orientation = Quat( Vec3( 0, 1, 0 ), 3.1415f / 2.0f );
+	body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
+	body.m_invMass = 1.0f;
+	body.m_elasticity = 1.0f;
+	body.m_friction = 1.0f;
+	bodies.push_back( body );
 
-		const int idxHead = 0;
-		const int idxTorso = 1;
-		const int idxArmLeft = 2;
-		const int idxArmRight = 3;
-		const int idxLegLeft = 4;
-		const int idxLegRight = 5;
+	const int idxHead = idxFirst + 0;
+	const int idxTorso = idxFirst + 1;
+	const int idxArmLeft = idxFirst + 2;
+	const int idxArmRight = idxFirst + 3;
+	const int idxLegLeft = idxFirst + 4;
+	const int idxLegRight = idxFirst + 5;
 
-		// Neck
-		{
-			ConstraintHingeQuatLimited * joint = new ConstraintHingeQuatLimited();
-			joint->m_bodyA = &m_bodies[ idxHead ];
-			joint->m_bodyB = &m_bodies[ idxTorso ];
+	// Neck
+	{
+		ConstraintHingeQuatLimited * joint = new ConstraintHingeQuatLimited();
+		joint->m_bodyA = &bodies[ idxHead ];
+		joint->m_bodyB = &bodies[ idxTorso ];
 
-			const Vec3 jointWorldSpaceAnchor	= joint->m_bodyA->m_position + Vec3( 0, 0, -0.5f );
-			joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
-			joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+		const Vec3 jointWorldSpaceAnchor	= joint->m_bodyA->m_position + Vec3( 0, 0, -0.5f );
+		joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+		joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
 
-			joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
+		joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
 
-			// Set the initial relative orientation
-			joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
+		// Set the initial relative orientation
+		joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
 
-			m_constraints.push_back( joint );
-		}
+		constraints.push_back( joint );
+	}
 
-		// Shoulder Left
-		{
-			ConstraintConstantVelocityLimited * joint = new ConstraintConstantVelocityLimited();
-			joint->m_bodyB = &m_bodies[ idxArmLeft ];
-			joint->m_bodyA = &m_bodies[ idxTorso ];
+	// Shoulder Left
+	{
+		ConstraintConstantVelocityLimited * joint = new ConstraintConstantVelocityLimited();
+		joint->m_bodyB = &bodies[ idxArmLeft ];
+		joint->m_bodyA = &bodies[ idxTorso ];
 
-			const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, -1.0f, 0.0f );
-			joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
-			joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+		const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, -1.0f, 0.0f );
+		joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+		joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
 
-			joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
+		joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
 
-			// Set the initial relative orientation
-			joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
+		// Set the initial relative orientation
+		joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
 
-			m_constraints.push_back( joint );
-		}
+		constraints.push_back( joint );
+	}
 
-		// Shoulder Right
-		{
-			ConstraintConstantVelocityLimited * joint = new ConstraintConstantVelocityLimited();
-			joint->m_bodyB = &m_bodies[ idxArmRight ];
-			joint->m_bodyA = &m_bodies[ idxTorso ];
+	// Shoulder Right
+	{
+		ConstraintConstantVelocityLimited * joint = new ConstraintConstantVelocityLimited();
+		joint->m_bodyB = &bodies[ idxArmRight ];
+		joint->m_bodyA = &bodies[ idxTorso ];
 
-			const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, 1.0f, 0.0f );
-			joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
-			joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+		const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, 1.0f, 0.0f );
+		joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+		joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
 
-			joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, -1, 0 ) );
+		joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, -1, 0 ) );
 
-			// Set the initial relative orientation
-			joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
+		// Set the initial relative orientation
+		joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
 
-			m_constraints.push_back( joint );
-		}
+		constraints.push_back( joint );
+	}
 
-		// Hip Left
-		{
-			ConstraintHingeQuatLimited * joint = new ConstraintHingeQuatLimited();
-			joint->m_bodyB = &m_bodies[ idxLegLeft ];
-			joint->m_bodyA = &m_bodies[ idxTorso ];
+	// Hip Left
+	{
+		ConstraintHingeQuatLimited * joint = new ConstraintHingeQuatLimited();
+		joint->m_bodyB = &bodies[ idxLegLeft ];
+		joint->m_bodyA = &bodies[ idxTorso ];
 
-			const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, 0, 0.5f );
-			joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
-			joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+		const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, 0, 0.5f );
+		joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+		joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
 
-			joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
+		joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
 
-			// Set the initial relative orientation
-			joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
+		// Set the initial relative orientation
+		joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
 
-			m_constraints.push_back( joint );
-		}
+		constraints.push_back( joint );
+	}
 
-		// Hip Right
-		{
-			ConstraintHingeQuatLimited * joint = new ConstraintHingeQuatLimited();
-			joint->m_bodyB = &m_bodies[ idxLegRight ];
-			joint->m_bodyA = &m_bodies[ idxTorso ];
+	// Hip Right
+	{
+		ConstraintHingeQuatLimited * joint = new ConstraintHingeQuatLimited();
+		joint->m_bodyB = &bodies[ idxLegRight ];
+		joint->m_bodyA = &bodies[ idxTorso ];
 
-			const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, 0, 0.5f );
-			joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
-			joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+		const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, 0, 0.5f );
+		joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+		joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
 
-			joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
+		joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
 
-			// Set the initial relative orientation
-			joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
+		// Set the initial relative orientation
+		joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
 
-			m_constraints.push_back( joint );
-		}
+		constraints.push_back( joint );
 	}
+}
+
+/*
+====================================================
+Scene::Initialize
+====================================================
+*/
+void Scene::Initialize() {
+	const float pi = acosf( -1.0f );
+	Body body;
+
+	//
+	//	Build a ragdoll
+	//
+	AddRagdoll( m_bodies, m_constraints, Vec3( -5, 0, 0 ) );
+
+	// The chain has always picked up the ragdoll's friction
+	body.m_friction = 1.0f;
 
 	//
 	// Build a chain for funsies
@@ -604,51 +727,114 @@ int CompareContacts( const void * p1, const void * p2 ) {
 /*
 ====================================================
 Scene::Update
+
+Runs as a chain of stages, each a join point for the next:
+
+	inertia refresh, gravity	parallel over the bodies
+	broadphase					serial sort and sweep
+	narrowphase					parallel over the pairs
+	gather contacts, sort		serial, in pair order
+	per substep:
+		gravity					parallel over the bodies
+		solve					serial, Gauss-Seidel depends on the order
+		ballistic contacts		serial, sorted by time of impact
+		integrate				parallel over the bodies
+		articulations, NGS		serial
+
+The parallel stages only write to their own body or pair, and anything order
+dependent is done afterwards in a fixed order, so the results are the same
+for any thread count.
 ====================================================
 */
 void Scene::Update( const float dt_sec ) {
+	PROFILE_SCOPE( "Scene::Update" );
+	memset( m_phaseTimes, 0, sizeof( m_phaseTimes ) );
+	phaseClock_t::time_point phaseStart = phaseClock_t::now();
+
+	memset( &m_stepStats, 0, sizeof( m_stepStats ) );
+	narrowphaseCounters_t countersStart;
+	ReadNarrowphaseCounters( countersStart );
+
+	UpdateJobSystem();
+
 	m_manifolds.RemoveExpired();
 
-	// Gravity impulse
-	for ( int i = 0; i < m_bodies.size(); i++ ) {
-		Body * body = &m_bodies[ i ];
-		float mass = 1.0f / body->m_invMass;
-		Vec3 impulseGravity = Vec3( 0, 0, -10 ) * mass * dt_sec;
-		body->ApplyImpulseLinear( impulseGravity );
+	// Bodies may have been placed or reoriented since the last step, refresh their cached inertia
+	m_jobs->ParallelFor( (int)m_bodies.size(), BODY_GRAIN_SIZE, [ this ]( const int begin, const int end ) {
+		for ( int i = begin; i < end; i++ ) {
+			m_bodies[ i ].UpdateInertiaTensors();
+		}
+	} );
+
+	// Collision detection runs once for the whole frame, the solver and integration run once per substep
+	const int numSubsteps = std::max( 1, m_numSubsteps );
+	const float dt_substep = dt_sec / (float)numSubsteps;
+
+	// Only substepping softens the contacts, the springs are tuned to the substep rate
+	m_manifolds.m_contactHertz = ( numSubsteps > 1 ) ? std::min( m_contactHertz, 0.25f / dt_substep ) : 0.0f;
+
+	const bool usePositionSolve = ( POSITION_CORRECTION_NGS == m_positionCorrection );
+	m_manifolds.m_usePositionSolve = usePositionSolve;
+	for ( int i = 0; i < m_constraints.size(); i++ ) {
+		m_constraints[ i ]->m_usePositionSolve = usePositionSolve;
 	}
 
+	// The first substep's gravity goes in before the broadphase, so the swept bounds include it
+	ApplyGravity( dt_substep );
+	EndPhase( m_phaseTimes, SCENE_PHASE_PREPARE, phaseStart );
+
 	//
 	// Broadphase (build potential collision pairs)
 	//
 	std::vector< collisionPair_t > collisionPairs;
 	BroadPhase( m_bodies.data(), (int)m_bodies.size(), collisionPairs, dt_sec );
+	EndPhase( m_phaseTimes, SCENE_PHASE_BROADPHASE, phaseStart );
 
 	//
 	//	NarrowPhase (perform actual collision detection)
 	//
+	// Every pair gets its own slot, large scenes produce far too many pairs to keep them on the stack
+	const int numPairs = (int)collisionPairs.size();
+	std::vector< contact_t > contactStorage( numPairs );
+	std::vector< char > didIntersect( numPairs, 0 );
+	std::atomic< int > numStaticPairs( 0 );
+	m_jobs->ParallelFor( numPairs, PAIR_GRAIN_SIZE, [ & ]( const int begin, const int end ) {
+		int numSkipped = 0;
+		for ( int i = begin; i < end; i++ ) {
+			const collisionPair_t & pair = collisionPairs[ i ];
+			Body * bodyA = &m_bodies[ pair.a ];
+			Body * bodyB = &m_bodies[ pair.b ];
+
+			// Skip body pairs with infinite mass
+			if ( 0.0f == bodyA->m_invMass && 0.0f == bodyB->m_invMass ) {
+				numSkipped++;
+				continue;
+			}
+
+			// Check for intersection
+			didIntersect[ i ] = Intersect( bodyA, bodyB, dt_sec, m_toiTolerance, contactStorage[ i ] ) ? 1 : 0;
+		}
+		numStaticPairs.fetch_add( numSkipped, std::memory_order_relaxed );
+	} );
+
+	// Hand out the hits in pair order, the same order a serial narrowphase finds them in
 	int numContacts = 0;
-	contact_t * contacts = (contact_t *)alloca( sizeof( contact_t ) * collisionPairs.size() );
-	for ( int i = 0; i < collisionPairs.size(); i++ ) {
-		const collisionPair_t & pair = collisionPairs[ i ];
-		Body * bodyA = &m_bodies[ pair.a ];
-		Body * bodyB = &m_bodies[ pair.b ];
-
-		// Skip body pairs with infinite mass
-		if ( 0.0f == bodyA->m_invMass && 0.0f == bodyB->m_invMass ) {
+	contact_t * contacts = contactStorage.data();
+	m_numPairs = numPairs;
+	m_numContacts = 0;
+	for ( int i = 0; i < numPairs; i++ ) {
+		if ( !didIntersect[ i ] ) {
 			continue;
 		}
+		m_numContacts++;
 
-		// Check for intersection
-		contact_t contact;
-		if ( Intersect( bodyA, bodyB, dt_sec, contact ) ) {
-			if ( 0.0f == contact.timeOfImpact ) {
-				// Static contact
-				m_manifolds.AddContact( contact );
-			} else {
-				// Ballistic contact
-				contacts[ numContacts ] = contact;
-				numContacts++;
-			}
+		if ( 0.0f == contactStorage[ i ].timeOfImpact ) {
+			// Static contact
+			m_manifolds.AddContact( contactStorage[ i ] );
+		} else {
+			// Ballistic contact, packed to the front of the storage
+			contacts[ numContacts ] = contactStorage[ i ];
+			numContacts++;
 		}
 	}
 
@@ -656,51 +842,454 @@ void Scene::Update( const float dt_sec ) {
 	if ( numContacts > 1 ) {
 		qsort( contacts, numContacts, sizeof( contact_t ), CompareContacts );
 	}
+	EndPhase( m_phaseTimes, SCENE_PHASE_NARROWPHASE, phaseStart );
+
+	narrowphaseCounters_t countersEnd;
+	ReadNarrowphaseCounters( countersEnd );
+	float * stats = m_stepStats.values;
+	stats[ PHYSICS_STAT_PAIRS ] = (float)numPairs;
+	stats[ PHYSICS_STAT_STATIC_PAIRS ] = (float)numStaticPairs.load( std::memory_order_relaxed );
+	stats[ PHYSICS_STAT_GJK_CALLS ] = (float)( countersEnd.gjkCalls - countersStart.gjkCalls );
+	stats[ PHYSICS_STAT_GJK_ITERATIONS ] = (float)( countersEnd.gjkIterations - countersStart.gjkIterations );
+	stats[ PHYSICS_STAT_EPA_CALLS ] = (float)( countersEnd.epaCalls - countersStart.epaCalls );
+	stats[ PHYSICS_STAT_EPA_ITERATIONS ] = (float)( countersEnd.epaIterations - countersStart.epaIterations );
+	stats[ PHYSICS_STAT_CA_ITERATIONS ] = (float)( countersEnd.toiIterations - countersStart.toiIterations );
+	stats[ PHYSICS_STAT_TOI_CONTACTS ] = (float)numContacts;
+	stats[ PHYSICS_STAT_MANIFOLDS ] = (float)m_manifolds.GetNumManifolds();
+	for ( int i = 0; i < m_manifolds.GetNumManifolds(); i++ ) {
+		stats[ PHYSICS_STAT_MANIFOLD_CONTACTS ] += (float)m_manifolds.GetManifold( i ).GetNumContacts();
+	}
 
-	//
-	//	Solve Constraints
-	//
+	// The contacts are all in now, their counters start over so only this step's solves are summed
+	m_manifolds.ResetContactStats();
+	int lcpIterationsStart;
+	float residualStart;
+	SumSolverStats( m_constraints, m_manifolds, lcpIterationsStart, residualStart );
+
+	// How far into the frame each body has been moved
+	int nextContact = 0;
+	std::vector< float > bodyTimes( m_bodies.size(), 0.0f );
+	for ( int substep = 0; substep < numSubsteps; substep++ ) {
+		if ( substep > 0 ) {
+			ApplyGravity( dt_substep );
+		}
+
+		PreSolveConstraints( dt_substep, 0 == substep );
+		EndPhase( m_phaseTimes, SCENE_PHASE_PRESOLVE, phaseStart );
+
+		SolveConstraints();
+		EndPhase( m_phaseTimes, SCENE_PHASE_SOLVE, phaseStart );
+
+		// The last substep ends exactly on the frame, whatever rounding says
+		const bool isLastSubstep = ( substep == numSubsteps - 1 );
+		const float timeEnd = isLastSubstep ? dt_sec : dt_substep * (float)( substep + 1 );
+		AdvanceBodies( contacts, numContacts, nextContact, bodyTimes.data(), timeEnd, isLastSubstep );
+
+		// Articulations take the velocity the solver left on their links as external force
+		for ( int i = 0; i < m_articulations.size(); i++ ) {
+			m_articulations[ i ]->Step( dt_substep );
+		}
+		EndPhase( m_phaseTimes, SCENE_PHASE_INTEGRATE, phaseStart );
+
+		if ( usePositionSolve ) {
+			SolvePositions();
+			EndPhase( m_phaseTimes, SCENE_PHASE_POSITIONS, phaseStart );
+		}
+	}
+
+	int lcpIterationsEnd;
+	float maxResidual;
+	SumSolverStats( m_constraints, m_manifolds, lcpIterationsEnd, maxResidual );
+	stats[ PHYSICS_STAT_SOLVER_ITERATIONS ] = (float)( numSubsteps * m_numSolverIterations );
+	stats[ PHYSICS_STAT_LCP_ITERATIONS ] = (float)( lcpIterationsEnd - lcpIterationsStart );
+	stats[ PHYSICS_STAT_SOLVER_RESIDUAL ] = maxResidual;
+	m_stats.AddStep( m_stepStats );
+
+	m_stateHash = GetStateHash();
+}
+
+/*
+====================================================
+Scene::GetPhaseName
+====================================================
+*/
+const char * Scene::GetPhaseName( const scenePhase_t phase ) {
+	switch ( phase ) {
+		case SCENE_PHASE_PREPARE:		return "prepare";
+		case SCENE_PHASE_BROADPHASE:	return "broadphase";
+		case SCENE_PHASE_NARROWPHASE:	return "narrowphase";
+		case SCENE_PHASE_PRESOLVE:		return "presolve";
+		case SCENE_PHASE_SOLVE:			return "solve";
+		case SCENE_PHASE_INTEGRATE:		return "integrate";
+		case SCENE_PHASE_POSITIONS:		return "positions";
+		default: break;
+	}
+	return "unknown";
+}
+
+/*
+====================================================
+Scene::UpdateJobSystem
+
+Starts the worker threads, or restarts them if m_numThreads has changed
+====================================================
+*/
+void Scene::UpdateJobSystem() {
+	const int numThreads = std::max( 1, m_numThreads );
+	if ( NULL != m_jobs && m_jobs->GetNumThreads() == numThreads ) {
+		return;
+	}
+
+	delete m_jobs;
+	m_jobs = new JobSystem( numThreads );
+}
+
+/*
+====================================================
+Scene::ApplyGravity
+====================================================
+*/
+void Scene::ApplyGravity( const float dt_sec ) {
+	// Gravity impulse
+	m_jobs->ParallelFor( (int)m_bodies.size(), BODY_GRAIN_SIZE, [ this, dt_sec ]( const int begin, const int end ) {
+		for ( int i = begin; i < end; i++ ) {
+			Body * body = &m_bodies[ i ];
+			float mass = 1.0f / body->m_invMass;
+			Vec3 impulseGravity = Vec3( 0, 0, -10 ) * mass * dt_sec;
+			body->ApplyImpulseLinear( impulseGravity );
+		}
+	} );
+}
+
+/*
+====================================================
+Scene::PreSolveConstraints
+
+Prepares the joints and contacts for one ( sub )step.  The contacts build their
+jacobians on the first substep, later substeps only refresh their separation.
+====================================================
+*/
+void Scene::PreSolveConstraints( const float dt_sec, const bool isFirstSubstep ) {
 	for ( int i = 0; i < m_constraints.size(); i++ ) {
 		m_constraints[ i ]->PreSolve( dt_sec );
 	}
-	m_manifolds.PreSolve( dt_sec );
+	if ( isFirstSubstep ) {
+		m_manifolds.PreSolve( dt_sec );
+	} else {
+		m_manifolds.PreSolveSubstep( dt_sec );
+	}
+}
 
-	const int maxIters = 5;
-	for ( int iters = 0; iters < maxIters; iters++ ) {
+/*
+====================================================
+Scene::SolveConstraints
+
+Runs the velocity iterations for one ( sub )step
+====================================================
+*/
+void Scene::SolveConstraints() {
+	// Run the iterations on a packed copy of the velocities
+	m_solverBodies.Gather( m_bodies.data(), (int)m_bodies.size() );
+	for ( int i = 0; i < m_constraints.size(); i++ ) {
+		m_constraints[ i ]->m_solverBodies = &m_solverBodies;
+	}
+	m_manifolds.SetSolverBodies( &m_solverBodies );
+
+	for ( int iters = 0; iters < m_numSolverIterations; iters++ ) {
 		for ( int i = 0; i < m_constraints.size(); i++ ) {
 			m_constraints[ i ]->Solve();
 		}
 		m_manifolds.Solve();
 	}
 
+	m_solverBodies.Scatter( m_bodies.data(), (int)m_bodies.size() );
+	for ( int i = 0; i < m_constraints.size(); i++ ) {
+		m_constraints[ i ]->m_solverBodies = NULL;
+	}
+	m_manifolds.SetSolverBodies( NULL );
+
 	for ( int i = 0; i < m_constraints.size(); i++ ) {
 		m_constraints[ i ]->PostSolve();
 	}
 	m_manifolds.PostSolve();
+}
 
+/*
+====================================================
+Scene::SolvePositions
 
+Fixes up the joint and penetration error left after integration by moving the
+bodies directly.  Stops early once everything is within a few slops.
+====================================================
+*/
+void Scene::SolvePositions() {
+	const float tolerance = 0.015f;
+	for ( int iters = 0; iters < m_numPositionIterations; iters++ ) {
+		float maxError = 0.0f;
+		for ( int i = 0; i < m_constraints.size(); i++ ) {
+			maxError = std::max( maxError, m_constraints[ i ]->SolvePositions() );
+		}
+		maxError = std::max( maxError, m_manifolds.SolvePositions() );
+
+		m_stepStats.values[ PHYSICS_STAT_POSITION_ITERATIONS ] += 1.0f;
+		m_stepStats.values[ PHYSICS_STAT_POSITION_ERROR ] = maxError;
+		if ( maxError < tolerance ) {
+			break;
+		}
+	}
+}
+
+/*
+====================================================
+Scene::AdvanceBodies
+
+Moves the bodies forward to timeEnd, stopping at each ballistic contact on the way
+to resolve it.  The last substep resolves every contact that's left.
+
+Each body keeps its own clock.  A contact only brings its two bodies up to its time
+of impact, everything else is moved once at the end, so the cost is the number of
+contacts plus the number of bodies rather than their product.  The contacts are
+sorted, so no clock ever has to run backwards.
+====================================================
+*/
+void Scene::AdvanceBodies( contact_t * contacts, const int numContacts, int & nextContact, float * bodyTimes, const float timeEnd, const bool isLastSubstep ) {
 	//
 	// Apply ballistic impulses
 	//
-	float accumulatedTime = 0.0f;
-	for ( int i = 0; i < numContacts; i++ ) {
-		contact_t & contact = contacts[ i ];
-		const float dt = contact.timeOfImpact - accumulatedTime;
-
-		// Position update
-		for ( int j = 0; j < m_bodies.size(); j++ ) {
-			m_bodies[ j ].Update( dt );
+	while ( nextContact < numContacts ) {
+		contact_t & contact = contacts[ nextContact ];
+		if ( !isLastSubstep && contact.timeOfImpact >= timeEnd ) {
+			break;
+		}
+
+		// Position update, just the two bodies touching
+		Body * bodies[ 2 ] = { contact.bodyA, contact.bodyB };
+		for ( int j = 0; j < 2; j++ ) {
+			float & bodyTime = bodyTimes[ bodies[ j ] - m_bodies.data() ];
+			const float dt = contact.timeOfImpact - bodyTime;
+			if ( dt > 0.0f ) {
+				bodies[ j ]->Update( dt );
+				bodyTime = contact.timeOfImpact;
+			}
 		}
 
 		ResolveContact( contact );
-		accumulatedTime += dt;
+		nextContact++;
 	}
 
-	// Update the positions for the rest of this frame's time
-	const float timeRemaining = dt_sec - accumulatedTime;
-	if ( timeRemaining > 0.0f ) {
-		for ( int i = 0; i < m_bodies.size(); i++ ) {
-			m_bodies[ i ].Update( timeRemaining );
+	// Update the positions for the rest of this substep's time
+	m_jobs->ParallelFor( (int)m_bodies.size(), BODY_GRAIN_SIZE, [ this, bodyTimes, timeEnd ]( const int begin, const int end ) {
+		for ( int i = begin; i < end; i++ ) {
+			const float timeRemaining = timeEnd - bodyTimes[ i ];
+			if ( timeRemaining > 0.0f ) {
+				m_bodies[ i ].Update( timeRemaining );
+			}
+			bodyTimes[ i ] = timeEnd;
 		}
+	} );
+}
+
+/*
+====================================================
+snapshotHeader_t
+====================================================
+*/
+struct snapshotHeader_t {
+	int size;	// of the whole snapshot
+	int numBodies;
+	int constraintStateSize;
+	int articulationStateSize;
+};
+
+/*
+====================================================
+bodyState_t
+====================================================
+*/
+struct bodyState_t {
+	Vec3 position;
+	Quat orientation;
+	Vec3 linearVelocity;
+	Vec3 angularVelocity;
+};
+
+/*
+====================================================
+Scene::GetSnapshotSize
+====================================================
+*/
+int Scene::GetSnapshotSize() const {
+	int size = (int)sizeof( snapshotHeader_t ) + (int)m_bodies.size() * (int)sizeof( bodyState_t );
+	for ( int i = 0; i < (int)m_constraints.size(); i++ ) {
+		size += m_constraints[ i ]->GetStateSize();
+	}
+	for ( int i = 0; i < (int)m_articulations.size(); i++ ) {
+		size += m_articulations[ i ]->GetStateSize();
+	}
+	size += m_manifolds.GetStateSize();
+	return size;
+}
+
+/*
+====================================================
+Scene::SaveSnapshot
+====================================================
+*/
+int Scene::SaveSnapshot( void * buffer, const int bufferSize ) const {
+	const int size = GetSnapshotSize();
+	if ( size > bufferSize ) {
+		return 0;
+	}
+
+	unsigned char * dst = (unsigned char *)buffer;
+
+	snapshotHeader_t header;
+	header.size = size;
+	header.numBodies = (int)m_bodies.size();
+	header.constraintStateSize = 0;
+	for ( int i = 0; i < (int)m_constraints.size(); i++ ) {
+		header.constraintStateSize += m_constraints[ i ]->GetStateSize();
+	}
+	header.articulationStateSize = 0;
+	for ( int i = 0; i < (int)m_articulations.size(); i++ ) {
+		header.articulationStateSize += m_articulations[ i ]->GetStateSize();
+	}
+	memcpy( dst, &header, sizeof( header ) );
+	dst += sizeof( header );
+
+	for ( int i = 0; i < (int)m_bodies.size(); i++ ) {
+		const Body & body = m_bodies[ i ];
+		bodyState_t bodyState;
+		bodyState.position = body.m_position;
+		bodyState.orientation = body.m_orientation;
+		bodyState.linearVelocity = body.m_linearVelocity;
+		bodyState.angularVelocity = body.m_angularVelocity;
+		memcpy( dst, &bodyState, sizeof( bodyState ) );
+		dst += sizeof( bodyState );
+	}
+
+	for ( int i = 0; i < (int)m_constraints.size(); i++ ) {
+		m_constraints[ i ]->SaveState( dst );
+		dst += m_constraints[ i ]->GetStateSize();
+	}
+	for ( int i = 0; i < (int)m_articulations.size(); i++ ) {
+		m_articulations[ i ]->SaveState( dst );
+		dst += m_articulations[ i ]->GetStateSize();
+	}
+
+	m_manifolds.SaveState( dst, m_bodies.data() );
+	return size;
+}
+
+/*
+====================================================
+Scene::RestoreSnapshot
+
+Fails without touching the scene if the snapshot was taken from a scene with
+different bodies, joints or articulations.
+====================================================
+*/
+bool Scene::RestoreSnapshot( const void * buffer, const int size ) {
+	const unsigned char * src = (const unsigned char *)buffer;
+	if ( size < (int)sizeof( snapshotHeader_t ) ) {
+		return false;
+	}
+
+	snapshotHeader_t header;
+	memcpy( &header, src, sizeof( header ) );
+	src += sizeof( header );
+
+	int constraintStateSize = 0;
+	for ( int i = 0; i < (int)m_constraints.size(); i++ ) {
+		constraintStateSize += m_constraints[ i ]->GetStateSize();
+	}
+	int articulationStateSize = 0;
+	for ( int i = 0; i < (int)m_articulations.size(); i++ ) {
+		articulationStateSize += m_articulations[ i ]->GetStateSize();
+	}
+	if ( header.size > size || header.numBodies != (int)m_bodies.size() || header.constraintStateSize != constraintStateSize || header.articulationStateSize != articulationStateSize ) {
+		return false;
+	}
+
+	for ( int i = 0; i < (int)m_bodies.size(); i++ ) {
+		bodyState_t bodyState;
+		memcpy( (void *)&bodyState, src, sizeof( bodyState ) );
+		src += sizeof( bodyState );
+
+		Body & body = m_bodies[ i ];
+		body.m_position = bodyState.position;
+		body.m_orientation = bodyState.orientation;
+		body.m_linearVelocity = bodyState.linearVelocity;
+		body.m_angularVelocity = bodyState.angularVelocity;
+		body.UpdateInertiaTensors();
 	}
-}
\ No newline at end of file
+
+	for ( int i = 0; i < (int)m_constraints.size(); i++ ) {
+		m_constraints[ i ]->RestoreState( src );
+		src += m_constraints[ i ]->GetStateSize();
+	}
+	for ( int i = 0; i < (int)m_articulations.size(); i++ ) {
+		m_articulations[ i ]->RestoreState( src );
+		src += m_articulations[ i ]->GetStateSize();
+	}
+
+	m_manifolds.RestoreState( src, m_bodies.data() );
+	return true;
+}
+
+/*
+====================================================
+HashWords
+
+FNV-1a, a 32 bit word at a time rather than a byte, which is plenty to tell two bit patterns apart
+====================================================
+*/
+static unsigned long long HashWords( unsigned long long hash, const void * data, const int size ) {
+	const unsigned int * words = (const unsigned int *)data;
+	const int numWords = size / sizeof( unsigned int );
+	for ( int i = 0; i < numWords; i++ ) {
+		hash ^= words[ i ];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/*
+====================================================
+HashBodyState
+====================================================
+*/
+static unsigned long long HashBodyState( unsigned long long hash, const Body & body ) {
+	hash = HashWords( hash, &body.m_position, sizeof( body.m_position ) );
+	hash = HashWords( hash, &body.m_orientation, sizeof( body.m_orientation ) );
+	hash = HashWords( hash, &body.m_linearVelocity, sizeof( body.m_linearVelocity ) );
+	hash = HashWords( hash, &body.m_angularVelocity, sizeof( body.m_angularVelocity ) );
+	return hash;
+}
+
+static const unsigned long long STATE_HASH_SEED = 14695981039346656037ULL;
+
+/*
+====================================================
+Scene::GetBodyStateHash
+====================================================
+*/
+unsigned long long Scene::GetBodyStateHash( const int bodyIdx ) const {
+	return HashBodyState( STATE_HASH_SEED, m_bodies[ bodyIdx ] );
+}
+
+/*
+====================================================
+Scene::GetStateHash
+
+Hash of every body's position, orientation and velocities, bit for bit.
+Two runs that hash the same after a step have stepped identically.
+====================================================
+*/
+unsigned long long Scene::GetStateHash() const {
+	unsigned long long hash = STATE_HASH_SEED;
+	for ( int i = 0; i < m_bodies.size(); i++ ) {
+		hash = HashBodyState( hash, m_bodies[ i ] );
+	}
+	return hash;
+}
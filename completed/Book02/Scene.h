@@ -3,11 +3,48 @@
 //
 #pragma once
 #include <vector>
+#include <string.h>
 
 #include "Physics/Shapes.h"
 #include "Physics/Body.h"
 #include "Physics/Constraints.h"
 #include "Physics/Manifold.h"
+#include "Physics/Articulation.h"
+#include "PhysicsStats.h"
+
+class JobSystem;
+
+/*
+====================================================
+positionCorrection_t
+====================================================
+*/
+enum positionCorrection_t {
+	POSITION_CORRECTION_BAUMGARTE,	// position error is fed back into the velocity solve as a bias
+	POSITION_CORRECTION_NGS,		// a separate non-linear Gauss-Seidel pass moves the bodies after integration
+};
+
+// Pieces of the demo scene, also used by the benchmarks
+void AddStandardSandBox( std::vector< Body > & bodies );
+void AddRagdoll( std::vector< Body > & bodies, std::vector< Constraint * > & constraints, const Vec3 & offset );
+
+/*
+====================================================
+scenePhase_t
+
+The parts of Update that get timed
+====================================================
+*/
+enum scenePhase_t {
+	SCENE_PHASE_PREPARE,		// manifold expiry, inertia refresh and gravity
+	SCENE_PHASE_BROADPHASE,
+	SCENE_PHASE_NARROWPHASE,	// includes sorting the times of impact
+	SCENE_PHASE_PRESOLVE,		// building the joint and contact jacobians, every substep
+	SCENE_PHASE_SOLVE,			// velocity iterations and warm start storage, every substep
+	SCENE_PHASE_INTEGRATE,		// moving the bodies through their times of impact and the articulations
+	SCENE_PHASE_POSITIONS,		// NGS position passes
+	NUM_SCENE_PHASES,
+};
 
 /*
 ====================================================
@@ -16,15 +53,70 @@ Scene
 */
 class Scene {
 public:
-	Scene() { m_bodies.reserve( 128 ); }
+	Scene() : m_numSolverIterations( 5 ), m_numSubsteps( 1 ), m_contactHertz( 30.0f ), m_toiTolerance( 0.0005f ), m_positionCorrection( POSITION_CORRECTION_BAUMGARTE ), m_numPositionIterations( 3 ), m_numThreads( 1 ), m_stateHash( 0 ), m_numPairs( 0 ), m_numContacts( 0 ), m_jobs( NULL ) {
+		m_bodies.reserve( 128 );
+		memset( m_phaseTimes, 0, sizeof( m_phaseTimes ) );
+		memset( &m_stepStats, 0, sizeof( m_stepStats ) );
+	}
 	~Scene();
 
+	// The scene owns its job system, shapes, joints and articulations, a copy would delete them twice
+	Scene( const Scene & ) = delete;
+	Scene & operator=( const Scene & ) = delete;
+
+	void Clear();	// deletes every body, shape, joint and articulation
 	void Reset();
 	void Initialize();
 	void Update( const float dt_sec );	
 
+	// Everything Update changes, copied to and from a flat buffer for rollback and prediction.
+	// Only state is stored, the bodies, shapes, joints and articulations must be the same ones the
+	// snapshot was taken from.  Restoring doesn't allocate once the contact manifolds have been as
+	// many as the snapshot's.
+	int GetSnapshotSize() const;
+	int SaveSnapshot( void * buffer, const int bufferSize ) const;	// returns the bytes written, zero if the buffer is too small
+	bool RestoreSnapshot( const void * buffer, const int size );
+
+	// Hash of the body state, bit for bit.  Update stores the hash of the state it leaves behind in m_stateHash.
+	unsigned long long GetStateHash() const;
+	unsigned long long GetBodyStateHash( const int bodyIdx ) const;
+
 	std::vector< Body > m_bodies;
 	std::vector< Constraint * >	m_constraints;
+	std::vector< Articulation * > m_articulations;	// stepped in reduced coordinates after the bodies move
 	ManifoldCollector m_manifolds;
+	SolverBodies m_solverBodies;
+
+	int m_numSolverIterations;	// velocity iterations per step
+	int m_numSubsteps;			// solver and integration substeps per Update, collision detection runs once
+	float m_contactHertz;		// stiffness of the soft contacts used when substepping
+	float m_toiTolerance;		// how close the time of impact queries bring fast bodies before they count as touching
+
+	positionCorrection_t m_positionCorrection;
+	int m_numPositionIterations;	// most position passes per substep when using NGS
+
+	int m_numThreads;	// threads the parallel stages of Update run on, one runs everything inline
+
+	unsigned long long m_stateHash;	// GetStateHash() as of the end of the last Update
+
+	float m_phaseTimes[ NUM_SCENE_PHASES ];	// milliseconds the last Update spent in each phase
+	int m_numPairs;		// broadphase pairs in the last Update
+	int m_numContacts;	// pairs the narrowphase found touching, or about to within the step
+	static const char * GetPhaseName( const scenePhase_t phase );
+
+	// Engine counters of the recent Updates.  The narrowphase counters are global, so with
+	// several scenes stepping at once each one's share also holds the others'.
+	PhysicsStats m_stats;
+
+private:
+	JobSystem * m_jobs;
+	physicsStepStats_t m_stepStats;	// filled in over an Update, then added to m_stats
+
+	void UpdateJobSystem();
+	void ApplyGravity( const float dt_sec );
+	void PreSolveConstraints( const float dt_sec, const bool isFirstSubstep );
+	void SolveConstraints();
+	void SolvePositions();
+	void AdvanceBodies( contact_t * contacts, const int numContacts, int & nextContact, float * bodyTimes, const float timeEnd, const bool isLastSubstep );
 };
 
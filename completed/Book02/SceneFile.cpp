@@ -0,0 +1,518 @@
+//
+//  SceneFile.cpp
+//
+#include "SceneFile.h"
+#include <stdio.h>
+#include <string.h>
+#include <unordered_map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+========================================================================================================
+
+Scene files
+
+========================================================================================================
+*/
+
+static const unsigned int SCENE_FILE_ALIGNMENT = 16;
+
+/*
+====================================================
+AlignOffset
+====================================================
+*/
+static unsigned int AlignOffset( const unsigned int offset ) {
+	return ( offset + SCENE_FILE_ALIGNMENT - 1 ) & ~( SCENE_FILE_ALIGNMENT - 1 );
+}
+
+/*
+====================================================
+HashShape
+
+FNV-1a over the bytes that make a shape unique
+====================================================
+*/
+static unsigned int HashShape( const sceneFileShape_t & shape, const Vec3 * pts ) {
+	unsigned int hash = 2166136261u;
+	const unsigned char * bytes[ 3 ] = { (const unsigned char *)&shape.type, (const unsigned char *)&shape.radius, (const unsigned char *)pts };
+	const int sizes[ 3 ] = { sizeof( shape.type ), sizeof( shape.radius ), shape.numPoints * (int)sizeof( Vec3 ) };
+	for ( int i = 0; i < 3; i++ ) {
+		for ( int j = 0; j < sizes[ i ]; j++ ) {
+			hash ^= bytes[ i ][ j ];
+			hash *= 16777619u;
+		}
+	}
+	return hash;
+}
+
+/*
+====================================================
+AreShapesEqual
+====================================================
+*/
+static bool AreShapesEqual( const sceneFileShape_t & a, const Vec3 * ptsA, const sceneFileShape_t & b, const Vec3 * ptsB ) {
+	if ( a.type != b.type || a.radius != b.radius || a.numPoints != b.numPoints ) {
+		return false;
+	}
+	return 0 == memcmp( ptsA, ptsB, a.numPoints * sizeof( Vec3 ) );
+}
+
+/*
+====================================================
+CookShape
+====================================================
+*/
+static void CookShape( const Shape * shape, sceneFileShape_t & record, std::vector< Vec3 > & pts ) {
+	record = sceneFileShape_t();
+	record.type = shape->GetType();
+	record.centerOfMass = shape->GetCenterOfMass();
+	record.bounds = shape->GetBounds();
+	record.inertiaTensor = shape->InertiaTensor();
+
+	pts.clear();
+	switch ( shape->GetType() ) {
+		case Shape::SHAPE_SPHERE: {
+			record.radius = ( (const ShapeSphere *)shape )->m_radius;
+		} break;
+		case Shape::SHAPE_BOX: {
+			pts = ( (const ShapeBox *)shape )->m_points;
+		} break;
+		case Shape::SHAPE_CONVEX: {
+			pts = ( (const ShapeConvex *)shape )->m_points;
+		} break;
+	}
+	record.numPoints = (int)pts.size();
+}
+
+/*
+====================================================
+GetBodyIndex
+====================================================
+*/
+static int GetBodyIndex( const Scene & scene, const Body * body ) {
+	if ( NULL == body ) {
+		return -1;
+	}
+	const int idx = (int)( body - scene.m_bodies.data() );
+	if ( idx < 0 || idx >= (int)scene.m_bodies.size() ) {
+		return -1;
+	}
+	return idx;
+}
+
+/*
+====================================================
+SceneFile_Export
+
+Contacts are rebuilt every step, so penetration constraints aren't exported
+====================================================
+*/
+void SceneFile_Export( const Scene & scene, std::vector< unsigned char > & data ) {
+	std::vector< sceneFileShape_t > shapes;
+	std::vector< Vec3 > points;
+	std::vector< sceneFileBody_t > bodies;
+	std::vector< sceneFileConstraint_t > constraints;
+
+	// Bodies that share a shape, or have their own copies of the same one, all point to a single record
+	std::unordered_map< const Shape *, int > shapesByPointer;
+	std::unordered_multimap< unsigned int, int > shapesByHash;
+	std::vector< Vec3 > pts;
+
+	bodies.resize( scene.m_bodies.size() );
+	for ( int i = 0; i < (int)scene.m_bodies.size(); i++ ) {
+		const Body & body = scene.m_bodies[ i ];
+		sceneFileBody_t & record = bodies[ i ];
+		record.position = body.m_position;
+		record.orientation = body.m_orientation;
+		record.linearVelocity = body.m_linearVelocity;
+		record.angularVelocity = body.m_angularVelocity;
+		record.invMass = body.m_invMass;
+		record.elasticity = body.m_elasticity;
+		record.friction = body.m_friction;
+		record.enableCCD = body.m_enableCCD ? 1 : 0;
+
+		std::unordered_map< const Shape *, int >::const_iterator known = shapesByPointer.find( body.m_shape );
+		if ( known != shapesByPointer.end() ) {
+			record.shape = known->second;
+			continue;
+		}
+
+		sceneFileShape_t shape;
+		CookShape( body.m_shape, shape, pts );
+		const unsigned int hash = HashShape( shape, pts.data() );
+
+		record.shape = -1;
+		typedef std::unordered_multimap< unsigned int, int >::const_iterator hashIter_t;
+		const std::pair< hashIter_t, hashIter_t > range = shapesByHash.equal_range( hash );
+		for ( hashIter_t iter = range.first; iter != range.second; ++iter ) {
+			const sceneFileShape_t & other = shapes[ iter->second ];
+			if ( AreShapesEqual( shape, pts.data(), other, points.data() + other.firstPoint ) ) {
+				record.shape = iter->second;
+				break;
+			}
+		}
+
+		if ( record.shape < 0 ) {
+			shape.firstPoint = (int)points.size();
+			points.insert( points.end(), pts.begin(), pts.end() );
+
+			record.shape = (int)shapes.size();
+			shapes.push_back( shape );
+			shapesByHash.insert( std::make_pair( hash, record.shape ) );
+		}
+		shapesByPointer[ body.m_shape ] = record.shape;
+	}
+
+	constraints.reserve( scene.m_constraints.size() );
+	for ( int i = 0; i < (int)scene.m_constraints.size(); i++ ) {
+		const Constraint * constraint = scene.m_constraints[ i ];
+		if ( Constraint::CONSTRAINT_PENETRATION == constraint->GetType() ) {
+			continue;
+		}
+
+		sceneFileConstraint_t record = {};
+		record.type = constraint->GetType();
+		record.bodyA = GetBodyIndex( scene, constraint->m_bodyA );
+		record.bodyB = GetBodyIndex( scene, constraint->m_bodyB );
+		record.anchorA = constraint->m_anchorA;
+		record.axisA = constraint->m_axisA;
+		record.anchorB = constraint->m_anchorB;
+		record.axisB = constraint->m_axisB;
+		record.q0 = Quat( 0, 0, 0, 1 );
+
+		switch ( constraint->GetType() ) {
+			case Constraint::CONSTRAINT_HINGE_QUAT: {
+				record.q0 = ( (const ConstraintHingeQuat *)constraint )->q0;
+			} break;
+			case Constraint::CONSTRAINT_HINGE_QUAT_LIMITED: {
+				record.q0 = ( (const ConstraintHingeQuatLimited *)constraint )->m_q0;
+			} break;
+			case Constraint::CONSTRAINT_CONSTANT_VELOCITY: {
+				record.q0 = ( (const ConstraintConstantVelocity *)constraint )->m_q0;
+			} break;
+			case Constraint::CONSTRAINT_CONSTANT_VELOCITY_LIMITED: {
+				record.q0 = ( (const ConstraintConstantVelocityLimited *)constraint )->m_q0;
+			} break;
+			case Constraint::CONSTRAINT_MOTOR: {
+				const ConstraintMotor * motor = (const ConstraintMotor *)constraint;
+				record.q0 = motor->m_q0;
+				record.motorAxis = motor->m_motorAxis;
+				record.param = motor->m_motorSpeed;
+			} break;
+			case Constraint::CONSTRAINT_MOVER_SIMPLE: {
+				record.param = ( (const ConstraintMoverSimple *)constraint )->m_time;
+			} break;
+			case Constraint::CONSTRAINT_ORIENTATION: {
+				record.q0 = ( (const ConstraintOrientation *)constraint )->m_q0;
+			} break;
+			default: break;
+		}
+		constraints.push_back( record );
+	}
+
+	sceneFileHeader_t header;
+	memset( &header, 0, sizeof( header ) );
+	header.magic = SCENE_FILE_MAGIC;
+	header.version = SCENE_FILE_VERSION;
+	header.shapeRecordSize = sizeof( sceneFileShape_t );
+	header.bodyRecordSize = sizeof( sceneFileBody_t );
+	header.constraintRecordSize = sizeof( sceneFileConstraint_t );
+
+	header.numShapes = (unsigned int)shapes.size();
+	header.shapesOffset = AlignOffset( sizeof( header ) );
+	header.numPoints = (unsigned int)points.size();
+	header.pointsOffset = AlignOffset( header.shapesOffset + header.numShapes * sizeof( sceneFileShape_t ) );
+	header.numBodies = (unsigned int)bodies.size();
+	header.bodiesOffset = AlignOffset( header.pointsOffset + header.numPoints * sizeof( Vec3 ) );
+	header.numConstraints = (unsigned int)constraints.size();
+	header.constraintsOffset = AlignOffset( header.bodiesOffset + header.numBodies * sizeof( sceneFileBody_t ) );
+	header.fileSize = AlignOffset( header.constraintsOffset + header.numConstraints * sizeof( sceneFileConstraint_t ) );
+
+	data.assign( header.fileSize, 0 );
+	memcpy( data.data(), &header, sizeof( header ) );
+	memcpy( data.data() + header.shapesOffset, shapes.data(), shapes.size() * sizeof( sceneFileShape_t ) );
+	memcpy( data.data() + header.pointsOffset, points.data(), points.size() * sizeof( Vec3 ) );
+	memcpy( data.data() + header.bodiesOffset, bodies.data(), bodies.size() * sizeof( sceneFileBody_t ) );
+	memcpy( data.data() + header.constraintsOffset, constraints.data(), constraints.size() * sizeof( sceneFileConstraint_t ) );
+}
+
+/*
+====================================================
+SceneFile_Write
+====================================================
+*/
+bool SceneFile_Write( const Scene & scene, const char * fileName ) {
+	std::vector< unsigned char > data;
+	SceneFile_Export( scene, data );
+
+	FILE * file = fopen( fileName, "wb" );
+	if ( NULL == file ) {
+		printf( "ERROR: Unable to write scene file %s\n", fileName );
+		return false;
+	}
+	const size_t numWritten = fwrite( data.data(), 1, data.size(), file );
+	fclose( file );
+	return numWritten == data.size();
+}
+
+/*
+====================================================
+IsArrayInFile
+====================================================
+*/
+static bool IsArrayInFile( const sceneFileHeader_t & header, const unsigned int offset, const unsigned int count, const unsigned int recordSize ) {
+	if ( 0 != ( offset & ( SCENE_FILE_ALIGNMENT - 1 ) ) || offset > header.fileSize ) {
+		return false;
+	}
+	return count <= ( header.fileSize - offset ) / recordSize;
+}
+
+/*
+====================================================
+SceneFile_GetView
+
+Points the view at the arrays inside the file.  Only the header and the
+indices between records are checked, the records themselves are used as is.
+====================================================
+*/
+bool SceneFile_GetView( const void * data, const unsigned int size, sceneFileView_t & view ) {
+	if ( NULL == data || size < sizeof( sceneFileHeader_t ) || 0 != ( (size_t)data & ( SCENE_FILE_ALIGNMENT - 1 ) ) ) {
+		return false;
+	}
+
+	const unsigned char * bytes = (const unsigned char *)data;
+	const sceneFileHeader_t * header = (const sceneFileHeader_t *)bytes;
+	if ( SCENE_FILE_MAGIC != header->magic || SCENE_FILE_VERSION != header->version || header->fileSize > size ) {
+		return false;
+	}
+	if ( sizeof( sceneFileShape_t ) != header->shapeRecordSize || sizeof( sceneFileBody_t ) != header->bodyRecordSize || sizeof( sceneFileConstraint_t ) != header->constraintRecordSize ) {
+		return false;
+	}
+	if ( !IsArrayInFile( *header, header->shapesOffset, header->numShapes, sizeof( sceneFileShape_t ) ) ||
+		!IsArrayInFile( *header, header->pointsOffset, header->numPoints, sizeof( Vec3 ) ) ||
+		!IsArrayInFile( *header, header->bodiesOffset, header->numBodies, sizeof( sceneFileBody_t ) ) ||
+		!IsArrayInFile( *header, header->constraintsOffset, header->numConstraints, sizeof( sceneFileConstraint_t ) ) ) {
+		return false;
+	}
+
+	view.header = header;
+	view.shapes = (const sceneFileShape_t *)( bytes + header->shapesOffset );
+	view.points = (const Vec3 *)( bytes + header->pointsOffset );
+	view.bodies = (const sceneFileBody_t *)( bytes + header->bodiesOffset );
+	view.constraints = (const sceneFileConstraint_t *)( bytes + header->constraintsOffset );
+
+	const int numShapes = (int)header->numShapes;
+	const int numPoints = (int)header->numPoints;
+	const int numBodies = (int)header->numBodies;
+	for ( int i = 0; i < numShapes; i++ ) {
+		const sceneFileShape_t & shape = view.shapes[ i ];
+		if ( shape.type < Shape::SHAPE_SPHERE || shape.type > Shape::SHAPE_CONVEX ) {
+			return false;
+		}
+		if ( shape.firstPoint < 0 || shape.numPoints < 0 || shape.firstPoint > numPoints - shape.numPoints ) {
+			return false;
+		}
+		if ( Shape::SHAPE_SPHERE != shape.type && 0 == shape.numPoints ) {
+			return false;
+		}
+	}
+	for ( int i = 0; i < numBodies; i++ ) {
+		if ( view.bodies[ i ].shape < 0 || view.bodies[ i ].shape >= numShapes ) {
+			return false;
+		}
+	}
+	for ( int i = 0; i < (int)header->numConstraints; i++ ) {
+		const sceneFileConstraint_t & constraint = view.constraints[ i ];
+		if ( constraint.bodyA < 0 || constraint.bodyA >= numBodies || constraint.bodyB < -1 || constraint.bodyB >= numBodies ) {
+			return false;
+		}
+		if ( constraint.bodyB < 0 && Constraint::CONSTRAINT_MOVER_SIMPLE != constraint.type ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+====================================================
+LoadShape
+====================================================
+*/
+static Shape * LoadShape( const sceneFileView_t & view, const sceneFileShape_t & record ) {
+	const Vec3 * pts = view.points + record.firstPoint;
+	switch ( record.type ) {
+		case Shape::SHAPE_SPHERE:	return new ShapeSphere( record.radius );
+		case Shape::SHAPE_BOX:		return new ShapeBox( pts, record.numPoints );
+		case Shape::SHAPE_CONVEX:	return new ShapeConvex( pts, record.numPoints, record.centerOfMass, record.bounds, record.inertiaTensor );
+	}
+	return NULL;
+}
+
+/*
+====================================================
+LoadConstraint
+====================================================
+*/
+static Constraint * LoadConstraint( const sceneFileConstraint_t & record ) {
+	switch ( record.type ) {
+		case Constraint::CONSTRAINT_DISTANCE: {
+			return new ConstraintDistance();
+		}
+		case Constraint::CONSTRAINT_HINGE_QUAT: {
+			ConstraintHingeQuat * joint = new ConstraintHingeQuat();
+			joint->q0 = record.q0;
+			return joint;
+		}
+		case Constraint::CONSTRAINT_HINGE_QUAT_LIMITED: {
+			ConstraintHingeQuatLimited * joint = new ConstraintHingeQuatLimited();
+			joint->m_q0 = record.q0;
+			return joint;
+		}
+		case Constraint::CONSTRAINT_CONSTANT_VELOCITY: {
+			ConstraintConstantVelocity * joint = new ConstraintConstantVelocity();
+			joint->m_q0 = record.q0;
+			return joint;
+		}
+		case Constraint::CONSTRAINT_CONSTANT_VELOCITY_LIMITED: {
+			ConstraintConstantVelocityLimited * joint = new ConstraintConstantVelocityLimited();
+			joint->m_q0 = record.q0;
+			return joint;
+		}
+		case Constraint::CONSTRAINT_MOTOR: {
+			ConstraintMotor * joint = new ConstraintMotor();
+			joint->m_q0 = record.q0;
+			joint->m_motorAxis = record.motorAxis;
+			joint->m_motorSpeed = record.param;
+			return joint;
+		}
+		case Constraint::CONSTRAINT_MOVER_SIMPLE: {
+			ConstraintMoverSimple * mover = new ConstraintMoverSimple();
+			mover->m_time = record.param;
+			return mover;
+		}
+		case Constraint::CONSTRAINT_ORIENTATION: {
+			ConstraintOrientation * joint = new ConstraintOrientation();
+			joint->m_q0 = record.q0;
+			return joint;
+		}
+	}
+	return NULL;
+}
+
+/*
+====================================================
+SceneFile_Load
+====================================================
+*/
+bool SceneFile_Load( Scene & scene, const void * data, const unsigned int size ) {
+	sceneFileView_t view;
+	if ( !SceneFile_GetView( data, size, view ) ) {
+		printf( "ERROR: Not a scene file, or written by a different version\n" );
+		return false;
+	}
+
+	scene.Clear();
+
+	// Only shapes that a body uses get built
+	std::vector< Shape * > shapes( view.header->numShapes, NULL );
+
+	// The joints hold pointers to the bodies, so the array can't move once they're wired up
+	const int numBodies = (int)view.header->numBodies;
+	scene.m_bodies.reserve( numBodies );
+	for ( int i = 0; i < numBodies; i++ ) {
+		const sceneFileBody_t & record = view.bodies[ i ];
+		Shape *& shape = shapes[ record.shape ];
+		if ( NULL == shape ) {
+			shape = LoadShape( view, view.shapes[ record.shape ] );
+		}
+
+		Body body;
+		body.m_position = record.position;
+		body.m_orientation = record.orientation;
+		body.m_linearVelocity = record.linearVelocity;
+		body.m_angularVelocity = record.angularVelocity;
+		body.m_invMass = record.invMass;
+		body.m_elasticity = record.elasticity;
+		body.m_friction = record.friction;
+		body.m_shape = shape;
+		body.m_enableCCD = ( 0 != record.enableCCD );
+		scene.m_bodies.push_back( body );
+	}
+
+	scene.m_constraints.reserve( view.header->numConstraints );
+	for ( int i = 0; i < (int)view.header->numConstraints; i++ ) {
+		const sceneFileConstraint_t & record = view.constraints[ i ];
+		Constraint * constraint = LoadConstraint( record );
+		if ( NULL == constraint ) {
+			continue;
+		}
+
+		constraint->m_bodyA = &scene.m_bodies[ record.bodyA ];
+		constraint->m_bodyB = ( record.bodyB >= 0 ) ? &scene.m_bodies[ record.bodyB ] : NULL;
+		constraint->m_anchorA = record.anchorA;
+		constraint->m_axisA = record.axisA;
+		constraint->m_anchorB = record.anchorB;
+		constraint->m_axisB = record.axisB;
+		scene.m_constraints.push_back( constraint );
+	}
+	return true;
+}
+
+/*
+====================================================
+SceneFile_LoadMapped
+
+Maps the file read only instead of reading it in, the pages the
+loader doesn't touch never get read from disk
+====================================================
+*/
+bool SceneFile_LoadMapped( Scene & scene, const char * fileName ) {
+	bool result = false;
+#ifdef _WIN32
+	HANDLE file = CreateFileA( fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if ( INVALID_HANDLE_VALUE == file ) {
+		printf( "ERROR: Unable to open scene file %s\n", fileName );
+		return false;
+	}
+
+	const DWORD size = GetFileSize( file, NULL );
+	HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	if ( NULL != mapping ) {
+		const void * data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+		if ( NULL != data ) {
+			result = SceneFile_Load( scene, data, size );
+			UnmapViewOfFile( data );
+		}
+		CloseHandle( mapping );
+	}
+	CloseHandle( file );
+#else
+	const int file = open( fileName, O_RDONLY );
+	if ( file < 0 ) {
+		printf( "ERROR: Unable to open scene file %s\n", fileName );
+		return false;
+	}
+
+	struct stat info;
+	if ( 0 == fstat( file, &info ) && info.st_size > 0 ) {
+		void * data = mmap( NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+		if ( MAP_FAILED != data ) {
+			madvise( data, info.st_size, MADV_SEQUENTIAL );
+			result = SceneFile_Load( scene, data, (unsigned int)info.st_size );
+			munmap( data, info.st_size );
+		}
+	}
+	close( file );
+#endif
+	return result;
+}
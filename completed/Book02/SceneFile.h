@@ -0,0 +1,100 @@
+//
+//  SceneFile.h
+//
+#pragma once
+#include <vector>
+
+#include "Scene.h"
+
+/*
+====================================================
+Scene files
+
+Binary snapshot of a scene's bodies, cooked shapes and joints.  The file is
+laid out exactly as it's used: a header followed by flat arrays of fixed size
+records, every array 16 byte aligned and found through an offset in the
+header.  Loading maps the file, turns the offsets into pointers and walks the
+arrays once, nothing gets parsed and no convex hull or inertia tensor is
+rebuilt.
+
+Shapes are cooked, so convex hulls are stored as their hull points along with
+the center of mass, bounds and inertia tensor.  Identical shapes are only
+stored once and bodies loaded from a file share them.
+
+Contact manifolds, warm starting and articulations aren't stored.
+====================================================
+*/
+
+static const unsigned int SCENE_FILE_MAGIC = 0x4e435350;	// "PSCN"
+static const unsigned int SCENE_FILE_VERSION = 1;
+
+struct sceneFileHeader_t {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int fileSize;
+
+	// Record sizes, so a file written by a build with a different layout is rejected
+	unsigned int shapeRecordSize;
+	unsigned int bodyRecordSize;
+	unsigned int constraintRecordSize;
+
+	unsigned int numShapes;
+	unsigned int shapesOffset;
+	unsigned int numPoints;
+	unsigned int pointsOffset;
+	unsigned int numBodies;
+	unsigned int bodiesOffset;
+	unsigned int numConstraints;
+	unsigned int constraintsOffset;
+};
+
+struct sceneFileShape_t {
+	int type;			// Shape::shapeType_t
+	float radius;		// spheres only
+	int firstPoint;		// boxes and convex hulls, into the point array
+	int numPoints;
+	Vec3 centerOfMass;
+	Bounds bounds;
+	Mat3 inertiaTensor;	// only read back for convex hulls, the others are cheaper to compute than to load
+};
+
+struct sceneFileBody_t {
+	Vec3 position;
+	Quat orientation;
+	Vec3 linearVelocity;
+	Vec3 angularVelocity;
+	float invMass;
+	float elasticity;
+	float friction;
+	int shape;			// index into the shape array
+	int enableCCD;
+};
+
+struct sceneFileConstraint_t {
+	int type;			// Constraint::constraintType_t
+	int bodyA;			// indices into the body array, -1 for none
+	int bodyB;
+	Vec3 anchorA;
+	Vec3 axisA;
+	Vec3 anchorB;
+	Vec3 axisB;
+	Quat q0;			// initial relative orientation, for the joints that keep one
+	Vec3 motorAxis;
+	float param;		// motor speed or the mover's clock
+};
+
+// Read only view of a scene file, the pointers point into the file's memory
+struct sceneFileView_t {
+	const sceneFileHeader_t * header;
+	const sceneFileShape_t * shapes;
+	const Vec3 * points;
+	const sceneFileBody_t * bodies;
+	const sceneFileConstraint_t * constraints;
+};
+
+void SceneFile_Export( const Scene & scene, std::vector< unsigned char > & data );
+bool SceneFile_Write( const Scene & scene, const char * fileName );
+
+bool SceneFile_GetView( const void * data, const unsigned int size, sceneFileView_t & view );
+bool SceneFile_Load( Scene & scene, const void * data, const unsigned int size );	// replaces everything in the scene
+bool SceneFile_LoadMapped( Scene & scene, const char * fileName );